@@ -0,0 +1,225 @@
+#include "config.hpp"
+#include "bufferpool.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace DB;
+
+std::unique_ptr<BufferPool> BufferPool::open(const std::string &path, size_t page_count)
+{
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        perror("open()");
+        return nullptr;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0)
+    {
+        perror("fstat()");
+        close(fd);
+        return nullptr;
+    }
+
+    return std::unique_ptr<BufferPool>(new BufferPool(fd, file_stat.st_size, page_count));
+}
+
+BufferPool::BufferPool(int fd, size_t size, size_t page_count)
+    : m_fd(fd)
+    , m_size(size)
+    , m_page_count(std::max<size_t>(page_count, 1))
+{
+}
+
+BufferPool::Page &BufferPool::pin(size_t page_number)
+{
+    auto &page = load_page(page_number);
+    page.pin_count += 1;
+    return page;
+}
+
+void BufferPool::unpin(Page &page, bool has_been_modified)
+{
+    assert (page.pin_count > 0);
+    page.pin_count -= 1;
+    page.is_dirty |= has_been_modified;
+}
+
+BufferPool::Page &BufferPool::load_page(size_t page_number)
+{
+    auto it = m_page_table.find(page_number);
+    if (it != m_page_table.end())
+    {
+        // Move to the front of the LRU list
+        m_hit_count += 1;
+        m_pages.splice(m_pages.begin(), m_pages, it->second);
+        return *it->second;
+    }
+
+    m_miss_count += 1;
+    if (m_pages.size() >= m_page_count)
+    {
+        // Evict the least recently used page that's not pinned
+        auto victim = m_pages.end();
+        for (auto page = m_pages.rbegin(); page != m_pages.rend(); ++page)
+        {
+            if (page->pin_count == 0)
+            {
+                victim = std::prev(page.base());
+                break;
+            }
+        }
+
+        // NOTE: All pages being pinned means the pool is too small
+        assert (victim != m_pages.end());
+        if (victim->is_dirty)
+            write_back(*victim);
+        m_page_table.erase(victim->number);
+        m_pages.erase(victim);
+    }
+
+    Page page;
+    page.number = page_number;
+    page.data.resize(Config::page_size, 0);
+
+    auto page_start = page_number * Config::page_size;
+    if (page_start < m_size)
+    {
+        auto len = std::min(Config::page_size, m_size - page_start);
+        if (pread(m_fd, page.data.data(), len, page_start) < 0)
+            perror("pread()");
+    }
+
+    m_pages.push_front(std::move(page));
+    m_page_table[page_number] = m_pages.begin();
+    return m_pages.front();
+}
+
+void BufferPool::write_back(Page &page)
+{
+    // NOTE: Only write up to the end of the data, so we don't
+    //       pad the file out to a whole page
+    auto page_start = page.number * Config::page_size;
+    if (page_start < m_size)
+    {
+        auto len = std::min(Config::page_size, m_size - page_start);
+        if (pwrite(m_fd, page.data.data(), len, page_start) < 0)
+            perror("pwrite()");
+    }
+
+    page.is_dirty = false;
+}
+
+void BufferPool::read(size_t offset, void *buffer, size_t len)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto *out = static_cast<char*>(buffer);
+    while (len > 0)
+    {
+        auto &page = pin(offset / Config::page_size);
+        auto offset_in_page = offset % Config::page_size;
+        auto count = std::min(len, Config::page_size - offset_in_page);
+        memcpy(out, page.data.data() + offset_in_page, count);
+        unpin(page, false);
+
+        out += count;
+        offset += count;
+        len -= count;
+    }
+}
+
+void BufferPool::write(size_t offset, const void *buffer, size_t len)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto *in = static_cast<const char*>(buffer);
+    m_size = std::max(m_size, offset + len);
+    while (len > 0)
+    {
+        auto &page = pin(offset / Config::page_size);
+        auto offset_in_page = offset % Config::page_size;
+        auto count = std::min(len, Config::page_size - offset_in_page);
+        memcpy(page.data.data() + offset_in_page, in, count);
+        unpin(page, true);
+
+        in += count;
+        offset += count;
+        len -= count;
+    }
+}
+
+void BufferPool::truncate(size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    assert (size <= m_size);
+    for (auto &page : m_pages)
+    {
+        auto page_start = page.number * Config::page_size;
+        auto page_end = page_start + Config::page_size;
+        if (page_end <= size)
+            continue;
+
+        auto keep = size > page_start ? size - page_start : 0;
+        memset(page.data.data() + keep, 0, Config::page_size - keep);
+    }
+
+    m_size = size;
+    if (ftruncate(m_fd, m_size) < 0)
+        perror("ftruncate()");
+}
+
+void BufferPool::flush()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &page : m_pages)
+    {
+        if (page.is_dirty)
+            write_back(page);
+    }
+}
+
+void BufferPool::sync()
+{
+    flush();
+    if (fdatasync(m_fd) < 0)
+        perror("fdatasync()");
+}
+
+void BufferPool::reload()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &page : m_pages)
+    {
+        if (page.is_dirty)
+            write_back(page);
+    }
+
+    // NOTE: Pinned pages are still in use, so they're kept
+    for (auto page = m_pages.begin(); page != m_pages.end();)
+    {
+        if (page->pin_count > 0)
+        {
+            ++page;
+            continue;
+        }
+
+        m_page_table.erase(page->number);
+        page = m_pages.erase(page);
+    }
+
+    struct stat file_stat;
+    if (fstat(m_fd, &file_stat) < 0)
+        perror("fstat()");
+    else
+        m_size = file_stat.st_size;
+}
+
+BufferPool::~BufferPool()
+{
+    flush();
+    close(m_fd);
+}
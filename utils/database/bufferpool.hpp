@@ -0,0 +1,70 @@
+#pragma once
+#include "storage.hpp"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace DB
+{
+
+    // Keeps the most recently used pages of a file in memory. Scans may
+    // read from several threads at once, so access to the pages is
+    // locked.
+    class BufferPool final : public Storage
+    {
+    public:
+        ~BufferPool();
+
+        BufferPool(const BufferPool&) = delete;
+        BufferPool(BufferPool&) = delete;
+
+        static std::unique_ptr<BufferPool> open(const std::string &path, size_t page_count);
+
+        struct Page
+        {
+            size_t number;
+            int pin_count { 0 };
+            bool is_dirty { false };
+            std::vector<char> data;
+        };
+
+        // A pinned page will not be evicted until it's unpinned again
+        Page &pin(size_t page_number);
+        void unpin(Page&, bool has_been_modified);
+
+        virtual size_t size() const override { return m_size; }
+        virtual void read(size_t offset, void *buffer, size_t len) override;
+        virtual void write(size_t offset, const void *buffer, size_t len) override;
+        virtual void truncate(size_t size) override;
+        virtual void flush() override;
+        virtual void sync() override;
+        virtual void reload() override;
+
+        inline size_t hit_count() const { return m_hit_count; }
+        inline size_t miss_count() const { return m_miss_count; }
+        inline size_t page_count() const { return m_page_count; }
+
+    private:
+        BufferPool(int fd, size_t size, size_t page_count);
+
+        Page &load_page(size_t page_number);
+        void write_back(Page&);
+
+        int m_fd;
+        size_t m_size;
+        size_t m_page_count;
+
+        // Most recently used pages are at the front
+        std::mutex m_mutex;
+        std::list<Page> m_pages;
+        std::unordered_map<size_t, std::list<Page>::iterator> m_page_table;
+
+        size_t m_hit_count { 0 };
+        size_t m_miss_count { 0 };
+
+    };
+
+}
@@ -1,24 +1,42 @@
 #include "chunk.hpp"
 #include "config.hpp"
 #include "database.hpp"
+#include "lz.hpp"
 #include <cassert>
+#include <cstring>
 using namespace DB;
 
 Chunk::Chunk(DB::DataBase& db, size_t header_offset)
     : m_db(db)
     , m_header_offset(header_offset)
 {
-    db.read_string(header_offset, m_type, 2);
-    m_owner_id = db.read_byte(header_offset + 2);
-    m_index = db.read_byte(header_offset + 3);
-    m_size_in_bytes = db.read_int(header_offset + 4);
-    m_padding_in_bytes = db.read_int(header_offset + 8);
-    m_data_offset = header_offset + Config::chunk_header_size;
+    const auto &format = db.format();
+    std::vector<char> data(format.chunk_header_size());
+    db.read_string(header_offset, data.data(), data.size());
+
+    auto header = format.decode_chunk_header(data.data());
+    memcpy(m_type, header.type, 2);
+    m_owner_id = header.owner_id;
+    m_index = header.index;
+    m_size_in_bytes = header.size_in_bytes;
+    m_padding_in_bytes = header.padding_in_bytes;
+    m_data_offset = header_offset + format.chunk_header_size();
 }
 
 size_t Chunk::header_size() const
 {
-    return Config::chunk_header_size;
+    return m_db.format().chunk_header_size();
+}
+
+Format::ChunkHeader Chunk::header() const
+{
+    Format::ChunkHeader header;
+    memcpy(header.type, m_has_been_dropped ? "RM" : m_type, 2);
+    header.owner_id = m_owner_id;
+    header.index = m_index;
+    header.size_in_bytes = m_size_in_bytes;
+    header.padding_in_bytes = m_padding_in_bytes;
+    return header;
 }
 
 bool Chunk::is_active() const
@@ -27,21 +45,95 @@ bool Chunk::is_active() const
     return m_db.m_active_chunk.get() == this;
 }
 
+std::string_view Chunk::compressed_type(std::string_view type)
+{
+    if (type == "RD")
+        return "RZ";
+    if (type == "TX")
+        return "TZ";
+    return type;
+}
+
+std::string_view Chunk::uncompressed_type(std::string_view type)
+{
+    if (type == "RZ")
+        return "RD";
+    if (type == "TZ")
+        return "TX";
+    return type;
+}
+
+void Chunk::load_compression()
+{
+    m_is_compressed = (uncompressed_type(type()) != type());
+    if (m_is_compressed)
+        m_raw_size = (size_t)m_db.read_long(m_data_offset);
+}
+
+const char *Chunk::raw_data()
+{
+    if (m_has_raw_data.load(std::memory_order_acquire))
+        return m_raw_data.data();
+
+    std::lock_guard<std::mutex> lock(m_raw_data_mutex);
+    if (!m_has_raw_data.load(std::memory_order_relaxed))
+    {
+        auto compressed_size = m_size_in_bytes - sizeof(int64_t);
+        std::vector<char> compressed(compressed_size);
+        m_db.read_string(m_data_offset + sizeof(int64_t), compressed.data(), compressed.size());
+
+        m_raw_data.resize(m_raw_size);
+        auto is_valid = LZ::decompress(compressed.data(), compressed.size(), m_raw_data.data(), m_raw_data.size());
+        assert (is_valid);
+        (void)is_valid;
+        m_has_raw_data.store(true, std::memory_order_release);
+    }
+
+    return m_raw_data.data();
+}
+
+void Chunk::read_raw(size_t offset, char *buffer, size_t len)
+{
+    assert (offset + len <= m_raw_size);
+    memcpy(buffer, raw_data() + offset, len);
+}
+
 uint8_t Chunk::read_byte(size_t offset)
 {
     assert (!m_has_been_dropped);
+    if (m_is_compressed)
+    {
+        uint8_t byte;
+        read_raw(offset, (char*)&byte, sizeof(byte));
+        return byte;
+    }
+
     return m_db.read_byte(m_data_offset + offset);
 }
 
 int Chunk::read_int(size_t offset)
 {
     assert (!m_has_been_dropped);
+    if (m_is_compressed)
+    {
+        int i;
+        read_raw(offset, (char*)&i, sizeof(i));
+        return i;
+    }
+
     return m_db.read_int(m_data_offset + offset);
 }
 
 int64_t Chunk::read_long(size_t offset)
 {
     assert (!m_has_been_dropped);
+    if (m_is_compressed)
+    {
+        int64_t l;
+        read_raw(offset, (char*)&l, sizeof(l));
+        return l;
+    }
+
     return m_db.read_long(m_data_offset + offset);
 }
 
@@ -49,18 +141,54 @@ std::string Chunk::read_string(size_t offset, size_t len)
 {
     assert (!m_has_been_dropped);
     std::vector<char> buffer(len);
-    m_db.read_string(m_data_offset + offset, buffer.data(), len);
+    read_bytes(offset, buffer.data(), len);
     return std::string(buffer.data(), buffer.size());
 }
 
+void Chunk::read_bytes(size_t offset, char *buffer, size_t len)
+{
+    assert (!m_has_been_dropped);
+    if (m_is_compressed)
+    {
+        read_raw(offset, buffer, len);
+        return;
+    }
+
+    m_db.read_string(m_data_offset + offset, buffer, len);
+}
+
 void Chunk::check_size(size_t size)
 {
+    // NOTE: Compressed chunks can't be written where they
+    //       are, so they're moved to the end uncompressed
+    if (m_is_compressed)
+        m_db.expand_chunk(*this);
+
+    if (size <= m_size_in_bytes)
+        return;
+
     if (size > m_size_in_bytes + m_padding_in_bytes)
     {
         m_db.check_is_active_chunk(this);
-        m_size_in_bytes = size;
-        m_db.write_int(m_header_offset + 4, m_size_in_bytes);
+        m_padding_in_bytes = 0;
+    }
+    else
+    {
+        // Use up some of the padding
+        m_padding_in_bytes -= size - m_size_in_bytes;
     }
+
+    m_size_in_bytes = size;
+    write_sizes();
+}
+
+void Chunk::write_sizes()
+{
+    const auto &format = m_db.format();
+    char sizes[16];
+    auto len = format.encode_sizes(m_size_in_bytes, m_padding_in_bytes, sizes);
+    m_db.write_bytes(m_header_offset + format.sizes_offset_in_header(), sizes, len);
+    m_db.write_directory_entry(*this);
 }
 
 void Chunk::write_byte(size_t offset, uint8_t byte)
@@ -91,22 +219,32 @@ void Chunk::write_string(size_t offset, const std::string &str)
     m_db.write_string(m_data_offset + offset, str);
 }
 
+void Chunk::write_bytes(size_t offset, const char *buffer, size_t len)
+{
+    assert (!m_has_been_dropped);
+    check_size(offset + len);
+    m_db.write_bytes(m_data_offset + offset, buffer, len);
+}
+
 void Chunk::drop()
 {
     m_db.write_string(m_header_offset, "RM");
     m_has_been_dropped = true;
+    m_db.write_directory_entry(*this);
 }
 
 void Chunk::shrink_to(size_t offset)
 {
-    m_padding_in_bytes = m_size_in_bytes - offset;
-    m_size_in_bytes = offset;
+    if (m_is_compressed)
+        m_db.expand_chunk(*this);
 
-    m_db.write_int(m_header_offset + 4, m_size_in_bytes);
-    m_db.write_int(m_header_offset + 8, m_padding_in_bytes);
+    auto removed = m_size_in_bytes - offset;
+    m_padding_in_bytes += removed;
+    m_size_in_bytes = offset;
+    write_sizes();
 
-    for (size_t i = m_size_in_bytes; i < m_padding_in_bytes; i++)
-        write_byte(i, 0xCD);
+    std::vector<char> fill(removed, (char)0xCD);
+    m_db.write_bytes(m_data_offset + m_size_in_bytes, fill.data(), fill.size());
 }
 
 std::ostream &operator <<(std::ostream &stream, const Chunk &chunk)
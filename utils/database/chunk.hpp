@@ -1,10 +1,21 @@
 #pragma once
 #include "forward.hpp"
+#include "format.hpp"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace DB
 {
 
+    // A part of the file, with a two letter type saying what it holds.
+    // Row data ("RD") and text pages ("TX") of tables that ask for it
+    // are compressed (as "RZ" and "TZ") once nothing more is added to
+    // them, see `DataBase::compress_chunk`. These read the same as any
+    // other chunk, being decompressed once when first read, and are
+    // moved to the end of the file uncompressed when written to.
     class Chunk
     {
         friend DataBase;
@@ -16,7 +27,7 @@ namespace DB
 
         inline std::string_view type() const { return std::string_view(m_type, 2); }
         inline size_t data_offset() const { return m_data_offset; }
-        inline size_t size_in_bytes() const { return m_size_in_bytes; }
+        inline size_t size_in_bytes() const { return m_is_compressed ? m_raw_size : m_size_in_bytes; }
         inline size_t padding_in_bytes() const { return m_padding_in_bytes; }
         inline size_t owner_id() const { return m_owner_id; }
         inline size_t index() const { return m_index; }
@@ -25,15 +36,20 @@ namespace DB
         size_t header_size() const;
         bool is_active() const;
 
+        inline bool is_compressed() const { return m_is_compressed; }
+        inline size_t compressed_size() const { return m_size_in_bytes; }
+
         uint8_t read_byte(size_t offset);
         int read_int(size_t offset);
         int64_t read_long(size_t offset);
         std::string read_string(size_t offset, size_t len);
+        void read_bytes(size_t offset, char *buffer, size_t len);
 
         void write_byte(size_t offset, uint8_t);
         void write_int(size_t offset, int);
         void write_long(size_t offset, int64_t);
         void write_string(size_t offset, const std::string&);
+        void write_bytes(size_t offset, const char *buffer, size_t len);
         void shrink_to(size_t offset);
         void drop();
 
@@ -46,6 +62,17 @@ namespace DB
             : m_db(db) {}
 
         void check_size(size_t size);
+        void write_sizes();
+        Format::ChunkHeader header() const;
+
+        // The type of this chunk once compressed, or uncompressed again
+        static std::string_view compressed_type(std::string_view type);
+        static std::string_view uncompressed_type(std::string_view type);
+
+        // Find out if a loaded chunk is compressed, and how big it is uncompressed
+        void load_compression();
+        const char *raw_data();
+        void read_raw(size_t offset, char *buffer, size_t len);
 
         DataBase &m_db;
         size_t m_header_offset;
@@ -54,10 +81,23 @@ namespace DB
         char m_type[2];
         size_t m_size_in_bytes { 0 };
         size_t m_padding_in_bytes { 0 };
-        uint8_t m_owner_id { 0xCD };
-        uint8_t m_index { 0xCD };
+        uint32_t m_owner_id { 0xCD };
+        uint32_t m_index { 0xCD };
         bool m_has_been_dropped { false };
 
+        // Compressed chunks start with their uncompressed size. The
+        // uncompressed data is kept once it's been read, and since
+        // chunks are read from many threads at once, it's only
+        // made while holding the mutex.
+        bool m_is_compressed { false };
+        size_t m_raw_size { 0 };
+        std::vector<char> m_raw_data;
+        std::atomic<bool> m_has_raw_data { false };
+        std::mutex m_raw_data_mutex;
+
+        // Where this chunk is listed in the directory, if it is
+        size_t m_directory_slot { SIZE_MAX };
+
     };
 
 }
@@ -1,5 +1,9 @@
 #include "config.hpp"
 #include "cleaner.hpp"
+#include "database.hpp"
+#include "index.hpp"
+#include "lz.hpp"
+#include <cstdio>
 #include <cassert>
 #include <fstream>
 #include <iostream>
@@ -25,15 +29,10 @@ Cleaner::Cleaner(const std::string &path)
     m_out_path = path.substr(0, last_dot_index);
     m_out_path += "_cleaned";
     m_out_path += path.substr(last_dot_index, path.size());
-}
 
-static void read_int(std::istream &in, size_t &out)
-{
-    out = 0;
-    out |= in.get() << 8*0;
-    out |= in.get() << 8*1;
-    out |= in.get() << 8*2;
-    out |= in.get() << 8*3;
+    m_upgrade_path = path.substr(0, last_dot_index);
+    m_upgrade_path += "_upgraded";
+    m_upgrade_path += path.substr(last_dot_index, path.size());
 }
 
 void Cleaner::output_info()
@@ -65,19 +64,47 @@ void Cleaner::output_info()
             print_chunk(chunk);
         }
         
+        std::cout << "\tSegments:\n";
+        for (const auto &chunk : table.segments)
+        {
+            std::cout << "\t\t";
+            print_chunk(chunk);
+        }
+
         std::cout << "\tDynamic Data:\n";
         for (const auto &chunk : table.dynamic)
         {
             std::cout << "\t\t";
             print_chunk(chunk);
         }
+
+        std::cout << "\tIndexes:\n";
+        for (const auto &chunk : table.indexes)
+        {
+            std::cout << "\t\t";
+            print_chunk(chunk);
+        }
+
+        std::cout << "\tZone Maps:\n";
+        for (const auto &chunk : table.zone_maps)
+        {
+            std::cout << "\t\t";
+            print_chunk(chunk);
+        }
+
+        std::cout << "\tDictionaries:\n";
+        for (const auto &chunk : table.dictionaries)
+        {
+            std::cout << "\t\t";
+            print_chunk(chunk);
+        }
     }
 }
 
 void Cleaner::process_data_base()
 {
     std::ifstream in(m_in_path, std::ifstream::binary);
-    auto find_table = [&](uint8_t id) -> Table&
+    auto find_table = [&](uint32_t id) -> Table&
     {
         for (auto &table : m_tables)
         {
@@ -88,36 +115,65 @@ void Cleaner::process_data_base()
         assert (false);
     };
     
+    // The version chunk at the start says how the rest is laid out
+    char start[Format::detect_size] = {};
+    in.read(start, sizeof(start));
+    m_format = Format(Format::detect(start));
+    in.clear();
+    in.seekg(0);
+
     size_t index = 0;
+    std::vector<Chunk> chunks;
+    std::vector<char> header_data(m_format.chunk_header_size());
     for (;;)
     {
-        char c = in.get();
-        if (c == (char)EOF)
+        if (!in.read(header_data.data(), header_data.size()))
             break;
 
+        auto header = m_format.decode_chunk_header(header_data.data());
         Chunk chunk;
         chunk.offset = index;
-        chunk.type[0] = c;
-        chunk.type[1] = in.get();
-        chunk.owner_id = in.get();
-        chunk.index = in.get();
-        read_int(in, chunk.size_in_bytes);
-        read_int(in, chunk.padding_in_bytes);
+        memcpy(chunk.type, header.type, 2);
+        chunk.owner_id = header.owner_id;
+        chunk.index = header.index;
+        chunk.size_in_bytes = header.size_in_bytes;
+        chunk.padding_in_bytes = header.padding_in_bytes;
+        chunks.push_back(chunk);
 
+        index += m_format.chunk_header_size();
+        index += chunk.size_in_bytes;
+        index += chunk.padding_in_bytes;
+        in.seekg(index);
+    }
+
+    // NOTE: A table's header can be moved past the rest of
+    //       its chunks, so they're all found first
+    for (const auto &chunk : chunks)
+    {
         auto type_str = std::string_view(chunk.type, 2);
         if (type_str == "VR")
             m_version = chunk;
         else if (type_str == "TH")
             m_tables.push_back({ chunk });
-        else if (type_str == "RD")
+    }
+
+    for (const auto &chunk : chunks)
+    {
+        auto type_str = std::string_view(chunk.type, 2);
+        if (type_str == "RD" || type_str == "RZ")
             find_table(chunk.owner_id).row_data.push_back(chunk);
-        else if (type_str == "DY")
+        else if (type_str == "CS")
+            find_table(chunk.owner_id).segments.push_back(chunk);
+        else if (type_str == "DY" || type_str == "TX" || type_str == "TZ" || type_str == "TM")
             find_table(chunk.owner_id).dynamic.push_back(chunk);
-
-        index += Config::chunk_header_size;
-        index += chunk.size_in_bytes;
-        index += chunk.padding_in_bytes;
-        in.seekg(index);
+        else if (type_str == "IX")
+            find_table(chunk.owner_id).indexes.push_back(chunk);
+        else if (type_str == "ZM")
+            find_table(chunk.owner_id).zone_maps.push_back(chunk);
+        else if (type_str == "DI")
+            find_table(chunk.owner_id).dictionaries.push_back(chunk);
+        else if (type_str == "DL")
+            find_table(chunk.owner_id).deleted_rows.push_back(chunk);
     }
 
     m_has_been_processed = true;
@@ -130,47 +186,142 @@ void Cleaner::full_clean_up()
     
     std::ifstream in(m_in_path, std::ifstream::binary);
     std::ofstream out(m_out_path, std::ifstream::binary);
+    // NOTE: The old padding is dropped, but chunks still
+    //       have to start where the format expects
+    auto header_size = m_format.chunk_header_size();
+    auto padding_for = [&](size_t size_in_bytes)
+    {
+        auto alignment = m_format.chunk_alignment();
+        return (alignment - (header_size + size_in_bytes) % alignment) % alignment;
+    };
+
     auto write_chunk_header = [&](const Chunk &chunk)
     {
-        auto write_int = [&](int i)
-        {
-            out.write(((char*)&i) + 0, 1);
-            out.write(((char*)&i) + 1, 1);
-            out.write(((char*)&i) + 2, 1);
-            out.write(((char*)&i) + 3, 1);
-        };
+        Format::ChunkHeader header;
+        memcpy(header.type, chunk.type, 2);
+        header.owner_id = chunk.owner_id;
+        header.index = chunk.index;
+        header.size_in_bytes = chunk.size_in_bytes;
+        header.padding_in_bytes = padding_for(chunk.size_in_bytes);
 
-        out.write(chunk.type, 2);
-        out.write((char*)&chunk.owner_id, 1);
-        out.write((char*)&chunk.index, 1);
-        write_int(chunk.size_in_bytes);
-        write_int(0); // NOTE: We ignore the padding
-        for (int i = 0; i < Config::chunk_header_size - 12; i++)
+        std::vector<char> data(header_size);
+        m_format.encode_chunk_header(header, data.data());
+        out.write(data.data(), data.size());
+    };
+
+    auto write_padding = [&](size_t size_in_bytes)
+    {
+        for (size_t i = 0; i < padding_for(size_in_bytes); i++)
             out.write("\0", 1);
-   };
+    };
+
+    auto copy_chunk_body = [&](const Chunk &chunk)
+    {
+        in.clear();
+        in.seekg(chunk.offset + header_size, std::ifstream::beg);
+
+        std::vector<char> data(chunk.size_in_bytes);
+        in.read(data.data(), data.size());
+        out.write(data.data(), data.size());
+    };
 
-    auto copy_chunk_body = [&](const Chunk &chunk, bool is_row_data = false)
+    auto read_chunk_body = [&](const Chunk &chunk)
     {
         in.clear();
-        in.seekg(chunk.offset + Config::chunk_header_size, std::ifstream::beg);
+        in.seekg(chunk.offset + header_size, std::ifstream::beg);
 
-        auto count = ((int)chunk.size_in_bytes) - (is_row_data ? 1 : 0);
-        for (int i = 0; i < count; i++)
+        std::vector<char> data(chunk.size_in_bytes);
+        in.read(data.data(), data.size());
+        return data;
+    };
+
+    // Compressed row data starts with its size uncompressed
+    auto raw_size_of = [&](const Chunk &chunk) -> size_t
+    {
+        if (std::string_view(chunk.type, 2) != "RZ")
+            return chunk.size_in_bytes;
+
+        int64_t raw_size;
+        in.clear();
+        in.seekg(chunk.offset + header_size, std::ifstream::beg);
+        in.read((char*)&raw_size, sizeof(raw_size));
+        return (size_t)raw_size;
+    };
+
+    auto read_row_data = [&](const Chunk &chunk)
+    {
+        auto data = read_chunk_body(chunk);
+        if (std::string_view(chunk.type, 2) != "RZ")
+            return data;
+
+        int64_t raw_size;
+        memcpy(&raw_size, data.data(), sizeof(raw_size));
+        std::vector<char> raw(raw_size);
+        if (!LZ::decompress(data.data() + sizeof(raw_size), data.size() - sizeof(raw_size), raw.data(), raw.size()))
+            std::cerr << "Could not decompress row data of table " << chunk.owner_id << "\n";
+        return raw;
+    };
+
+    auto write_chunk = [&](const Chunk &chunk, const std::vector<char> &data)
+    {
+        write_chunk_header(chunk);
+        out.write(data.data(), data.size());
+        write_padding(chunk.size_in_bytes);
+    };
+
+    // Write a chunk compressed as `compressed_type`, if that's worth it
+    auto write_compressed_chunk = [&](Chunk chunk, const char *compressed_type, const std::vector<char> &data)
+    {
+        auto compressed = LZ::compress(data.data(), data.size());
+        if (sizeof(int64_t) + compressed.size() > data.size() - data.size() / Config::compression_min_saving)
         {
-            char c = in.get();
-            out.write(&c, 1);
+            chunk.size_in_bytes = data.size();
+            write_chunk(chunk, data);
+            return;
         }
+
+        int64_t raw_size = data.size();
+        std::vector<char> body(sizeof(raw_size) + compressed.size());
+        memcpy(body.data(), &raw_size, sizeof(raw_size));
+        memcpy(body.data() + sizeof(raw_size), compressed.data(), compressed.size());
+
+        memcpy(chunk.type, compressed_type, 2);
+        chunk.size_in_bytes = body.size();
+        write_chunk(chunk, body);
     };
 
-    if (m_version)
+    // The row count and its flags, from a table's header
+    auto read_table_header = [&](const Chunk &header)
     {
-        write_chunk_header(*m_version);
-        copy_chunk_body(*m_version);
-    }
+        auto data = read_chunk_body(header);
+        auto row_count_size = m_format.has_wide_ids() ? sizeof(int64_t) : sizeof(int);
+
+        size_t offset = 1 + (uint8_t)data[0];
+        auto column_count = (uint8_t)data[offset];
+        int64_t row_count = 0;
+        memcpy(&row_count, data.data() + offset + 1, row_count_size);
+        offset += 1 + row_count_size;
+        for (size_t i = 0; i < column_count; i++)
+            offset += 1 + (uint8_t)data[offset] + 2;
+
+        // NOTE: Older headers end before the flags
+        uint8_t flags = offset < data.size() ? data[offset] : 0;
+        return std::make_tuple((size_t)row_count, (bool)(flags & 1), (bool)(flags & 2));
+    };
+
+    auto copy_chunk = [&](const Chunk &chunk)
+    {
+        write_chunk_header(chunk);
+        copy_chunk_body(chunk);
+        write_padding(chunk.size_in_bytes);
+    };
+
+    if (m_version)
+        copy_chunk(*m_version);
 
     for (auto &table : m_tables)
     {
-        auto sort_chunks = [&](auto collection)
+        auto sort_chunks = [&](auto &collection)
         {
             std::sort(collection.begin(), collection.end(),
                 [&](const auto &a, const auto &b)
@@ -180,32 +331,217 @@ void Cleaner::full_clean_up()
         };
 
         // Write table header and sort sub-chunks
-        write_chunk_header(table.header);
-        copy_chunk_body(table.header);
+        copy_chunk(table.header);
         sort_chunks(table.row_data);
+        sort_chunks(table.segments);
         sort_chunks(table.dynamic);
 
-        // Create new coallated row data chunk
-        Chunk coallated_row_data;
-        coallated_row_data.type[0] = 'R';
-        coallated_row_data.type[1] = 'D';
-        coallated_row_data.owner_id = table.header.owner_id;
-        coallated_row_data.index = 0;
-        coallated_row_data.size_in_bytes = 0;
-        for (const auto chunk : table.row_data)
-            coallated_row_data.size_in_bytes += chunk.size_in_bytes - 1;
-        coallated_row_data.padding_in_bytes = 0;
-
-        // Write row data to new chunk
-        write_chunk_header(coallated_row_data);
-        for (const auto &chunk : table.row_data)
-            copy_chunk_body(chunk, true);
+        auto [row_count, is_compressed, is_columnar] = read_table_header(table.header);
+        Chunk row_data_chunk;
+        row_data_chunk.owner_id = table.header.owner_id;
+        row_data_chunk.index = 0;
+        row_data_chunk.padding_in_bytes = 0;
+
+        if (is_columnar)
+        {
+            // Segments are a fixed size, so they're kept as they are,
+            // other than the ones rows have all been removed from
+            for (const auto &chunk : table.segments)
+            {
+                int64_t count;
+                in.clear();
+                in.seekg(chunk.offset + header_size, std::ifstream::beg);
+                in.read((char*)&count, sizeof(count));
+                if (count > 0)
+                    copy_chunk(chunk);
+            }
+        }
+        else if (!is_compressed)
+        {
+            // Create new coallated row data chunk
+            Chunk coallated_row_data = row_data_chunk;
+            coallated_row_data.type[0] = 'R';
+            coallated_row_data.type[1] = 'D';
+            coallated_row_data.size_in_bytes = 0;
+            for (const auto chunk : table.row_data)
+                coallated_row_data.size_in_bytes += chunk.size_in_bytes;
+
+            // Write row data to new chunk
+            write_chunk_header(coallated_row_data);
+            for (const auto &chunk : table.row_data)
+                copy_chunk_body(chunk);
+            write_padding(coallated_row_data.size_in_bytes);
+        }
+        else
+        {
+            // NOTE: Reading a row decompresses the whole chunk it's in, so
+            //       rather than joining them all, rows are split into
+            //       chunks of one zone's worth each
+            size_t row_data_size = 0;
+            for (const auto &chunk : table.row_data)
+                row_data_size += raw_size_of(chunk);
+
+            auto row_size = row_count > 0 ? row_data_size / row_count : row_data_size;
+            auto bytes_per_chunk = std::max<size_t>(row_size * Config::zone_map_rows, 1);
+            memcpy(row_data_chunk.type, "RD", 2);
+
+            std::vector<char> rows;
+            auto write_rows = [&](size_t size)
+            {
+                write_compressed_chunk(row_data_chunk, "RZ", std::vector<char>(rows.begin(), rows.begin() + size));
+                rows.erase(rows.begin(), rows.begin() + size);
+                row_data_chunk.index += 1;
+            };
+
+            for (const auto &chunk : table.row_data)
+            {
+                auto data = read_row_data(chunk);
+                rows.insert(rows.end(), data.begin(), data.end());
+                while (rows.size() >= bytes_per_chunk)
+                    write_rows(bytes_per_chunk);
+            }
+
+            if (!rows.empty())
+                write_rows(rows.size());
+        }
 
-        // Write dynamic chunks in order
+        // Write dynamic chunks in order. Text pages of compressed tables
+        // are compressed, other than the last one, which new values go
+        // in. Pages are numbered in order from 0 at their start.
+        int page_count = 0;
         for (const auto &chunk : table.dynamic)
         {
-            write_chunk_header(chunk);
-            copy_chunk_body(chunk);
+            auto type = std::string_view(chunk.type, 2);
+            if (type == "TX" || type == "TZ")
+                page_count += 1;
+        }
+
+        for (const auto &chunk : table.dynamic)
+        {
+            if (!is_compressed || std::string_view(chunk.type, 2) != "TX")
+            {
+                copy_chunk(chunk);
+                continue;
+            }
+
+            auto data = read_chunk_body(chunk);
+            int page_number;
+            memcpy(&page_number, data.data(), sizeof(page_number));
+            if (page_number == page_count - 1)
+                write_chunk(chunk, data);
+            else
+                write_compressed_chunk(chunk, "TZ", data);
+        }
+
+        // Row order is kept, so indexes can be copied as they are
+        for (const auto &chunk : table.indexes)
+            copy_chunk(chunk);
+
+        // Codes in rows are kept too, so dictionaries are as well
+        for (const auto &chunk : table.dictionaries)
+            copy_chunk(chunk);
+
+        // Deleted rows are still in place, and are purged below
+        for (const auto &chunk : table.deleted_rows)
+            copy_chunk(chunk);
+    }
+
+    // NOTE: Zone maps refer to row data chunks, which have all
+    //       been joined into one, so they're made again from the rows.
+    //       This is also when deleted rows are removed for good.
+    in.close();
+    out.close();
+    auto db = DataBase::open(m_out_path);
+    if (!db)
+    {
+        std::cerr << "Could not open '" << m_out_path << "' to make its zone maps\n";
+        return;
+    }
+
+    db->begin_transaction();
+    for (auto &table : db->tables())
+    {
+        table.build_zone_map();
+        table.purge_deleted_rows();
+    }
+    db->commit_transaction();
+}
+
+static std::unique_ptr<Entry> copy_entry(const Entry &entry)
+{
+    switch (entry.data_type().primitive())
+    {
+        case DataType::Integer: return std::make_unique<IntegerEntry>(entry.as_int());
+        case DataType::BigInt: return std::make_unique<BigIntEntry>(entry.as_long());
+        case DataType::Float: return std::make_unique<FloatEntry>(entry.as_float());
+        case DataType::Char: return std::make_unique<CharEntry>(entry.as_string());
+        case DataType::Text: return std::make_unique<CharEntry>(entry.as_string());
+        default:
+            assert (false);
+            return nullptr;
+    }
+}
+
+void Cleaner::upgrade()
+{
+    auto in = DataBase::open(m_in_path);
+    if (!in)
+    {
+        std::cerr << "Could not open '" << m_in_path << "'\n";
+        return;
+    }
+
+    if (in->format().version() == Config::major_version)
+    {
+        std::cout << "Already in the current format\n";
+        return;
+    }
+
+    // NOTE: The layout of rows changes between versions, so rather than
+    //       copying chunks, everything is read and written back through
+    //       the database itself
+    std::remove(m_upgrade_path.c_str());
+    std::remove((m_upgrade_path + "-wal").c_str());
+    auto out = DataBase::open(m_upgrade_path);
+    if (!out)
+    {
+        std::cerr << "Could not create '" << m_upgrade_path << "'\n";
+        return;
+    }
+
+    out->begin_transaction();
+    for (auto &table : in->tables())
+    {
+        DB::Table::Constructor constructor(table.name());
+        constructor.set_columnar(table.is_columnar());
+        for (const auto &column : table.columns())
+        {
+            // Old TEXT columns point at dynamic chunks, new ones use the text heap
+            auto type = column.data_type();
+            if (type.primitive() == DataType::Text)
+                type = DataType::text();
+            constructor.add_column(column.name(), type);
+        }
+
+        auto &new_table = out->construct_table(constructor);
+        for (size_t i = 0; i < table.row_count(); i++)
+        {
+            auto row = table.get_row(i);
+            if (!row)
+                continue;
+
+            auto new_row = new_table.make_row();
+            for (const auto &[name, entry] : *row)
+            {
+                if (!entry->is_null())
+                    new_row[name]->set(copy_entry(*entry));
+            }
+            new_table.add_row(std::move(new_row));
         }
+
+        // Indexes are built again from the new rows
+        for (const auto &index : table.indexes())
+            new_table.create_index(index->name(), index->column_name());
     }
+    out->commit_transaction();
 }
@@ -1,4 +1,5 @@
 #pragma once
+#include "format.hpp"
 #include <string>
 #include <vector>
 #include <optional>
@@ -14,14 +15,17 @@ namespace DB
         void output_info();
         void full_clean_up();
 
+        // Copy everything into a new file in the current format
+        void upgrade();
+
     private:
         struct Chunk
         {
             size_t offset;
 
             char type[2];
-            uint8_t owner_id;
-            uint8_t index;
+            uint32_t owner_id;
+            uint32_t index;
             size_t size_in_bytes;
             size_t padding_in_bytes;
         };
@@ -30,13 +34,20 @@ namespace DB
         {
             Chunk header;
             std::vector<Chunk> row_data;
+            std::vector<Chunk> segments;
             std::vector<Chunk> dynamic;
+            std::vector<Chunk> indexes;
+            std::vector<Chunk> zone_maps;
+            std::vector<Chunk> dictionaries;
+            std::vector<Chunk> deleted_rows;
         };
 
         void process_data_base();
         
         std::string m_in_path;
         std::string m_out_path;
+        std::string m_upgrade_path;
+        Format m_format { 1 };
         
         bool m_has_been_processed { false };
         std::vector<Table> m_tables;
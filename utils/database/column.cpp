@@ -1,15 +1,48 @@
 #include "column.hpp"
+#include "dictionary.hpp"
 #include <cassert>
+#include <cstring>
 #include <iostream>
 using namespace DB;
 
-std::unique_ptr<Entry> Column::read(Chunk &chunk, size_t offset) const
+std::unique_ptr<Entry> Column::decode(Table &table, const char *row) const
 {
     std::unique_ptr<Entry> entry = null();
-    entry->read(chunk, offset);
+    entry->decode(table, row + m_offset, is_null(row));
     return entry;
 }
 
+std::string_view Column::char_value(const char *row) const
+{
+    assert (m_data_type.primitive() == DataType::Char);
+
+    auto data = row + m_offset;
+    if (m_dictionary)
+    {
+        uint32_t code;
+        memcpy(&code, data, sizeof(code));
+        return m_dictionary->value(code);
+    }
+
+    return std::string_view(data, strnlen(data, m_data_type.length()));
+}
+
+bool Column::is_null(const char *row) const
+{
+    return (row[m_null_offset] & m_null_mask) != 0;
+}
+
+void Column::set_null(char *row, bool is_null) const
+{
+    auto &flags = row[m_null_offset];
+    if (m_null_mask == 0xFF)
+        flags = is_null;
+    else if (is_null)
+        flags |= m_null_mask;
+    else
+        flags &= ~m_null_mask;
+}
+
 std::unique_ptr<Entry> Column::null() const
 {
     switch (m_data_type.primitive())
@@ -17,8 +50,11 @@ std::unique_ptr<Entry> Column::null() const
         case DataType::Integer: return std::make_unique<IntegerEntry>();
         case DataType::BigInt: return std::make_unique<BigIntEntry>();
         case DataType::Float: return std::make_unique<FloatEntry>();
-        case DataType::Char: return std::make_unique<CharEntry>(m_data_type.length());
-        case DataType::Text: return std::make_unique<TextEntry>();
+        case DataType::Char:
+            if (m_dictionary)
+                return std::make_unique<CharEntry>(m_data_type.length(), m_dictionary);
+            return std::make_unique<CharEntry>(m_data_type.length());
+        case DataType::Text: return std::make_unique<TextEntry>(m_data_type);
         default:
             // TODO: Error
             assert (false);
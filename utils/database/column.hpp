@@ -3,6 +3,7 @@
 #include "entry.hpp"
 #include <memory>
 #include <string>
+#include <string_view>
 
 namespace DB
 {
@@ -10,14 +11,28 @@ namespace DB
     class Column
     {
         friend Table;
+        friend Sql::Aggregation;
 
     public:
         inline const std::string &name() const { return m_name; }
         inline DataType data_type() const { return m_data_type; }
-        
-        std::unique_ptr<Entry> read(Chunk &chunk, size_t offset) const;
+
+        // Where the column's data is in an encoded row, its
+        // 'is null' flag is kept apart from it
+        inline size_t offset() const { return m_offset; }
+        bool is_null(const char *row) const;
+        void set_null(char *row, bool is_null) const;
+
+        std::unique_ptr<Entry> decode(Table &table, const char *row) const;
         std::unique_ptr<Entry> null() const;
 
+        // Only Char columns made with `DataType::dictionary_char` have one
+        inline const Dictionary *dictionary() const { return m_dictionary.get(); }
+
+        // The value of a Char column in an encoded row, up to its first
+        // null byte. It may be a view of the column's dictionary.
+        std::string_view char_value(const char *row) const;
+
     private:
         Column(std::string name, DataType data_type)
             : m_name(name)
@@ -26,6 +41,13 @@ namespace DB
         std::string m_name;
         DataType m_data_type;
 
+        // Set up by the table, a mask of 0xFF means the
+        // flag has a byte of its own
+        size_t m_offset { 0 };
+        size_t m_null_offset { 0 };
+        uint8_t m_null_mask { 0xFF };
+        std::shared_ptr<Dictionary> m_dictionary;
+
     };
 
 }
@@ -1,17 +1,84 @@
 #pragma once
+#include <cstddef>
 
 // Debugging flags
 // #define DEBUG_CHUNKS
 // #define DEBUG_TABLE_LOAD
 // #define DEBUG_SQL
+// #define DEBUG_WAL
 
 namespace DB::Config
 {
 
-    static int constexpr major_version = 1;
+    // New files are made in this version of the format,
+    // see `Format` for how the versions differ
+    static int constexpr major_version = 2;
     static int constexpr minor_version = 0;
 
-    static int constexpr chunk_header_size = 20;
+    // Rows in version 1 files start with a header
     static int constexpr row_header_size = 4;
 
+    // The directory chunk lists every chunk in the file, so it can be
+    // opened without reading each chunk header. Where it is is kept in
+    // the reserved part of the version chunk's header.
+    static size_t constexpr directory_min_capacity = 64;
+
+    // Size of a B+-tree node in an index chunk
+    static size_t constexpr index_node_size = 512;
+
+    // Size of a page of TEXT values, bigger values get a page of their own
+    static size_t constexpr text_page_size = 4096;
+
+    // Size of the pages kept in the buffer pool
+    static size_t constexpr page_size = 4096;
+
+    // Once the write-ahead log gets this big, it's written back
+    // to the database and truncated
+    static size_t constexpr wal_checkpoint_size = 4 * 1024 * 1024;
+
+    // How many parsed statements are kept, by their SQL text
+    static size_t constexpr statement_cache_size = 64;
+
+    // Size of the first block of memory in an arena, which a parsed
+    // statement or a scan's filter usually fits in, so it's the only
+    // block the arena needs
+    static size_t constexpr arena_block_size = 2048;
+
+    // How many rows a full table scan reads at once
+    static size_t constexpr scan_batch_size = 64;
+
+    // Full scans of tables with at least this many rows are split into
+    // morsels of at most `scan_morsel_size` rows, each filtered on its
+    // own thread
+    static size_t constexpr parallel_scan_min_rows = 8192;
+    static size_t constexpr scan_morsel_size = 4096;
+
+    // Row data chunks keep the range of values in each block of this
+    // many rows, the same as a morsel so each can be skipped whole
+    static size_t constexpr zone_map_rows = scan_morsel_size;
+
+    // Columnar tables keep their rows in segments of this many, each
+    // with every column's values together. It's a block of the zone
+    // map, so the values of a block can be read a column at a time.
+    static size_t constexpr columnar_segment_rows = zone_map_rows;
+
+    // How much memory sorting rows can use before they're written out
+    // to temporary files in sorted runs, and merged back at the end
+    static size_t constexpr sort_memory_budget = 16 * 1024 * 1024;
+
+    // Row data chunks of compressed tables are only compressed once
+    // they're at least this big, as smaller ones aren't worth it
+    static size_t constexpr compression_min_chunk_size = 16 * 1024;
+
+    // Reading from a compressed chunk decompresses all of it, so it's
+    // only kept compressed if that saves at least one part in this many
+    static size_t constexpr compression_min_saving = 8;
+
+    // How many rows COPY adds to a table at once. Each batch is written
+    // in one go, but the whole COPY is committed or rolled back together.
+    static size_t constexpr bulk_load_batch_size = 16384;
+
+    // How much the file mapping is extended by when it runs out of room
+    static size_t constexpr mapping_grow_size = 1024 * 1024;
+
 }
@@ -1,31 +1,38 @@
 #include "config.hpp"
 #include "chunk.hpp"
 #include "database.hpp"
+#include "filelock.hpp"
+#include "mappedstorage.hpp"
+#include "bufferpool.hpp"
+#include "lz.hpp"
 #include "sql/parser.hpp"
+#include "sql/select.hpp"
 #include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <fstream>
-#include <filesystem>
+#include <thread>
 using namespace DB;
 
-std::shared_ptr<Chunk> DataBase::new_chunk(std::string_view type, uint8_t owner_id, uint8_t index)
+std::shared_ptr<Chunk> DataBase::new_chunk(std::string_view type, uint32_t owner_id, uint32_t index)
 {
+    // NOTE: This may move the directory to the end of the file,
+    //       so do it first to make sure the new chunk is active
+    if (m_directory_chunk && type != "DR")
+        reserve_directory_entry();
+    align_end_of_data();
+
     auto chunk = std::shared_ptr<Chunk>(new Chunk(*this));
     memcpy(chunk->m_type, type.data(), 2);
     chunk->m_owner_id = owner_id;
     chunk->m_index = index;
     chunk->m_header_offset = m_end_of_data_pointer;
-    write_byte(chunk->m_header_offset + 0, type[0]);
-    write_byte(chunk->m_header_offset + 1, type[1]);
-    write_byte(chunk->m_header_offset + 2, owner_id);
-    write_byte(chunk->m_header_offset + 3, index);
-    write_int(chunk->m_header_offset + 4, 0);
-    write_int(chunk->m_header_offset + 8, 0);
-    write_int(chunk->m_header_offset + 12, 0);
-    write_int(chunk->m_header_offset + 16, 0);
-
-    chunk->m_data_offset = chunk->m_header_offset + Config::chunk_header_size;
+
+    std::vector<char> header(m_format.chunk_header_size());
+    m_format.encode_chunk_header(chunk->header(), header.data());
+    write_bytes(chunk->m_header_offset, header.data(), header.size());
+
+    chunk->m_data_offset = chunk->m_header_offset + m_format.chunk_header_size();
 #ifdef DEBUG_CHUNKS
     std::cout << "New chunk { type = " << type <<
         ", header_offset = " << chunk->m_header_offset <<
@@ -35,9 +42,94 @@ std::shared_ptr<Chunk> DataBase::new_chunk(std::string_view type, uint8_t owner_
 
     m_chunks.push_back(chunk);
     m_active_chunk = m_chunks.back();
+    m_last_chunk = chunk;
+
+    if (m_directory_chunk && type != "DR")
+    {
+        chunk->m_directory_slot = m_directory_entry_count;
+        m_directory_entry_count += 1;
+        m_directory_chunk->write_int(0, m_directory_entry_count);
+        write_directory_entry(*chunk);
+    }
+
     return m_chunks.back();
 }
 
+std::shared_ptr<Chunk> DataBase::compress_chunk(std::shared_ptr<Chunk> chunk)
+{
+    auto type = Chunk::compressed_type(chunk->type());
+    if (type == chunk->type() || chunk->is_active())
+        return chunk;
+
+    std::vector<char> data(chunk->size_in_bytes());
+    chunk->read_bytes(0, data.data(), data.size());
+    auto compressed = LZ::compress(data.data(), data.size());
+
+    if (sizeof(int64_t) + compressed.size() > data.size() - data.size() / Config::compression_min_saving)
+        return chunk;
+
+    auto compressed_chunk = new_chunk(type, chunk->owner_id(), chunk->index());
+    compressed_chunk->write_long(0, data.size());
+    compressed_chunk->write_bytes(sizeof(int64_t), compressed.data(), compressed.size());
+    compressed_chunk->m_is_compressed = true;
+    compressed_chunk->m_raw_size = data.size();
+
+    chunk->drop();
+    return compressed_chunk;
+}
+
+void DataBase::expand_chunk(Chunk &chunk)
+{
+    assert (chunk.is_compressed() && !chunk.m_has_been_dropped);
+    std::vector<char> data(chunk.size_in_bytes());
+    chunk.read_bytes(0, data.data(), data.size());
+
+    // NOTE: The old copy is left behind, dropped, for the cleaner
+    //       to remove. Nothing else refers to it, as the chunk's
+    //       directory entry is moved to the new copy.
+    write_bytes(chunk.m_header_offset, "RM", 2);
+    align_end_of_data();
+
+    auto type = Chunk::uncompressed_type(chunk.type());
+    memcpy(chunk.m_type, type.data(), 2);
+    chunk.m_is_compressed = false;
+    chunk.m_raw_size = 0;
+    chunk.m_raw_data = {};
+    chunk.m_has_raw_data = false;
+    chunk.m_header_offset = m_end_of_data_pointer;
+    chunk.m_data_offset = chunk.m_header_offset + m_format.chunk_header_size();
+    chunk.m_size_in_bytes = 0;
+    chunk.m_padding_in_bytes = 0;
+
+    std::vector<char> header(m_format.chunk_header_size());
+    m_format.encode_chunk_header(chunk.header(), header.data());
+    write_bytes(chunk.m_header_offset, header.data(), header.size());
+
+    auto it = std::find_if(m_chunks.begin(), m_chunks.end(),
+        [&](const auto &other) { return other.get() == &chunk; });
+    assert (it != m_chunks.end());
+    m_active_chunk = *it;
+    m_last_chunk = *it;
+
+    chunk.write_bytes(0, data.data(), data.size());
+    write_directory_entry(chunk);
+}
+
+void DataBase::align_end_of_data()
+{
+    // NOTE: Chunks start on an aligned offset, so the chunk before
+    //       is padded out to where the new one will start
+    auto alignment = m_format.chunk_alignment();
+    auto gap = (alignment - m_end_of_data_pointer % alignment) % alignment;
+    if (gap == 0 || !m_last_chunk)
+        return;
+
+    std::vector<char> fill(gap, 0);
+    write_bytes(m_end_of_data_pointer, fill.data(), fill.size());
+    m_last_chunk->m_padding_in_bytes += gap;
+    m_last_chunk->write_sizes();
+}
+
 void DataBase::check_is_active_chunk(Chunk *chunk)
 {
     // NOTE: We have to be the active chunk to append data
@@ -46,39 +138,409 @@ void DataBase::check_is_active_chunk(Chunk *chunk)
 
 std::shared_ptr<DataBase> DataBase::open(const std::string& path)
 {
-    FILE *file;
+    auto storage = MappedStorage::open(path);
+    if (!storage)
+        return nullptr;
 
-    if (!std::filesystem::exists(path))
-        file = fopen(path.c_str(), "w+b");
-    else
-        file = fopen(path.c_str(), "r+b");
+    return create(path, std::move(storage));
+}
 
-    if (!file)
-    {
-        perror("fopen()");
+std::shared_ptr<DataBase> DataBase::open_cached(const std::string &path, size_t page_count)
+{
+    auto storage = BufferPool::open(path, page_count);
+    if (!storage)
         return nullptr;
+
+    return create(path, std::move(storage));
+}
+
+std::shared_ptr<DataBase> DataBase::create(const std::string &path, std::unique_ptr<Storage> storage)
+{
+    auto wal = WriteAheadLog::open(path + "-wal", *storage, FileLock::open(path));
+    if (!wal)
+        return nullptr;
+
+    return std::shared_ptr<DataBase>(new DataBase(std::move(storage), std::move(wal)));
+}
+
+DataBase::DataBase(std::unique_ptr<Storage> storage, std::unique_ptr<WriteAheadLog> wal)
+    : m_storage(std::move(storage))
+    , m_wal(std::move(wal))
+    , m_thread_count(std::max<size_t>(std::thread::hardware_concurrency(), 1))
+{
+    m_wal->recover();
+    m_wal->begin_read();
+    m_wal->refresh();
+    load();
+    m_wal->end_read();
+
+    // NOTE: The directory can only be found from a version chunk
+    //       at the start of the file
+    auto is_set_up = [this]()
+    {
+        return m_version_chunk &&
+            (m_directory_chunk || m_version_chunk->m_header_offset != 0);
+    };
+
+    if (is_set_up())
+        return;
+
+    // NOTE: Another process may have set it up while we waited
+    begin_write();
+    if (!m_version_chunk)
+        write_version_chunk();
+    if (!m_directory_chunk && m_version_chunk->m_header_offset == 0)
+        build_directory();
+    if (!commit())
+        rollback();
+    end_write();
+}
+
+void DataBase::load()
+{
+    m_end_of_data_pointer = m_wal->end_of_data();
+    m_committed_end_of_data = m_end_of_data_pointer;
+
+    // NOTE: New files are made in the current format, otherwise
+    //       the version chunk at the start says which one it is
+    if (m_end_of_data_pointer >= Format::detect_size)
+    {
+        char start[Format::detect_size];
+        read_string(0, start, sizeof(start));
+        m_format = Format(Format::detect(start));
+        assert (m_format.version() <= Config::major_version);
+    }
+    load_chunks();
+}
+
+void DataBase::refresh()
+{
+    // NOTE: Another process has committed since we last looked,
+    //       so everything we know about the file may be out of date
+    if (m_wal->refresh())
+        load();
+}
+
+bool DataBase::begin_read()
+{
+    // NOTE: The thread in a transaction already has it to itself
+    if (is_transaction_thread())
+        return false;
+
+    {
+        std::lock_guard<std::mutex> gate(m_write_gate);
+    }
+    m_mutex.lock_shared();
+    m_wal->begin_read();
+    if (!m_wal->has_changed())
+        return true;
+
+    m_wal->end_read();
+    m_mutex.unlock_shared();
+    {
+        auto lock = lock_for_writing();
+        m_wal->begin_read();
+        refresh();
+        m_wal->end_read();
+    }
+
+    return begin_read();
+}
+
+std::unique_lock<std::shared_mutex> DataBase::lock_for_writing()
+{
+    // NOTE: Readers wait at the gate while a writer is waiting,
+    //       so a steady stream of them can't keep it out forever
+    std::lock_guard<std::mutex> gate(m_write_gate);
+    return std::unique_lock<std::shared_mutex>(m_mutex);
+}
+
+void DataBase::end_read()
+{
+    m_wal->end_read();
+    m_mutex.unlock_shared();
+}
+
+void DataBase::begin_write()
+{
+    m_wal->begin_write();
+    refresh();
+}
+
+void DataBase::end_write()
+{
+    m_wal->end_write();
+}
+
+ReadLock::ReadLock(DataBase &db)
+    : m_db(db)
+    , m_is_locked(db.begin_read())
+{
+}
+
+ReadLock::~ReadLock()
+{
+    if (m_is_locked)
+        m_db.end_read();
+}
+
+void DataBase::load_chunks()
+{
+    auto old_tables = std::move(m_tables);
+    m_tables.clear();
+    m_chunks.clear();
+    m_active_chunk = nullptr;
+    m_last_chunk = nullptr;
+    m_version_chunk = nullptr;
+    m_directory_chunk = nullptr;
+    m_directory_entry_count = 0;
+
+    m_unowned_chunks.clear();
+    if (!load_directory())
+        walk_chunks();
+
+    // Every chunk should belong to a table
+    assert (m_unowned_chunks.empty());
+    m_unowned_chunks.clear();
+
+    // NOTE: Tables that are still there keep their old objects, given
+    //       what was just loaded, so pointers to them stay good
+    for (auto it = m_tables.begin(); it != m_tables.end();)
+    {
+        auto old_table = std::find_if(old_tables.begin(), old_tables.end(), [&](const Table &table)
+        {
+            return table.id() == it->id() && table.name() == it->name();
+        });
+        if (old_table == old_tables.end())
+        {
+            ++it;
+            continue;
+        }
+
+        old_table->reload(std::move(*it));
+        m_tables.splice(it, old_tables, old_table);
+        it = m_tables.erase(it);
     }
+}
 
-    return std::shared_ptr<DataBase>(new DataBase(file));
+void DataBase::load_chunk(std::shared_ptr<Chunk> chunk)
+{
+#ifdef DEBUG_CHUNKS
+    std::cout << "Loaded " << *chunk << "\n";
+#endif
+    chunk->load_compression();
+    m_chunks.push_back(chunk);
+
+    if (chunk->type() == "TH")
+    {
+        // TableHeader
+        m_tables.push_back(Table(*this, chunk));
+
+        // NOTE: A header may have been moved past the rest of
+        //       its table, which is then loaded once it's found
+        auto owner_id = chunk->owner_id();
+        auto it = std::stable_partition(m_unowned_chunks.begin(), m_unowned_chunks.end(),
+            [&](const auto &unowned) { return unowned->owner_id() != owner_id; });
+        std::vector<std::shared_ptr<Chunk>> owned(it, m_unowned_chunks.end());
+        m_unowned_chunks.erase(it, m_unowned_chunks.end());
+        for (auto &owned_chunk : owned)
+            add_to_owner(m_tables.back(), std::move(owned_chunk));
+        return;
+    }
+
+    if (chunk->type() == "VR")
+    {
+        // Version
+        m_version_chunk = chunk;
+        return;
+    }
+
+    auto *table = find_owner(chunk->owner_id());
+    if (!table)
+    {
+        m_unowned_chunks.push_back(std::move(chunk));
+        return;
+    }
+
+    add_to_owner(*table, std::move(chunk));
 }
 
-DataBase::DataBase(FILE *file)
-    : m_file(file)
+void DataBase::add_to_owner(Table &table, std::shared_ptr<Chunk> chunk)
 {
-    // Find file length
-    fseek(m_file, 0L, SEEK_END);
-    m_end_of_data_pointer = ftell(m_file);
-    rewind(m_file);
+    if (chunk->type() == "RD" || chunk->type() == "RZ" || chunk->type() == "CS")
+    {
+        // RowData
+        table.add_row_data(chunk);
+    }
+    else if (chunk->type() == "IX")
+    {
+        // Index
+        table.add_index(chunk);
+    }
+    else if (chunk->type() == "DY")
+    {
+        // Dynamic Data
+        table.add_dynamic_data(chunk);
+    }
+    else if (chunk->type() == "TX" || chunk->type() == "TZ")
+    {
+        // Text heap page
+        table.add_text_page(chunk);
+    }
+    else if (chunk->type() == "TM")
+    {
+        // Text heap map
+        table.set_text_map(chunk);
+    }
+    else if (chunk->type() == "ZM")
+    {
+        // Zone map
+        table.set_zone_map(chunk);
+    }
+    else if (chunk->type() == "DI")
+    {
+        // Char column dictionary
+        table.set_dictionary(chunk);
+    }
+    else if (chunk->type() == "DL")
+    {
+        // Deleted rows
+        table.set_deleted_rows(chunk);
+    }
+}
+
+bool DataBase::load_directory()
+{
+    // The version chunk is always first, and has
+    // the offset of the directory in its header
+    auto header_size = m_format.chunk_header_size();
+    auto entry_size = m_format.directory_entry_size();
+    if (m_end_of_data_pointer < header_size)
+        return false;
+
+    char type[2];
+    read_string(0, type, 2);
+    if (std::string_view(type, 2) != "VR")
+        return false;
+
+    auto directory_offset = (size_t)read_long(m_format.directory_offset_in_header());
+    if (directory_offset == 0 || directory_offset + header_size > m_end_of_data_pointer)
+        return false;
+
+    auto directory = std::shared_ptr<Chunk>(new Chunk(*this, directory_offset));
+    if (directory->type() != "DR" || directory->size_in_bytes() < 4)
+        return false;
+
+    std::vector<char> data(directory->size_in_bytes());
+    directory->read_bytes(0, data.data(), data.size());
+
+    uint32_t entry_count;
+    memcpy(&entry_count, data.data(), 4);
+    if (4 + entry_count * entry_size > data.size())
+        return false;
+
+    auto end_of_chunk = [&](const Chunk &chunk)
+    {
+        return chunk.m_header_offset + header_size +
+            chunk.m_size_in_bytes + chunk.m_padding_in_bytes;
+    };
+
+    std::vector<std::shared_ptr<Chunk>> chunks;
+    size_t end_of_data = end_of_chunk(*directory);
+    for (size_t i = 0; i < entry_count; i++)
+    {
+        uint64_t header_offset;
+        auto header = m_format.decode_directory_entry(data.data() + 4 + i * entry_size, header_offset);
+
+        auto chunk = std::shared_ptr<Chunk>(new Chunk(*this));
+        memcpy(chunk->m_type, header.type, 2);
+        chunk->m_owner_id = header.owner_id;
+        chunk->m_index = header.index;
+        chunk->m_header_offset = header_offset;
+        chunk->m_data_offset = header_offset + header_size;
+        chunk->m_size_in_bytes = header.size_in_bytes;
+        chunk->m_padding_in_bytes = header.padding_in_bytes;
+        chunk->m_directory_slot = i;
+        end_of_data = std::max(end_of_data, end_of_chunk(*chunk));
+        chunks.push_back(std::move(chunk));
+    }
 
-    // Load existing chunks
+    // NOTE: If anything was written without updating the directory,
+    //       the file will carry on past where it says the data ends
+    if (end_of_data > m_end_of_data_pointer)
+        return false;
+    if (end_of_data + header_size <= m_end_of_data_pointer)
+    {
+        read_string(end_of_data, type, 2);
+        if (std::string_view(type, 2) != std::string_view("\0\0", 2))
+            return false;
+    }
+
+    // NOTE: Anything past it is left for the log to cut back, as
+    //       other processes may be using it or have it mapped
+    if (end_of_data < m_end_of_data_pointer)
+    {
+        m_end_of_data_pointer = end_of_data;
+        m_committed_end_of_data = end_of_data;
+    }
+
+    // The directory is not listed in itself, so put it in its place
+    auto position = std::lower_bound(chunks.begin(), chunks.end(), directory_offset,
+        [](const auto &chunk, size_t offset) { return chunk->m_header_offset < offset; });
+    chunks.insert(position, directory);
+
+    // NOTE: Only the last chunk in the file can grow. That isn't always
+    //       the last one listed, as chunks that are expanded again are
+    //       moved to the end but keep their place in the directory.
+    m_last_chunk = *std::max_element(chunks.begin(), chunks.end(),
+        [](const auto &a, const auto &b) { return a->m_header_offset < b->m_header_offset; });
+
+    // Chunks don't overlap, so anything past the end of the last one
+    // means the directory has it wrong, and the file is walked instead
+    if (end_of_chunk(*m_last_chunk) != end_of_data)
+        return false;
+
+    m_active_chunk = (m_last_chunk->type() == "RM") ? nullptr : m_last_chunk;
+    for (auto &chunk : chunks)
+    {
+        if (chunk->type() == "RM")
+            continue;
+
+        if (chunk == directory)
+            m_chunks.push_back(chunk);
+        else
+            load_chunk(chunk);
+    }
+
+    m_directory_chunk = directory;
+    m_directory_entry_count = entry_count;
+    return true;
+}
+
+void DataBase::walk_chunks()
+{
     size_t offset = 0;
     while (offset < m_end_of_data_pointer)
     {
         auto chunk = std::shared_ptr<Chunk>(new Chunk(*this, offset));
+        if (chunk->type() == std::string_view("\0\0", 2))
+        {
+            // NOTE: If we didn't close cleanly, there may be reserved
+            //       space at the end of the file. Chunks always have a
+            //       type, so this is where the real data ends.
+            m_end_of_data_pointer = offset;
+            m_committed_end_of_data = offset;
+            break;
+        }
+
         offset += chunk->header_size() +
-            chunk->size_in_bytes() +
-            chunk->padding_in_bytes();
+            chunk->m_size_in_bytes +
+            chunk->m_padding_in_bytes;
+        m_last_chunk = chunk;
 
+        // NOTE: Only the last chunk in the file can grow, so
+        //       if that's been dropped, none of them can
+        m_active_chunk = nullptr;
         if (chunk->type() == "RM")
         {
 #ifdef DEBUG_CHUNKS
@@ -89,48 +551,82 @@ DataBase::DataBase(FILE *file)
             continue;
         }
 
-#ifdef DEBUG_CHUNKS
-        std::cout << "Loaded " << *chunk << "\n";
-#endif
-        if (chunk->type() == "TH")
+        // A directory we didn't trust is out of date, so a new one is made
+        if (chunk->type() == "DR")
         {
-            // TableHeader
-            m_tables.push_back(Table(*this, chunk));
+            chunk->drop();
+            continue;
         }
-        else if (chunk->type() == "RD")
-        {
-            // RowData
-            auto *table = find_owner(chunk->owner_id());
-            assert (table);
 
-            table->add_row_data(chunk);
-        }
-        else if (chunk->type() == "VR")
-        {
-            // Version
-            m_version_chunk = chunk;
-        }
-        else if (chunk->type() == "DY")
-        {
-            // Dynamic Data
-            auto *table = find_owner(chunk->owner_id());
-            assert (table);
+        load_chunk(chunk);
+        m_active_chunk = chunk;
+    }
+}
 
-            table->add_dynamic_data(chunk);
-        }
+void DataBase::build_directory()
+{
+    std::vector<std::shared_ptr<Chunk>> chunks;
+    for (const auto &chunk : m_chunks)
+    {
+        if (!chunk->m_has_been_dropped && chunk->type() != "DR")
+            chunks.push_back(chunk);
+    }
 
-        m_chunks.push_back(chunk);
-        m_active_chunk = chunk;
+    // Leave room to grow, as only the last chunk can
+    auto capacity = std::max(Config::directory_min_capacity, chunks.size() * 2);
+    std::vector<char> data(4 + capacity * m_format.directory_entry_size(), 0);
+    m_directory_chunk = new_chunk("DR", 0, 0);
+    m_directory_chunk->write_bytes(0, data.data(), data.size());
+
+    m_directory_entry_count = chunks.size();
+    m_directory_chunk->write_int(0, m_directory_entry_count);
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        chunks[i]->m_directory_slot = i;
+        write_directory_entry(*chunks[i]);
     }
 
-    if (!m_version_chunk)
-        write_version_chunk();
+    write_long(m_version_chunk->m_header_offset + m_format.directory_offset_in_header(),
+        m_directory_chunk->m_header_offset);
+}
+
+void DataBase::reserve_directory_entry()
+{
+    auto size = 4 + (m_directory_entry_count + 1) * m_format.directory_entry_size();
+    if (size <= m_directory_chunk->size_in_bytes())
+        return;
+
+    // NOTE: Only the active chunk can grow, otherwise the directory is
+    //       made again at the end, which also drops any removed chunks
+    if (m_directory_chunk->is_active())
+    {
+        std::vector<char> data(m_directory_chunk->size_in_bytes(), 0);
+        m_directory_chunk->write_bytes(m_directory_chunk->size_in_bytes(), data.data(), data.size());
+        return;
+    }
+
+    m_directory_chunk->drop();
+    for (auto &chunk : m_chunks)
+        chunk->m_directory_slot = SIZE_MAX;
+    build_directory();
+}
+
+void DataBase::write_directory_entry(Chunk &chunk)
+{
+    if (!m_directory_chunk || chunk.m_directory_slot == SIZE_MAX)
+        return;
+
+    std::vector<char> entry(m_format.directory_entry_size());
+    m_format.encode_directory_entry(chunk.m_header_offset, chunk.header(), entry.data());
+
+    auto offset = 4 + chunk.m_directory_slot * entry.size();
+    m_directory_chunk->write_bytes(offset, entry.data(), entry.size());
 }
 
 void DataBase::write_version_chunk()
 {
     m_version_chunk = new_chunk("VR", 0, 0);
-    m_version_chunk->write_byte(0, Config::major_version);
+    m_version_chunk->write_byte(0, m_format.version());
     m_version_chunk->write_byte(1, Config::minor_version);
 }
 
@@ -140,19 +636,184 @@ SqlResult DataBase::execute_sql(const std::string &query)
     std::cout << "DataBase: Executing SQL '" << query << "'\n";
 #endif
     
+    std::vector<std::string> errors;
+    auto statement = parse(query, errors);
+    if (!statement)
+    {
+        SqlResult result;
+        result.m_errors = std::move(errors);
+        return result;
+    }
+
+    if (statement->parameter_count() > 0)
+        return SqlResult::error("Statements with parameters have to be prepared first");
+
+    return execute_statement(*statement);
+}
+
+ResultCursor DataBase::query(const std::string &query)
+{
+    std::vector<std::string> errors;
+    auto statement = parse(query, errors);
+    if (!statement)
+        return ResultCursor(std::move(errors));
+
+    if (statement->parameter_count() > 0)
+        return ResultCursor({ "Statements with parameters have to be prepared first" });
+
+    return open_cursor(std::move(statement));
+}
+
+ResultCursor DataBase::open_cursor(std::shared_ptr<Sql::Statement> statement)
+{
+    if (statement->type() != Sql::Statement::Select)
+        return ResultCursor(execute_statement(*statement).m_errors);
+
+    auto read_lock = std::make_unique<ReadLock>(*this);
+    auto cursor = static_cast<const Sql::SelectStatement&>(*statement).open(*this);
+    cursor.m_read_lock = std::move(read_lock);
+    cursor.m_statement = std::move(statement);
+    return cursor;
+}
+
+PreparedStatement DataBase::prepare(const std::string &query)
+{
+    std::vector<std::string> errors;
+    auto statement = parse(query, errors);
+    if (!statement)
+        return PreparedStatement(*this, std::move(errors));
+
+    return PreparedStatement(*this, std::move(statement));
+}
+
+std::shared_ptr<Sql::Statement> DataBase::parse(const std::string &query, std::vector<std::string> &errors)
+{
+    auto statement = m_statement_cache.find(query);
+    if (statement)
+        return statement;
+
     Sql::Parser parser(query);
-    auto statement = parser.run();
+    statement = parser.run();
     if (!parser.good())
-        return parser.errors_as_result();
+    {
+        errors = parser.errors_as_result().m_errors;
+        return nullptr;
+    }
+
+    // NOTE: Values bound to parameters are kept in the statement, so
+    //       each prepared handle gets its own copy of ones that have them
+    if (statement->parameter_count() == 0)
+        m_statement_cache.insert(query, statement);
+    return statement;
+}
+
+SqlResult DataBase::execute_statement(Sql::Statement &statement)
+{
+    switch (statement.type())
+    {
+        case Sql::Statement::Select:
+        {
+            ReadLock lock(*this);
+            return statement.execute(*this);
+        }
 
-    return statement->execute(*this);
+        // NOTE: These lock for the whole transaction themselves
+        case Sql::Statement::Begin:
+        case Sql::Statement::Commit:
+        case Sql::Statement::Rollback:
+            return statement.execute(*this);
+
+        default:
+            break;
+    }
+
+    if (is_transaction_thread())
+        return statement.execute(*this);
+
+    // NOTE: A statement that fails part way through, like a COPY
+    //       with a bad line, leaves behind nothing it wrote
+    auto lock = lock_for_writing();
+    begin_write();
+    auto result = statement.execute(*this);
+    if (result.good() && !commit())
+        result = SqlResult::error("Could not write to the log, so nothing was changed");
+    if (!result.good() && m_wal->has_transaction())
+        rollback();
+    end_write();
+    return result;
 }
 
-uint8_t DataBase::generate_table_id()
+bool DataBase::commit()
 {
-    uint8_t max_id = 0;
+    if (!m_wal->commit(m_end_of_data_pointer))
+        return false;
+
+    m_committed_end_of_data = m_end_of_data_pointer;
+    return true;
+}
+
+void DataBase::rollback()
+{
+    // Throw away the changes, then reload everything
+    // as it was at the last commit
+    m_wal->rollback();
+    m_end_of_data_pointer = m_committed_end_of_data;
+    load_chunks();
+}
+
+bool DataBase::begin_transaction()
+{
+    if (is_transaction_thread())
+        return false;
+
+    auto lock = lock_for_writing();
+    begin_write();
+
+    // Anything written outside of SQL gets its own transaction
+    if (!commit())
+        rollback();
+    m_in_transaction = true;
+    m_transaction_thread = std::this_thread::get_id();
+    m_transaction_lock = std::move(lock);
+    return true;
+}
+
+bool DataBase::commit_transaction()
+{
+    if (!is_transaction_thread())
+        return false;
+
+    // NOTE: If it can't be written to the log, it never happened
+    auto is_committed = commit();
+    if (!is_committed)
+        rollback();
+    end_transaction();
+    return is_committed;
+}
+
+bool DataBase::rollback_transaction()
+{
+    if (!is_transaction_thread())
+        return false;
+
+    rollback();
+    end_transaction();
+    return true;
+}
+
+void DataBase::end_transaction()
+{
+    m_in_transaction = false;
+    m_transaction_thread = std::thread::id();
+    end_write();
+    m_transaction_lock.unlock();
+}
+
+uint32_t DataBase::generate_table_id()
+{
+    uint32_t max_id = 0;
     for (const auto &table : m_tables)
-        max_id = std::max(max_id, (uint8_t)table.id());
+        max_id = std::max(max_id, table.id());
 
     return max_id + 1;
 }
@@ -166,68 +827,62 @@ void DataBase::check_size(size_t size)
 void DataBase::write_byte(size_t offset, char byte)
 {
     check_size(offset + 1);
-    fseek(m_file, offset, SEEK_SET);
-    fwrite(&byte, 1, 1, m_file);
-    fflush(m_file);
+    m_wal->write(offset, &byte, 1);
 }
 
 void DataBase::write_int(size_t offset, int i)
 {
     check_size(offset + 4);
-    fseek(m_file, offset, SEEK_SET);
-    fwrite((char*)(&i), 1, 4, m_file);
-    fflush(m_file);
+    m_wal->write(offset, &i, 4);
 }
 
 void DataBase::write_long(size_t offset, int64_t l)
 {
     check_size(offset + 8);
-    fseek(m_file, offset, SEEK_SET);
-    fwrite((char*)(&l), 1, 8, m_file);
-    fflush(m_file);
+    m_wal->write(offset, &l, 8);
 }
 
 void DataBase::write_string(size_t offset, const std::string& str)
 {
     check_size(offset + str.size());
-    fseek(m_file, offset, SEEK_SET);
-    fwrite(str.data(), 1, str.size(), m_file);
-    fflush(m_file);
+    m_wal->write(offset, str.data(), str.size());
+}
+
+void DataBase::write_bytes(size_t offset, const char *bytes, size_t len)
+{
+    check_size(offset + len);
+    m_wal->write(offset, bytes, len);
 }
 
 void DataBase::flush()
 {
-    fflush(m_file);
+    m_storage->flush();
 }
 
 uint8_t DataBase::read_byte(size_t offset)
 {
     uint8_t byte;
-    fseek(m_file, offset, SEEK_SET);
-    fread(&byte, 1, 1, m_file);
+    m_wal->read(offset, &byte, 1);
     return byte;
 }
 
 int DataBase::read_int(size_t offset)
 {
     int i;
-    fseek(m_file, offset, SEEK_SET);
-    fread(&i, 1, sizeof(int), m_file);
+    m_wal->read(offset, &i, sizeof(int));
     return i;
 }
 
 int64_t DataBase::read_long(size_t offset)
 {
     int64_t l;
-    fseek(m_file, offset, SEEK_SET);
-    fread(&l, 1, sizeof(int64_t), m_file);
+    m_wal->read(offset, &l, sizeof(int64_t));
     return l;
 }
 
 void DataBase::read_string(size_t offset, char *str, size_t len)
 {
-    fseek(m_file, offset, SEEK_SET);
-    fread(str, 1, len, m_file);
+    m_wal->read(offset, str, len);
 }
 
 Table &DataBase::construct_table(Table::Constructor constructor)
@@ -236,7 +891,7 @@ Table &DataBase::construct_table(Table::Constructor constructor)
     return m_tables.back();
 }
 
-Table *DataBase::find_owner(uint8_t owner_id)
+Table *DataBase::find_owner(uint32_t owner_id)
 {
     for (auto &table : m_tables)
     {
@@ -278,8 +933,35 @@ bool DataBase::drop_table(const std::string &name)
     return true;
 }
 
+void DataBase::set_thread_count(size_t thread_count)
+{
+    std::lock_guard<std::mutex> lock(m_worker_pool_mutex);
+    m_thread_count = std::max<size_t>(thread_count, 1);
+    m_worker_pool = nullptr;
+}
+
+std::shared_ptr<WorkerPool> DataBase::worker_pool()
+{
+    // NOTE: Threads are only started once there's a scan to split
+    std::lock_guard<std::mutex> lock(m_worker_pool_mutex);
+    if (!m_worker_pool)
+        m_worker_pool = std::make_shared<WorkerPool>(m_thread_count);
+    return m_worker_pool;
+}
+
 DataBase::~DataBase()
 {
-    if (m_file)
-        fclose(m_file);
+    // NOTE: An unfinished transaction is rolled back
+    if (m_in_transaction)
+    {
+        m_wal->rollback();
+        end_write();
+    }
+    else if (m_wal->has_transaction())
+    {
+        begin_write();
+        if (!commit())
+            m_wal->rollback();
+        end_write();
+    }
 }
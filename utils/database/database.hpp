@@ -1,20 +1,67 @@
 #pragma once
+#include "config.hpp"
+#include "format.hpp"
 #include "table.hpp"
+#include "storage.hpp"
+#include "wal.hpp"
+#include "workerpool.hpp"
 #include "sql/sql.hpp"
+#include "sql/preparedstatement.hpp"
+#include "sql/resultcursor.hpp"
+#include "sql/statementcache.hpp"
+#include <atomic>
 #include <iostream>
+#include <list>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
 #include <string>
+#include <thread>
 
 namespace DB
 {
 
+    // Held while a statement reads from the database, see `DataBase`
+    class ReadLock
+    {
+    public:
+        ReadLock(DataBase&);
+        ~ReadLock();
+
+        ReadLock(const ReadLock&) = delete;
+        ReadLock(ReadLock&) = delete;
+
+    private:
+        DataBase &m_db;
+        bool m_is_locked;
+
+    };
+
+    // Statements can be run from any number of threads, and other
+    // processes can have the same file open. Each statement reads the
+    // database as of the last commit when it started, and other threads
+    // can read at the same time. Writes wait for any reads in this
+    // process to finish, and for any other process's transaction, but
+    // never for readers in other processes. A cursor reads as of when
+    // it was opened, so the thread holding one can't write, or start
+    // another read, until it's done with it.
+    //
+    // Tables changed directly, rather than with SQL, are only safe
+    // from other writers inside a transaction.
     class DataBase
     {
+        friend ReadLock;
         friend Chunk;
         friend DynamicData;
         friend Table;
         friend IntegerEntry;
         friend TextEntry;
+        friend Index;
+        friend TextHeap;
+        friend ZoneMap;
+        friend Dictionary;
+        friend PreparedStatement;
+        friend Sql::CopyStatement;
 
     public:
         ~DataBase();
@@ -25,25 +72,111 @@ namespace DB
 
         static std::shared_ptr<DataBase> open(const std::string &path);
 
+        // Open through a buffer pool, keeping at most `page_count`
+        // pages of the file in memory
+        static std::shared_ptr<DataBase> open_cached(const std::string &path, size_t page_count);
+
         Table &construct_table(Table::Constructor);
+
+        // Tables are reloaded in place when the file changes under
+        // them (like after a ROLLBACK, or another process committing),
+        // so this stays good for as long as the table exists
         Table *get_table(const std::string &name);
         bool drop_table(const std::string &name);
 
         SqlResult execute_sql(const std::string &query);
 
-    private:
-        explicit DataBase(FILE *file);
+        // Like `execute_sql`, but the rows of a SELECT are read from the
+        // table as the cursor is stepped through. Other statements are
+        // run straight away.
+        ResultCursor query(const std::string &query);
+
+        // Parse a statement with '?' parameters once, to be run with
+        // different values. Parsed statements are cached by their text,
+        // apart from ones with parameters, which aren't shared.
+        PreparedStatement prepare(const std::string &query);
+        inline const Sql::StatementCache &statement_cache() const { return m_statement_cache; }
+        inline Storage &storage() { return *m_storage; }
+        inline const Format &format() const { return m_format; }
+        inline std::list<Table> &tables() { return m_tables; }
+
+        bool begin_transaction();
+
+        // Returns false if this thread isn't in a transaction, or the
+        // transaction couldn't be committed and was rolled back instead
+        bool commit_transaction();
+        bool rollback_transaction();
+        inline bool in_transaction() const { return m_in_transaction; }
+
+        // Whether this thread is the one in a transaction
+        inline bool is_transaction_thread() const { return m_transaction_thread.load() == std::this_thread::get_id(); }
+
+        // Only wait for the log to reach the disk once every
+        // `transaction_count` commits. A crash may lose the most
+        // recent commits, but never part of one.
+        void set_group_commit(size_t transaction_count) { m_wal->set_group_size(transaction_count); }
+
+        // Full scans of big tables are split over this many threads. By
+        // default there is one per core, setting it to 1 turns it off.
+        void set_thread_count(size_t thread_count);
+        inline size_t thread_count() const { return m_thread_count; }
+
+        // NOTE: Scans hold on to the pool they started with, so it
+        //       outlives a `set_thread_count` made while they run
+        std::shared_ptr<WorkerPool> worker_pool();
 
-        std::shared_ptr<Chunk> new_chunk(std::string_view type, uint8_t owner_id, uint8_t index);
+    private:
+        DataBase(std::unique_ptr<Storage>, std::unique_ptr<WriteAheadLog>);
+        static std::shared_ptr<DataBase> create(const std::string &path, std::unique_ptr<Storage>);
+
+        void load();
+        void refresh();
+        bool begin_read();
+        void end_read();
+        void begin_write();
+        void end_write();
+        void end_transaction();
+        std::unique_lock<std::shared_mutex> lock_for_writing();
+
+        void load_chunks();
+        void load_chunk(std::shared_ptr<Chunk>);
+        void add_to_owner(Table&, std::shared_ptr<Chunk>);
+        bool load_directory();
+        void walk_chunks();
+        void build_directory();
+        void reserve_directory_entry();
+        void write_directory_entry(Chunk&);
+        // Returns false if nothing could be committed, which
+        // then has to be rolled back
+        bool commit();
+
+        // Throw away everything written since the last commit
+        void rollback();
+        std::shared_ptr<Sql::Statement> parse(const std::string &query, std::vector<std::string> &errors);
+        SqlResult execute_statement(Sql::Statement&);
+        ResultCursor open_cursor(std::shared_ptr<Sql::Statement>);
+
+        std::shared_ptr<Chunk> new_chunk(std::string_view type, uint32_t owner_id, uint32_t index);
+
+        // Write a compressed copy of a chunk at the end and drop it,
+        // returning the copy. Chunks that are still growing, or don't
+        // compress well enough to be worth it, are returned as they are.
+        std::shared_ptr<Chunk> compress_chunk(std::shared_ptr<Chunk>);
+
+        // Move a compressed chunk to the end of the file uncompressed, so
+        // it can be written to. It keeps its place in the directory.
+        void expand_chunk(Chunk&);
+        void align_end_of_data();
         void check_is_active_chunk(Chunk *chunk);
-        uint8_t generate_table_id();
-        Table *find_owner(uint8_t owner_id);
+        uint32_t generate_table_id();
+        Table *find_owner(uint32_t owner_id);
 
         void check_size(size_t);
         void write_byte(size_t offset, char);
         void write_int(size_t offset, int);
         void write_long(size_t offset, int64_t);
         void write_string(size_t offset, const std::string&);
+        void write_bytes(size_t offset, const char *bytes, size_t len);
         void write_version_chunk();
         void flush();
 
@@ -52,13 +185,37 @@ namespace DB
         int64_t read_long(size_t offset);
         void read_string(size_t offset, char *str, size_t len);
 
-        FILE *m_file;
+        std::unique_ptr<Storage> m_storage;
+        std::unique_ptr<WriteAheadLog> m_wal;
+        Format m_format { Config::major_version };
         size_t m_end_of_data_pointer;
-
-        std::vector<Table> m_tables;
+        size_t m_committed_end_of_data;
+        bool m_in_transaction { false };
+
+        // Reads share the mutex, and writes have it to themselves. A
+        // transaction holds it from beginning to end, on its own thread.
+        std::shared_mutex m_mutex;
+        std::mutex m_write_gate;
+        std::unique_lock<std::shared_mutex> m_transaction_lock;
+        std::atomic<std::thread::id> m_transaction_thread;
+        Sql::StatementCache m_statement_cache { Config::statement_cache_size };
+        size_t m_thread_count { 1 };
+        std::mutex m_worker_pool_mutex;
+        std::shared_ptr<WorkerPool> m_worker_pool;
+
+        // NOTE: A list, so tables never move once loaded
+        std::list<Table> m_tables;
         std::vector<std::shared_ptr<Chunk>> m_chunks;
+
+        // Chunks loaded before their table's header
+        std::vector<std::shared_ptr<Chunk>> m_unowned_chunks;
         std::shared_ptr<Chunk> m_active_chunk { nullptr };
+
+        // The chunk at the end of the file, even if it's been dropped
+        std::shared_ptr<Chunk> m_last_chunk { nullptr };
         std::shared_ptr<Chunk> m_version_chunk { nullptr };
+        std::shared_ptr<Chunk> m_directory_chunk { nullptr };
+        size_t m_directory_entry_count { 0 };
 
     };
 
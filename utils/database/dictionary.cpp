@@ -0,0 +1,114 @@
+#include "dictionary.hpp"
+#include "database.hpp"
+#include "chunk.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+using namespace DB;
+
+// Layout: value count, then each value's length
+// in a byte followed by its data
+static constexpr size_t header_size = sizeof(uint32_t);
+static constexpr size_t initial_capacity = 256;
+
+static std::string_view trim(std::string_view value)
+{
+    return value.substr(0, strnlen(value.data(), value.size()));
+}
+
+void Dictionary::load(std::shared_ptr<Chunk> chunk)
+{
+    m_chunk = std::move(chunk);
+    m_codes.clear();
+    m_values.clear();
+
+    std::vector<char> data(m_chunk->size_in_bytes());
+    m_chunk->read_bytes(0, data.data(), data.size());
+
+    uint32_t count;
+    memcpy(&count, data.data(), sizeof(count));
+    m_end = header_size;
+    for (uint32_t code = 0; code < count; code++)
+    {
+        auto size = (uint8_t)data[m_end];
+        const auto &value = m_values.emplace_back(data.data() + m_end + 1, size);
+        m_codes.emplace(value, code);
+        m_end += 1 + size;
+    }
+}
+
+void Dictionary::create()
+{
+    m_chunk = m_db.new_chunk("DI", m_owner_id, m_column);
+    m_chunk->write_byte(initial_capacity - 1, 0);
+    m_chunk->write_int(0, 0);
+    m_end = header_size;
+    m_codes.clear();
+    m_values.clear();
+}
+
+void Dictionary::drop()
+{
+    if (m_chunk)
+        m_chunk->drop();
+
+    m_chunk = nullptr;
+    m_codes.clear();
+    m_values.clear();
+}
+
+std::string_view Dictionary::value(uint32_t code) const
+{
+    if (code >= m_values.size())
+        return std::string_view();
+    return m_values[code];
+}
+
+std::optional<uint32_t> Dictionary::find(std::string_view value) const
+{
+    auto it = m_codes.find(trim(value));
+    if (it == m_codes.end())
+        return std::nullopt;
+    return it->second;
+}
+
+void Dictionary::reserve(size_t size)
+{
+    if (size <= m_chunk->size_in_bytes() || m_chunk->is_active())
+        return;
+
+    // NOTE: Only the active chunk can grow, so move the values
+    //       to a new chunk at the end with room to spare
+    std::vector<char> data(m_end);
+    m_chunk->read_bytes(0, data.data(), data.size());
+
+    auto new_chunk = m_db.new_chunk("DI", m_owner_id, m_column);
+    new_chunk->write_bytes(0, data.data(), data.size());
+    new_chunk->write_byte(std::max(size, m_chunk->size_in_bytes() * 2) - 1, 0);
+
+    m_chunk->drop();
+    m_chunk = new_chunk;
+}
+
+uint32_t Dictionary::insert(std::string_view value)
+{
+    value = trim(value);
+    assert (value.size() <= max_value_length);
+
+    auto it = m_codes.find(value);
+    if (it != m_codes.end())
+        return it->second;
+
+    auto code = (uint32_t)m_values.size();
+    assert (code != null_code);
+    m_codes.emplace(m_values.emplace_back(value), code);
+
+    char data[1 + max_value_length];
+    data[0] = (char)value.size();
+    memcpy(data + 1, value.data(), value.size());
+    reserve(m_end + 1 + value.size());
+    m_chunk->write_bytes(m_end, data, 1 + value.size());
+    m_chunk->write_int(0, (int)m_values.size());
+    m_end += 1 + value.size();
+    return code;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "forward.hpp"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace DB
+{
+
+    // The distinct values of a Char column that has a dictionary. Rows
+    // hold a 32-bit code in place of the value, which is its position
+    // in the column's "DI" chunk. Values are only ever added to the end,
+    // so codes never change, and they're all kept in memory so they can
+    // be found by code or by value without reading the chunk.
+    //
+    // NOTE: Values no row uses any more are kept, so
+    //       codes can't end up pointing at the wrong one
+    class Dictionary
+    {
+        friend Table;
+
+    public:
+        Dictionary(const Dictionary&) = delete;
+        Dictionary(Dictionary&) = delete;
+
+        // The code of a null value, which has no value in the dictionary
+        static constexpr uint32_t null_code = UINT32_MAX;
+
+        // Values are stored after a byte of their length, so
+        // only columns no longer than this can have one
+        static constexpr size_t max_value_length = UINT8_MAX;
+
+        inline size_t size() const { return m_values.size(); }
+
+        // The value with this code, which stays valid as long as the
+        // dictionary does. The null code gives an empty value.
+        std::string_view value(uint32_t code) const;
+
+        // Values end at their first null byte, like any Char value
+        std::optional<uint32_t> find(std::string_view value) const;
+        uint32_t insert(std::string_view value);
+
+    private:
+        Dictionary(DataBase &db, uint32_t owner_id, uint32_t column)
+            : m_db(db)
+            , m_owner_id(owner_id)
+            , m_column(column) {}
+
+        void load(std::shared_ptr<Chunk>);
+        void create();
+        void drop();
+        void reserve(size_t size);
+
+        DataBase &m_db;
+        uint32_t m_owner_id;
+        uint32_t m_column;
+        std::shared_ptr<Chunk> m_chunk;
+        size_t m_end { 0 };
+
+        // Values are listed in code order, and never move once added,
+        // so they can be found by value through views of them
+        std::deque<std::string> m_values;
+        std::unordered_map<std::string_view, uint32_t> m_codes;
+
+    };
+
+}
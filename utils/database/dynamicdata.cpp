@@ -23,8 +23,7 @@ void DynamicData::set(const std::vector<char> &data)
     }
 
     // Copy data into chunk
-    for (size_t i = 0; i < data.size(); i++)
-        m_chunk->write_byte(i, data[i]);
+    m_chunk->write_bytes(0, data.data(), data.size());
 
     // Shrink chunk to fit
     m_chunk->shrink_to(data.size());
@@ -35,8 +34,7 @@ std::vector<char> DynamicData::read()
     assert (m_chunk);
 
     std::vector<char> buffer(m_chunk->size_in_bytes());
-    for (size_t i = 0; i < buffer.size(); i++)
-        buffer[i] = m_chunk->read_byte(i);
+    m_chunk->read_bytes(0, buffer.data(), buffer.size());
 
     return buffer;
 }
@@ -1,7 +1,10 @@
 #include "database.hpp"
 #include "dynamicdata.hpp"
 #include "chunk.hpp"
+#include "textheap.hpp"
+#include "dictionary.hpp"
 #include "entry.hpp"
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 using namespace DB;
@@ -22,9 +25,16 @@ DataType DataType::char_(int size)
     return DataType(Char, 1, size);
 }
 
+DataType DataType::dictionary_char(int size)
+{
+    return DataType(Char, 1, size, true);
+}
+
 DataType DataType::text()
 {
-    return DataType(Text, 1, 1);
+    // NOTE: A 32-bit id into the table's text heap. Tables made
+    //       before that have a length of 1, a dynamic chunk id.
+    return DataType(Text, 1, 4);
 }
 
 DataType DataType::big_int()
@@ -50,6 +60,15 @@ int DataType::size_from_primitive(Primitive primitive)
     }
 }
 
+size_t DataType::alignment() const
+{
+    // NOTE: Strings are bytes, anything else is aligned
+    //       to its own size, up to 8 bytes
+    if (m_primitive == Char && !m_has_dictionary)
+        return 1;
+    return std::min(data_size(), (size_t)8);
+}
+
 int Entry::as_int() const
 {
     assert (m_data_type.primitive() == DataType::Integer);
@@ -72,7 +91,7 @@ std::string Entry::as_string() const
 {
     auto trim = [&](auto str)
     {
-        return std::string(str.data(), strlen(str.data()));
+        return std::string(str.data(), strnlen(str.data(), str.size()));
     };
 
     auto type = m_data_type.primitive();
@@ -84,16 +103,15 @@ std::string Entry::as_string() const
     assert (false);
 }
 
-void Entry::read(Chunk &chunk, size_t offset)
+void Entry::decode(Table &table, const char *data, bool is_null)
 {
-    m_is_null = chunk.read_byte(offset);
-    read_data(chunk, offset + 1);
+    m_is_null = is_null;
+    decode_data(table, data);
 }
 
-void Entry::write(Chunk &chunk, size_t offset)
+void Entry::encode(Table &table, char *data)
 {
-    chunk.write_byte(offset, m_is_null);
-    write_data(chunk, offset + 1);
+    encode_data(table, data);
 }
 
 template <typename T, DataType::Primitive primitive>
@@ -118,19 +136,15 @@ void TemplateEntry<T, primitive>::set(std::unique_ptr<Entry> entry)
 }
 
 template <typename T, DataType::Primitive primitive>
-void TemplateEntry<T, primitive>::read_data(Chunk &chunk, size_t offset)
+void TemplateEntry<T, primitive>::decode_data(Table&, const char *data)
 {
-    char *bytes = (char*)&m_t;
-    for (int i = 0; i < (int)sizeof(T); i++)
-        bytes[i] = chunk.read_byte(offset + i);
+    memcpy(&m_t, data, sizeof(T));
 }
 
 template <typename T, DataType::Primitive primitive>
-void TemplateEntry<T, primitive>::write_data(Chunk &chunk, size_t offset)
+void TemplateEntry<T, primitive>::encode_data(Table&, char *data)
 {
-    char *bytes = (char*)&m_t;
-    for (int i = 0; i < (int)sizeof(T); i++)
-        chunk.write_byte(offset + i, bytes[i]);
+    memcpy(data, &m_t, sizeof(T));
 }
 
 void CharEntry::set(std::unique_ptr<Entry> to)
@@ -140,24 +154,39 @@ void CharEntry::set(std::unique_ptr<Entry> to)
     auto other_str = static_cast<CharEntry&>(*to).data();
     assert ((int)other_str.size() <= m_size);
 
-    memset(m_c.data(), 0, m_size);
+    m_c.assign(m_size, 0);
     memcpy(m_c.data(), other_str.data(), other_str.size());
+    m_value = std::nullopt;
     m_is_null = false;
 }
 
-void CharEntry::read_data(Chunk &chunk, size_t offset)
+void CharEntry::decode_data(Table&, const char *data)
 {
-    auto str = chunk.read_string(offset, m_size);
-    memcpy(m_c.data(), str.data(), m_size);
+    if (m_dictionary)
+    {
+        uint32_t code;
+        memcpy(&code, data, sizeof(code));
+        m_value = m_dictionary->value(code);
+        return;
+    }
+
+    memcpy(m_c.data(), data, m_size);
 }
 
-void CharEntry::write_data(Chunk &chunk, size_t offset)
+void CharEntry::encode_data(Table&, char *data)
 {
-    chunk.write_string(offset, std::string(data()));
+    if (m_dictionary)
+    {
+        auto code = m_is_null ? Dictionary::null_code : m_dictionary->insert(this->data());
+        memcpy(data, &code, sizeof(code));
+        return;
+    }
+
+    memcpy(data, m_c.data(), m_size);
 }
 
-TextEntry::TextEntry()
-    : Entry(DataType::text(), true) {}
+TextEntry::TextEntry(DataType type)
+    : Entry(type, true) {}
 
 TextEntry::TextEntry(std::string text)
     : Entry(DataType::text())
@@ -174,7 +203,8 @@ void TextEntry::set(std::unique_ptr<Entry> to)
     if (to_type == DataType::Text)
     {
         auto &other_text = static_cast<TextEntry&>(*to);
-        m_dynamic_data = std::move(other_text.m_dynamic_data);
+        if (data_type().length() == 1)
+            m_dynamic_data = std::move(other_text.m_dynamic_data);
         m_text = other_text.m_text;
     }
     else if (to_type == DataType::Char)
@@ -189,15 +219,20 @@ void TextEntry::set(std::unique_ptr<Entry> to)
     }
 
     m_is_null = false;
+    m_has_changed = true;
 }
 
-void TextEntry::read_data(Chunk &chunk, size_t offset)
+void TextEntry::decode_data(Table &table, const char *data)
 {
-    auto id = chunk.read_byte(offset);
-    auto *table = chunk.db().find_owner(chunk.owner_id());
-    assert (table);
+    if (data_type().length() != 1)
+    {
+        memcpy(&m_id, data, sizeof(m_id));
+        table.read_text(data_type(), data, m_text);
+        return;
+    }
 
-    auto dynamic_chunk = table->find_dynamic_chunk(id);
+    auto id = (uint8_t)data[0];
+    auto dynamic_chunk = table.find_dynamic_chunk(id);
     if (!dynamic_chunk)
         return;
     m_dynamic_data = std::make_unique<DynamicData>(dynamic_chunk);
@@ -206,20 +241,29 @@ void TextEntry::read_data(Chunk &chunk, size_t offset)
     m_text = std::string(buffer.data(), buffer.size());
 }
 
-void TextEntry::write_data(Chunk &chunk, size_t offset)
+void TextEntry::encode_data(Table &table, char *data)
 {
-    if (!m_dynamic_data)
+    if (data_type().length() != 1)
     {
-        auto *table = chunk.db().find_owner(chunk.owner_id());
-        assert (table);
-        m_dynamic_data = table->new_dynamic_data();
+        // Only write the value if it's new or has changed
+        if (!m_is_null && m_id == TextHeap::null_id)
+            m_id = table.text_heap().insert(m_text);
+        else if (!m_is_null && m_has_changed)
+            table.text_heap().update(m_id, m_text);
+
+        m_has_changed = false;
+        memcpy(data, &m_id, sizeof(m_id));
+        return;
     }
 
+    if (!m_dynamic_data)
+        m_dynamic_data = table.new_dynamic_data();
+
     std::vector<char> buffer(m_text.size());
     memcpy(buffer.data(), m_text.data(), m_text.size());
     m_dynamic_data->set(buffer);
 
-    chunk.write_byte(offset, m_dynamic_data->id());
+    data[0] = m_dynamic_data->id();
 }
 
 std::ostream &operator<< (std::ostream &stream, const DB::Entry& entry)
@@ -1,6 +1,8 @@
 #pragma once
 #include "forward.hpp"
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <vector>
 #include <string>
 #include <cstring>
@@ -20,13 +22,18 @@ namespace DB
             Float,
         };
 
-        DataType(Primitive primitive, size_t size, size_t length)
+        DataType(Primitive primitive, size_t size, size_t length, bool has_dictionary = false)
             : m_primitive(primitive)
             , m_size(size)
-            , m_length(length) {}
+            , m_length(length)
+            , m_has_dictionary(has_dictionary) {}
 
         static DataType integer();
         static DataType char_(int size);
+
+        // A Char column whose distinct values are kept in a
+        // `Dictionary`, so rows only have a 32-bit code for them
+        static DataType dictionary_char(int size);
         static DataType text();
         static DataType big_int();
         static DataType float_();
@@ -34,12 +41,22 @@ namespace DB
 
         inline Primitive primitive() const { return m_primitive; }
         inline size_t length() const { return m_length; }
+        inline bool has_dictionary() const { return m_has_dictionary; }
+        inline size_t data_size() const
+        {
+            if (m_has_dictionary)
+                return sizeof(uint32_t);
+            return m_size * m_length;
+        }
         inline size_t size() const
         {
-            // NOTE: All types start with an 'is null' flag
-            return 1 + m_size * m_length;
+            // NOTE: All types have an 'is null' flag
+            return 1 + data_size();
         }
 
+        // Where the data can start in a row with aligned columns
+        size_t alignment() const;
+
         bool operator== (const DataType &other) const;
         bool operator!= (const DataType &other) const { return !(*this == other); }
 
@@ -47,6 +64,7 @@ namespace DB
         Primitive m_primitive;
         int m_size;
         int m_length;
+        bool m_has_dictionary;
 
     };
 
@@ -58,8 +76,12 @@ namespace DB
         virtual ~Entry() = default;
 
         const DataType &data_type() const { return m_data_type; }
-        void read(Chunk &chunk, size_t offset);
-        void write(Chunk &chunk, size_t offset);
+
+        // Entries are decoded from and encoded to their column's data in
+        // a row buffer, which is `data_type().data_size()` bytes. The
+        // 'is null' flag is kept by the row.
+        void decode(Table &table, const char *data, bool is_null);
+        void encode(Table &table, char *data);
         virtual void set(std::unique_ptr<Entry>) = 0;
 
         int as_int() const;
@@ -77,8 +99,8 @@ namespace DB
 
     private:
 
-        virtual void read_data(Chunk &chunk, size_t offset) = 0;
-        virtual void write_data(Chunk &chunk, size_t offset) = 0;
+        virtual void decode_data(Table &table, const char *data) = 0;
+        virtual void encode_data(Table &table, char *data) = 0;
 
         DataType m_data_type;
 
@@ -102,8 +124,8 @@ namespace DB
         inline T data() const { return m_t; }
 
     private:
-        virtual void read_data(Chunk &chunk, size_t offset) override;
-        virtual void write_data(Chunk &chunk, size_t offset) override;
+        virtual void decode_data(Table &table, const char *data) override;
+        virtual void encode_data(Table &table, char *data) override;
 
         T m_t {};
 
@@ -128,6 +150,11 @@ namespace DB
             , m_c(size)
             , m_size(size) {}
 
+        CharEntry(int size, std::shared_ptr<Dictionary> dictionary)
+            : Entry(DataType::dictionary_char(size), true)
+            , m_dictionary(std::move(dictionary))
+            , m_size(size) {}
+
         CharEntry(std::string_view str)
             : Entry(DataType::char_(str.size()))
             , m_c(str.size())
@@ -137,11 +164,21 @@ namespace DB
         }
 
         virtual void set(std::unique_ptr<Entry>) override;
-        inline std::string_view data() const { return std::string_view(m_c.data(), m_size); }
+        inline std::string_view data() const
+        {
+            if (m_value)
+                return *m_value;
+            return std::string_view(m_c.data(), m_c.size());
+        }
 
     private:
-        virtual void read_data(Chunk &chunk, size_t offset) override;
-        virtual void write_data(Chunk &chunk, size_t offset) override;
+        virtual void decode_data(Table &table, const char *data) override;
+        virtual void encode_data(Table &table, char *data) override;
+
+        // Values decoded from a dictionary are a view of it, and
+        // only get a buffer of their own once they're set
+        std::shared_ptr<Dictionary> m_dictionary;
+        std::optional<std::string_view> m_value;
 
         std::vector<char> m_c;
         int m_size;
@@ -153,7 +190,7 @@ namespace DB
         friend Column;
 
     public:
-        TextEntry();
+        TextEntry(DataType = DataType::text());
         TextEntry(std::string text);
         ~TextEntry();
 
@@ -161,10 +198,14 @@ namespace DB
         inline const std::string &data() const { return m_text; }
 
     private:
-        virtual void read_data(Chunk &chunk, size_t offset) override;
-        virtual void write_data(Chunk &chunk, size_t offset) override;
+        virtual void decode_data(Table &table, const char *data) override;
+        virtual void encode_data(Table &table, char *data) override;
 
+        // Tables from before the text heap keep each value in its own
+        // dynamic chunk, otherwise this is the value's id in the heap
         std::unique_ptr<DynamicData> m_dynamic_data { nullptr };
+        uint32_t m_id { UINT32_MAX };
+        bool m_has_changed { false };
         std::string m_text;
 
     };
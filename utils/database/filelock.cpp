@@ -0,0 +1,71 @@
+#include "filelock.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace DB;
+
+// NOTE: Open file description locks are tied to our own descriptor,
+//       so closing the file somewhere else doesn't drop them
+#ifdef F_OFD_SETLK
+static int constexpr set_lock = F_OFD_SETLK;
+static int constexpr set_lock_wait = F_OFD_SETLKW;
+#else
+static int constexpr set_lock = F_SETLK;
+static int constexpr set_lock_wait = F_SETLKW;
+#endif
+
+static off_t constexpr regions_start = (off_t)1 << 62;
+
+std::unique_ptr<FileLock> FileLock::open(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        perror("open()");
+        return nullptr;
+    }
+
+    return std::unique_ptr<FileLock>(new FileLock(fd));
+}
+
+bool FileLock::lock(Region region, short type, bool wait)
+{
+    struct flock lock {};
+    lock.l_type = type;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = regions_start + (off_t)region;
+    lock.l_len = 1;
+
+    for (;;)
+    {
+        if (fcntl(m_fd, wait ? set_lock_wait : set_lock, &lock) == 0)
+            return true;
+
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN && errno != EACCES)
+            perror("fcntl()");
+        return false;
+    }
+}
+
+bool FileLock::lock_shared(Region region, bool wait)
+{
+    return lock(region, F_RDLCK, wait);
+}
+
+bool FileLock::lock_exclusive(Region region, bool wait)
+{
+    return lock(region, F_WRLCK, wait);
+}
+
+void FileLock::unlock(Region region)
+{
+    lock(region, F_UNLCK, false);
+}
+
+FileLock::~FileLock()
+{
+    close(m_fd);
+}
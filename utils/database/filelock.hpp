@@ -0,0 +1,51 @@
+#pragma once
+#include <memory>
+#include <string>
+
+namespace DB
+{
+
+    // Locks on parts of a database file, shared with every process that
+    // has it open. The locked bytes are far past the end of the data, so
+    // they only mean something to other `FileLock`s. Locks belong to the
+    // open file, so threads of the same process never wait on each other.
+    class FileLock
+    {
+    public:
+        ~FileLock();
+
+        FileLock(const FileLock&) = delete;
+        FileLock(FileLock&) = delete;
+
+        static std::unique_ptr<FileLock> open(const std::string &path);
+
+        enum class Region
+        {
+            // Held shared by every process with the file open
+            Open,
+
+            // Held by the process writing a transaction
+            Write,
+
+            // Held shared while reading, and exclusively
+            // while writing committed pages into the file
+            Read,
+        };
+
+        // Returns false if `wait` is not set and another process holds a
+        // conflicting lock. Locking a region again changes how it's held.
+        bool lock_shared(Region, bool wait = true);
+        bool lock_exclusive(Region, bool wait = true);
+        void unlock(Region);
+
+    private:
+        FileLock(int fd)
+            : m_fd(fd) {}
+
+        bool lock(Region, short type, bool wait);
+
+        int m_fd;
+
+    };
+
+}
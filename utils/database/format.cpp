@@ -0,0 +1,162 @@
+#include "format.hpp"
+#include <cassert>
+#include <cstring>
+using namespace DB;
+
+// Version 1 chunk header: type[2], owner u8, index u8, size i32,
+// padding i32, then 8 reserved bytes
+//
+// Version 2 chunk header: type[2], format version u8, reserved u8,
+// owner u32, index u32, reserved u32, size u64, padding u64, then 8
+// reserved bytes. The format version is where version 1 has the owner
+// id, which is always 0 for the version chunk.
+
+int Format::detect(const char *data)
+{
+    if (memcmp(data, "VR", 2) != 0)
+        return 1;
+
+    auto version = (uint8_t)data[2];
+    return version >= 2 ? version : 1;
+}
+
+size_t Format::chunk_header_size() const
+{
+    return has_wide_ids() ? 40 : 20;
+}
+
+size_t Format::chunk_alignment() const
+{
+    return has_aligned_rows() ? 8 : 1;
+}
+
+size_t Format::directory_offset_in_header() const
+{
+    return has_wide_ids() ? 32 : 12;
+}
+
+size_t Format::directory_entry_size() const
+{
+    return has_wide_ids() ? 40 : 20;
+}
+
+size_t Format::sizes_offset_in_header() const
+{
+    return has_wide_ids() ? 16 : 4;
+}
+
+size_t Format::encode_sizes(uint64_t size_in_bytes, uint64_t padding_in_bytes, char *data) const
+{
+    if (has_wide_ids())
+    {
+        memcpy(data, &size_in_bytes, 8);
+        memcpy(data + 8, &padding_in_bytes, 8);
+        return 16;
+    }
+
+    assert (size_in_bytes <= INT32_MAX && padding_in_bytes <= INT32_MAX);
+    int32_t size = (int32_t)size_in_bytes;
+    int32_t padding = (int32_t)padding_in_bytes;
+    memcpy(data, &size, 4);
+    memcpy(data + 4, &padding, 4);
+    return 8;
+}
+
+void Format::encode_chunk_header(const ChunkHeader &header, char *data) const
+{
+    memset(data, 0, chunk_header_size());
+    memcpy(data, header.type, 2);
+    if (has_wide_ids())
+    {
+        data[2] = (char)m_version;
+        memcpy(data + 4, &header.owner_id, 4);
+        memcpy(data + 8, &header.index, 4);
+    }
+    else
+    {
+        // NOTE: Version 1 files can't tell more than 255 apart
+        assert (header.owner_id <= UINT8_MAX && header.index <= UINT8_MAX);
+        data[2] = (char)header.owner_id;
+        data[3] = (char)header.index;
+    }
+
+    encode_sizes(header.size_in_bytes, header.padding_in_bytes,
+        data + sizes_offset_in_header());
+}
+
+Format::ChunkHeader Format::decode_chunk_header(const char *data) const
+{
+    ChunkHeader header;
+    memcpy(header.type, data, 2);
+    if (has_wide_ids())
+    {
+        memcpy(&header.owner_id, data + 4, 4);
+        memcpy(&header.index, data + 8, 4);
+        memcpy(&header.size_in_bytes, data + 16, 8);
+        memcpy(&header.padding_in_bytes, data + 24, 8);
+        return header;
+    }
+
+    int32_t size, padding;
+    memcpy(&size, data + 4, 4);
+    memcpy(&padding, data + 8, 4);
+    header.owner_id = (uint8_t)data[2];
+    header.index = (uint8_t)data[3];
+    header.size_in_bytes = (uint32_t)size;
+    header.padding_in_bytes = (uint32_t)padding;
+    return header;
+}
+
+// Version 1 directory entry: header offset u64, type[2], owner u8,
+// index u8, size u32, padding u32
+//
+// Version 2 directory entry: header offset u64, size u64, padding u64,
+// owner u32, index u32, type[2], then 6 reserved bytes
+
+void Format::encode_directory_entry(uint64_t header_offset, const ChunkHeader &header, char *data) const
+{
+    memset(data, 0, directory_entry_size());
+    memcpy(data, &header_offset, 8);
+    if (has_wide_ids())
+    {
+        memcpy(data + 8, &header.size_in_bytes, 8);
+        memcpy(data + 16, &header.padding_in_bytes, 8);
+        memcpy(data + 24, &header.owner_id, 4);
+        memcpy(data + 28, &header.index, 4);
+        memcpy(data + 32, header.type, 2);
+        return;
+    }
+
+    uint32_t size = (uint32_t)header.size_in_bytes;
+    uint32_t padding = (uint32_t)header.padding_in_bytes;
+    memcpy(data + 8, header.type, 2);
+    data[10] = (char)header.owner_id;
+    data[11] = (char)header.index;
+    memcpy(data + 12, &size, 4);
+    memcpy(data + 16, &padding, 4);
+}
+
+Format::ChunkHeader Format::decode_directory_entry(const char *data, uint64_t &header_offset) const
+{
+    ChunkHeader header;
+    memcpy(&header_offset, data, 8);
+    if (has_wide_ids())
+    {
+        memcpy(&header.size_in_bytes, data + 8, 8);
+        memcpy(&header.padding_in_bytes, data + 16, 8);
+        memcpy(&header.owner_id, data + 24, 4);
+        memcpy(&header.index, data + 28, 4);
+        memcpy(header.type, data + 32, 2);
+        return header;
+    }
+
+    uint32_t size, padding;
+    memcpy(header.type, data + 8, 2);
+    header.owner_id = (uint8_t)data[10];
+    header.index = (uint8_t)data[11];
+    memcpy(&size, data + 12, 4);
+    memcpy(&padding, data + 16, 4);
+    header.size_in_bytes = size;
+    header.padding_in_bytes = padding;
+    return header;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace DB
+{
+
+    // How a file is laid out, which the version chunk at the start of
+    // it decides. Version 1 chunk headers have one byte owner ids and
+    // indices and 32-bit sizes, and rows have an 'is null' byte in front
+    // of every column. Version 2 widens ids to 32 bits and sizes to 64,
+    // starts every chunk on an 8 byte boundary, and gives rows naturally
+    // aligned columns followed by a null bitmap.
+    class Format
+    {
+    public:
+        struct ChunkHeader
+        {
+            char type[2];
+            uint32_t owner_id;
+            uint32_t index;
+            uint64_t size_in_bytes;
+            uint64_t padding_in_bytes;
+        };
+
+        Format(int version)
+            : m_version(version) {}
+
+        // Find the format of a file from the first bytes of its version
+        // chunk, `data` must hold at least `detect_size` bytes
+        static constexpr size_t detect_size = 4;
+        static int detect(const char *data);
+
+        inline int version() const { return m_version; }
+        inline bool has_wide_ids() const { return m_version >= 2; }
+        inline bool has_aligned_rows() const { return m_version >= 2; }
+        size_t chunk_header_size() const;
+        size_t chunk_alignment() const;
+        size_t directory_offset_in_header() const;
+        size_t directory_entry_size() const;
+
+        void encode_chunk_header(const ChunkHeader&, char *data) const;
+        ChunkHeader decode_chunk_header(const char *data) const;
+
+        // Where the size and padding are in a chunk header, so
+        // they can be written without the rest of it
+        size_t sizes_offset_in_header() const;
+        size_t encode_sizes(uint64_t size_in_bytes, uint64_t padding_in_bytes, char *data) const;
+
+        void encode_directory_entry(uint64_t header_offset, const ChunkHeader&, char *data) const;
+        ChunkHeader decode_directory_entry(const char *data, uint64_t &header_offset) const;
+
+    private:
+        int m_version;
+
+    };
+
+}
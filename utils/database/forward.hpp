@@ -9,7 +9,17 @@ namespace DB
     class Table;
     class Column;
     class Row;
+    class RowView;
     class Entry;
+    class Index;
+    class TextHeap;
+    class Dictionary;
+    class ZoneMap;
+    class FileLock;
+    class WorkerPool;
+    class PreparedStatement;
+    class ResultCursor;
+    class ReadLock;
 
     namespace Sql
     {
@@ -23,8 +33,20 @@ namespace DB
         class CreateTableIfNotExistsStatement;
         class UpdateStatement;
         class DeleteStatement;
+        class CopyStatement;
+        class CreateIndexStatement;
+        class BeginStatement;
+        class CommitStatement;
+        class RollbackStatement;
         class Value;
         class ValueNode;
+        class Scan;
+        class ColumnScan;
+        class Aggregation;
+        class Sort;
+        class Program;
+        class StatementCache;
+        class Arena;
 
     };
 
@@ -0,0 +1,409 @@
+#include "config.hpp"
+#include "chunk.hpp"
+#include "database.hpp"
+#include "index.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+using namespace DB;
+
+static size_t constexpr node_header_size = 8;
+static size_t constexpr key_size = 16;
+static size_t constexpr max_leaf_keys = (Config::index_node_size - node_header_size) / key_size;
+static size_t constexpr max_internal_keys = (Config::index_node_size - node_header_size - 4) / (key_size + 4);
+
+Index::Index(std::shared_ptr<Chunk> chunk)
+    : m_chunk(chunk)
+{
+    size_t offset = 0;
+
+    auto name_len = chunk->read_byte(offset);
+    m_name = chunk->read_string(offset + 1, name_len);
+    offset += 1 + name_len;
+
+    auto column_name_len = chunk->read_byte(offset);
+    m_column_name = chunk->read_string(offset + 1, column_name_len);
+    offset += 1 + column_name_len;
+
+    m_root = chunk->read_int(offset);
+    m_node_count = chunk->read_int(offset + 4);
+    m_nodes_offset = offset + 8;
+}
+
+std::shared_ptr<Index> Index::create(DataBase &db, uint32_t owner_id, uint32_t index,
+    const std::string &name, const std::string &column_name)
+{
+    auto chunk = db.new_chunk("IX", owner_id, index);
+    auto tree = std::shared_ptr<Index>(new Index(chunk));
+    tree->m_name = name;
+    tree->m_column_name = column_name;
+    tree->m_nodes_offset = 1 + name.size() + 1 + column_name.size() + 8;
+    tree->m_root = 0;
+    tree->m_node_count = 1;
+    tree->write_header();
+    tree->write_node(0, Node {});
+    return tree;
+}
+
+void Index::write_header()
+{
+    size_t offset = 0;
+
+    m_chunk->write_byte(offset, m_name.size());
+    m_chunk->write_string(offset + 1, m_name);
+    offset += 1 + m_name.size();
+
+    m_chunk->write_byte(offset, m_column_name.size());
+    m_chunk->write_string(offset + 1, m_column_name);
+    offset += 1 + m_column_name.size();
+
+    m_chunk->write_int(offset, m_root);
+    m_chunk->write_int(offset + 4, m_node_count);
+}
+
+bool Index::can_index(const DataType &type)
+{
+    switch (type.primitive())
+    {
+        case DataType::Integer:
+        case DataType::BigInt:
+        case DataType::Float:
+        case DataType::Char:
+            return true;
+        default:
+            return false;
+    }
+}
+
+uint64_t Index::key_for_int(int64_t i)
+{
+    // Flip the sign bit, so negative numbers come first
+    return (uint64_t)i ^ (1ull << 63);
+}
+
+uint64_t Index::key_for_float(float f)
+{
+    // NOTE: -0 and 0 are equal, so they need the same key
+    if (f == 0)
+        f = 0;
+
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(float));
+    if (bits & 0x80000000)
+        bits = ~bits;
+    else
+        bits |= 0x80000000;
+    return (uint64_t)bits << 32;
+}
+
+uint64_t Index::key_for_string(std::string_view str)
+{
+    // Big endian prefix of the string
+    uint64_t key = 0;
+    for (size_t i = 0; i < 8; i++)
+    {
+        key <<= 8;
+        if (i < str.size())
+            key |= (uint8_t)str[i];
+    }
+
+    return key;
+}
+
+uint64_t Index::key_for_row(const char *row_data) const
+{
+    return key_for_data(m_column_type, row_data + m_column_offset);
+}
+
+uint64_t Index::key_for_data(const DataType &type, const char *data)
+{
+    switch (type.primitive())
+    {
+        case DataType::Integer:
+        {
+            int32_t i;
+            memcpy(&i, data, sizeof(int32_t));
+            return key_for_int(i);
+        }
+        case DataType::BigInt:
+        {
+            int64_t l;
+            memcpy(&l, data, sizeof(int64_t));
+            return key_for_int(l);
+        }
+        case DataType::Float:
+        {
+            float f;
+            memcpy(&f, data, sizeof(float));
+            return key_for_float(f);
+        }
+        case DataType::Char:
+        {
+            if (!type.has_dictionary())
+                return key_for_string(std::string_view(data, strnlen(data, type.length())));
+
+            // NOTE: Codes aren't in the order of their values, so
+            //       these keys can only be used to find equal ones
+            uint32_t code;
+            memcpy(&code, data, sizeof(uint32_t));
+            return code;
+        }
+        default:
+            assert (false);
+            return 0;
+    }
+}
+
+Index::Node Index::read_node(uint32_t id)
+{
+    assert (id < m_node_count);
+
+    char buffer[Config::index_node_size];
+    m_chunk->read_bytes(m_nodes_offset + id * Config::index_node_size, buffer, sizeof(buffer));
+
+    Node node;
+    uint16_t key_count;
+    node.is_leaf = buffer[0];
+    memcpy(&key_count, buffer + 2, 2);
+    memcpy(&node.next, buffer + 4, 4);
+
+    size_t keys_offset = node_header_size;
+    if (!node.is_leaf)
+    {
+        node.children.resize(key_count + 1);
+        memcpy(node.children.data(), buffer + node_header_size, node.children.size() * 4);
+        keys_offset += (max_internal_keys + 1) * 4;
+    }
+
+    node.keys.resize(key_count);
+    for (size_t i = 0; i < key_count; i++)
+    {
+        memcpy(&node.keys[i].value, buffer + keys_offset + i * key_size, 8);
+        memcpy(&node.keys[i].row, buffer + keys_offset + i * key_size + 8, 8);
+    }
+
+    return node;
+}
+
+void Index::write_node(uint32_t id, const Node &node)
+{
+    char buffer[Config::index_node_size] = {};
+    uint16_t key_count = node.keys.size();
+    buffer[0] = node.is_leaf;
+    memcpy(buffer + 2, &key_count, 2);
+    memcpy(buffer + 4, &node.next, 4);
+
+    size_t keys_offset = node_header_size;
+    if (!node.is_leaf)
+    {
+        assert (node.children.size() == node.keys.size() + 1);
+        memcpy(buffer + node_header_size, node.children.data(), node.children.size() * 4);
+        keys_offset += (max_internal_keys + 1) * 4;
+    }
+
+    for (size_t i = 0; i < node.keys.size(); i++)
+    {
+        memcpy(buffer + keys_offset + i * key_size, &node.keys[i].value, 8);
+        memcpy(buffer + keys_offset + i * key_size + 8, &node.keys[i].row, 8);
+    }
+
+    m_chunk->write_bytes(m_nodes_offset + id * Config::index_node_size, buffer, sizeof(buffer));
+}
+
+void Index::reserve(size_t size)
+{
+    if (size <= m_chunk->size_in_bytes() || m_chunk->is_active())
+        return;
+
+    // NOTE: Only the active chunk can grow, so move the index to
+    //       a new chunk at the end with room to spare
+    std::vector<char> data(m_chunk->size_in_bytes());
+    m_chunk->read_bytes(0, data.data(), data.size());
+
+    auto &db = m_chunk->db();
+    auto new_chunk = db.new_chunk("IX", m_chunk->owner_id(), m_chunk->index());
+    new_chunk->write_bytes(0, data.data(), data.size());
+    new_chunk->write_byte(std::max(size, data.size() * 2) - 1, 0);
+
+    m_chunk->drop();
+    m_chunk = new_chunk;
+}
+
+uint32_t Index::allocate_node()
+{
+    auto id = m_node_count;
+    reserve(m_nodes_offset + (id + 1) * Config::index_node_size);
+
+    m_node_count += 1;
+    write_header();
+    return id;
+}
+
+uint32_t Index::find_leaf(const Key &key)
+{
+    auto node_id = m_root;
+    for (;;)
+    {
+        auto node = read_node(node_id);
+        if (node.is_leaf)
+            return node_id;
+
+        auto child = std::upper_bound(node.keys.begin(), node.keys.end(), key) - node.keys.begin();
+        node_id = node.children[child];
+    }
+}
+
+uint32_t Index::first_leaf()
+{
+    return find_leaf(Key { 0, 0 });
+}
+
+uint32_t Index::read_leaf(uint32_t id, std::vector<size_t> &rows)
+{
+    auto node = read_node(id);
+    assert (node.is_leaf);
+
+    rows.clear();
+    for (const auto &key : node.keys)
+        rows.push_back(key.row);
+    return node.next;
+}
+
+std::vector<size_t> Index::find(uint64_t low, uint64_t high)
+{
+    std::vector<size_t> rows;
+    auto node_id = find_leaf(Key { low, 0 });
+    while (node_id != UINT32_MAX)
+    {
+        auto node = read_node(node_id);
+        for (const auto &key : node.keys)
+        {
+            if (key.value < low)
+                continue;
+            if (key.value > high)
+                return rows;
+
+            rows.push_back(key.row);
+        }
+
+        node_id = node.next;
+    }
+
+    return rows;
+}
+
+std::optional<std::pair<Index::Key, uint32_t>> Index::insert_into(uint32_t node_id, const Key &key)
+{
+    auto node = read_node(node_id);
+    if (node.is_leaf)
+    {
+        node.keys.insert(std::lower_bound(node.keys.begin(), node.keys.end(), key), key);
+        if (node.keys.size() <= max_leaf_keys)
+        {
+            write_node(node_id, node);
+            return std::nullopt;
+        }
+
+        // Split the leaf in half
+        auto middle = node.keys.size() / 2;
+        Node right;
+        right.keys.assign(node.keys.begin() + middle, node.keys.end());
+        node.keys.resize(middle);
+
+        auto right_id = allocate_node();
+        right.next = node.next;
+        node.next = right_id;
+        write_node(node_id, node);
+        write_node(right_id, right);
+        return std::make_pair(right.keys.front(), right_id);
+    }
+
+    auto child = std::upper_bound(node.keys.begin(), node.keys.end(), key) - node.keys.begin();
+    auto split = insert_into(node.children[child], key);
+    if (!split)
+        return std::nullopt;
+
+    node.keys.insert(node.keys.begin() + child, split->first);
+    node.children.insert(node.children.begin() + child + 1, split->second);
+    if (node.keys.size() <= max_internal_keys)
+    {
+        write_node(node_id, node);
+        return std::nullopt;
+    }
+
+    // Split the node, moving the middle key up a level
+    auto middle = node.keys.size() / 2;
+    auto separator = node.keys[middle];
+    Node right;
+    right.is_leaf = false;
+    right.keys.assign(node.keys.begin() + middle + 1, node.keys.end());
+    right.children.assign(node.children.begin() + middle + 1, node.children.end());
+    node.keys.resize(middle);
+    node.children.resize(middle + 1);
+
+    auto right_id = allocate_node();
+    write_node(node_id, node);
+    write_node(right_id, right);
+    return std::make_pair(separator, right_id);
+}
+
+void Index::insert(uint64_t key, size_t row)
+{
+    auto split = insert_into(m_root, Key { key, row });
+    if (!split)
+        return;
+
+    // The root was split, so grow the tree by one level
+    Node root;
+    root.is_leaf = false;
+    root.keys.push_back(split->first);
+    root.children.push_back(m_root);
+    root.children.push_back(split->second);
+
+    auto root_id = allocate_node();
+    write_node(root_id, root);
+    m_root = root_id;
+    write_header();
+}
+
+void Index::remove(uint64_t key, size_t row)
+{
+    // NOTE: Nodes are never merged, an empty leaf is still a valid leaf
+    Key to_remove { key, row };
+    auto leaf_id = find_leaf(to_remove);
+    auto leaf = read_node(leaf_id);
+
+    auto it = std::lower_bound(leaf.keys.begin(), leaf.keys.end(), to_remove);
+    if (it == leaf.keys.end() || !(*it == to_remove))
+        return;
+
+    leaf.keys.erase(it);
+    write_node(leaf_id, leaf);
+}
+
+void Index::shift_rows(const std::vector<size_t> &removed_rows)
+{
+    if (removed_rows.empty())
+        return;
+
+    // NOTE: Rows only ever move down past removed rows, so the
+    //       order of the keys, and the shape of the tree, stays the same
+    for (uint32_t id = 0; id < m_node_count; id++)
+    {
+        auto node = read_node(id);
+        bool has_changed = false;
+        for (auto &key : node.keys)
+        {
+            if (key.row <= removed_rows.front())
+                continue;
+
+            auto removed_before = std::lower_bound(removed_rows.begin(),
+                removed_rows.end(), key.row) - removed_rows.begin();
+            key.row -= removed_before;
+            has_changed = true;
+        }
+
+        if (has_changed)
+            write_node(id, node);
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include "forward.hpp"
+#include "entry.hpp"
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace DB
+{
+
+    // A B+-tree over one column of a table, mapping column
+    // values to row indices. Values are reduced to an order
+    // preserving 64-bit key, so Char columns are only indexed
+    // by their first 8 bytes; rows found through an index must
+    // always be checked against the real condition. Char columns
+    // with a dictionary use their code, which is not in order,
+    // so only equal values can be looked up.
+    class Index
+    {
+        friend Table;
+
+    public:
+        Index(const Index&) = delete;
+        Index(Index&) = delete;
+
+        inline const std::string &name() const { return m_name; }
+        inline const std::string &column_name() const { return m_column_name; }
+        inline const DataType &column_type() const { return m_column_type; }
+
+        static bool can_index(const DataType&);
+        static uint64_t key_for_int(int64_t);
+        static uint64_t key_for_float(float);
+        static uint64_t key_for_string(std::string_view);
+        uint64_t key_for_row(const char *row_data) const;
+
+        // The key of a column's data in an encoded row,
+        // for a type that `can_index`
+        static uint64_t key_for_data(const DataType&, const char *data);
+
+        // Find all rows with a key between `low` and `high` (inclusive)
+        std::vector<size_t> find(uint64_t low, uint64_t high);
+
+        // Leaves can be read one at a time to step through every row in
+        // key order. `read_leaf` gives the id of the next leaf, or
+        // UINT32_MAX after the last one.
+        uint32_t first_leaf();
+        uint32_t read_leaf(uint32_t id, std::vector<size_t> &rows);
+
+        void insert(uint64_t key, size_t row);
+        void remove(uint64_t key, size_t row);
+
+        // Rows after removed ones move down by the number of rows
+        // removed before them, `removed_rows` must be sorted
+        void shift_rows(const std::vector<size_t> &removed_rows);
+
+    private:
+        Index(std::shared_ptr<Chunk>);
+        static std::shared_ptr<Index> create(DataBase&, uint32_t owner_id, uint32_t index,
+            const std::string &name, const std::string &column_name);
+
+        struct Key
+        {
+            uint64_t value;
+            uint64_t row;
+
+            bool operator< (const Key &other) const
+            {
+                if (value != other.value)
+                    return value < other.value;
+                return row < other.row;
+            }
+            bool operator== (const Key &other) const { return value == other.value && row == other.row; }
+        };
+
+        struct Node
+        {
+            bool is_leaf { true };
+            uint32_t next { UINT32_MAX };
+            std::vector<Key> keys;
+            std::vector<uint32_t> children;
+        };
+
+        Node read_node(uint32_t id);
+        void write_node(uint32_t id, const Node&);
+        uint32_t allocate_node();
+        void write_header();
+        void reserve(size_t size);
+
+        std::optional<std::pair<Key, uint32_t>> insert_into(uint32_t node_id, const Key&);
+        uint32_t find_leaf(const Key&);
+
+        std::shared_ptr<Chunk> m_chunk;
+        std::string m_name;
+        std::string m_column_name;
+        size_t m_nodes_offset { 0 };
+        uint32_t m_root { 0 };
+        uint32_t m_node_count { 0 };
+
+        // Set up by the table, to find the key in a row
+        size_t m_column_offset { 0 };
+        DataType m_column_type { DataType::integer() };
+
+    };
+
+}
@@ -0,0 +1,153 @@
+#include "lz.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+using namespace DB;
+
+static constexpr size_t min_match = 4;
+static constexpr size_t max_offset = UINT16_MAX;
+static constexpr size_t hash_bits = 14;
+
+// NOTE: The end is always left as literals, so matches
+//       never have to be checked against it byte by byte
+static constexpr size_t end_literals = 8;
+
+static uint32_t read_u32(const char *data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static size_t hash(uint32_t value)
+{
+    return (value * 2654435761u) >> (32 - hash_bits);
+}
+
+static void write_length(std::vector<char> &out, size_t length)
+{
+    while (length >= 255)
+    {
+        out.push_back((char)255);
+        length -= 255;
+    }
+    out.push_back((char)length);
+}
+
+static void write_sequence(std::vector<char> &out, const char *literals, size_t literal_count,
+    size_t offset, size_t match_length)
+{
+    auto match_code = match_length >= min_match ? match_length - min_match : 0;
+    auto token = (uint8_t)((std::min<size_t>(literal_count, 15) << 4) | std::min<size_t>(match_code, 15));
+    out.push_back((char)token);
+    if (literal_count >= 15)
+        write_length(out, literal_count - 15);
+    out.insert(out.end(), literals, literals + literal_count);
+
+    if (match_length < min_match)
+        return;
+
+    out.push_back((char)(offset & 0xFF));
+    out.push_back((char)(offset >> 8));
+    if (match_code >= 15)
+        write_length(out, match_code - 15);
+}
+
+std::vector<char> LZ::compress(const char *data, size_t size)
+{
+    std::vector<char> out;
+    out.reserve(size / 2 + 16);
+
+    std::vector<uint32_t> table(1 << hash_bits, UINT32_MAX);
+    size_t literal_start = 0;
+    size_t position = 0;
+    while (size >= end_literals && position + min_match <= size - end_literals)
+    {
+        auto value = read_u32(data + position);
+        auto &entry = table[hash(value)];
+        auto candidate = (size_t)entry;
+        entry = (uint32_t)position;
+
+        if (candidate == UINT32_MAX || position - candidate > max_offset ||
+            read_u32(data + candidate) != value)
+        {
+            position += 1;
+            continue;
+        }
+
+        auto match_end = position + min_match;
+        auto limit = size - end_literals;
+        while (match_end < limit && data[match_end] == data[candidate + match_end - position])
+            match_end += 1;
+
+        write_sequence(out, data + literal_start, position - literal_start,
+            position - candidate, match_end - position);
+        position = match_end;
+        literal_start = position;
+    }
+
+    write_sequence(out, data + literal_start, size - literal_start, 0, 0);
+    return out;
+}
+
+static bool read_length(const char *&in, const char *end, size_t &length)
+{
+    for (;;)
+    {
+        if (in >= end)
+            return false;
+
+        auto byte = (uint8_t)*in++;
+        length += byte;
+        if (byte != 255)
+            return true;
+    }
+}
+
+bool LZ::decompress(const char *data, size_t size, char *out, size_t out_size)
+{
+    const char *in = data;
+    const char *in_end = data + size;
+    size_t written = 0;
+    while (in < in_end)
+    {
+        auto token = (uint8_t)*in++;
+        size_t literal_count = token >> 4;
+        if (literal_count == 15 && !read_length(in, in_end, literal_count))
+            return false;
+
+        if (literal_count > (size_t)(in_end - in) || literal_count > out_size - written)
+            return false;
+        memcpy(out + written, in, literal_count);
+        in += literal_count;
+        written += literal_count;
+
+        // The last sequence has no match
+        if (in == in_end)
+            break;
+
+        if (in_end - in < 2)
+            return false;
+        auto offset = (size_t)(uint8_t)in[0] | ((size_t)(uint8_t)in[1] << 8);
+        in += 2;
+
+        size_t match_length = token & 0x0F;
+        if (match_length == 15 && !read_length(in, in_end, match_length))
+            return false;
+        match_length += min_match;
+
+        if (offset == 0 || offset > written || match_length > out_size - written)
+            return false;
+
+        // NOTE: Matches can overlap what they're copying, which repeats
+        //       the bytes between them, so they're copied at most
+        //       `offset` bytes at a time
+        auto *from = out + written - offset;
+        auto *to = out + written;
+        for (size_t copied = 0; copied < match_length; copied += offset)
+            memcpy(to + copied, from + copied, std::min(offset, match_length - copied));
+        written += match_length;
+    }
+
+    return written == out_size;
+}
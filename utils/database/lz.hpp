@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace DB::LZ
+{
+
+    // A small LZ77 codec in the style of LZ4, fast to decompress rather
+    // than small. Each sequence is a token byte with the literal count
+    // in its top half and the match length, less 4, in its bottom half,
+    // either of which carry on in following bytes when they're 15. Then
+    // come the literals, and a two byte offset back to the match. The
+    // last sequence is only literals.
+    std::vector<char> compress(const char *data, size_t size);
+
+    // Returns false if `data` doesn't decompress to exactly `size` bytes
+    bool decompress(const char *data, size_t size, char *out, size_t out_size);
+
+}
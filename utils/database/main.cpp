@@ -3,6 +3,7 @@
 #include "prompt.hpp"
 #include <iostream>
 #include <cassert>
+#include <filesystem>
 #include <getopt.h>
 using namespace DB;
 
@@ -10,17 +11,30 @@ static struct option cmd_options[] =
 {
     { "help",       no_argument,        0, 'h' },
     { "clean",      no_argument,        0, 'c' },
-    { "info",       no_argument,        0, 'i' }
+    { "info",       no_argument,        0, 'i' },
+    { "upgrade",    no_argument,        0, 'u' },
+    { "import",     required_argument,  0, 'I' },
+    { "table",      required_argument,  0, 'T' },
+    { "compress",   required_argument,  0, 'z' },
+    { "pages",      required_argument,  0, 'p' },
+    { "threads",    required_argument,  0, 't' },
+    { 0,            0,                  0,  0  },
 };
 
 void show_help()
 {
-    std::cout << "usage: database [-h] [-c] [-i] <file>\n";
+    std::cout << "usage: database [-h] [-c] [-i] [-u] [-I <csv> [-T <table>]] [-z <table>] [-p <count>] [-t <count>] <file>\n";
     std::cout << "\nManage databases\n";
     std::cout << "\noptional arguments:\n";
     std::cout << "  -h, --help\t\tShow this help message and exit\n";
     std::cout << "  -c, --clean\t\tClean up the database\n";
     std::cout << "  -i, --info\t\tOutput the internal structure\n";
+    std::cout << "  -u, --upgrade\t\tCopy the database into a file in the current format\n";
+    std::cout << "  -I, --import <csv>\tAdd the rows of a CSV file to a table\n";
+    std::cout << "  -T, --table <name>\tThe table to import into, named after the file by default\n";
+    std::cout << "  -z, --compress <table>\tCompress a table's rows and TEXT values from now on\n";
+    std::cout << "  -p, --pages <count>\tOnly cache this many pages of the file in memory\n";
+    std::cout << "  -t, --threads <count>\tSplit scans over this many threads\n";
 }
 
 int main(int argc, char *argv[])
@@ -30,13 +44,20 @@ int main(int argc, char *argv[])
         Default,
         Clean,
         Info,
+        Upgrade,
+        Import,
+        Compress,
     };
     
     auto mode = Mode::Default;
+    size_t page_count = 0;
+    size_t thread_count = 0;
+    std::string import_path;
+    std::string table_name;
     for (;;)
     {
         int option_index;
-        int c = getopt_long(argc, argv, "hci",
+        int c = getopt_long(argc, argv, "hciuI:T:z:p:t:",
             cmd_options, &option_index);
 
         if (c == -1)
@@ -68,6 +89,32 @@ int main(int argc, char *argv[])
                     return 1;
                 mode = Mode::Info;
                 break;
+            case 'u':
+                if (mode_already_set())
+                    return 1;
+                mode = Mode::Upgrade;
+                break;
+            case 'I':
+                if (mode_already_set())
+                    return 1;
+                mode = Mode::Import;
+                import_path = optarg;
+                break;
+            case 'T':
+                table_name = optarg;
+                break;
+            case 'z':
+                if (mode_already_set())
+                    return 1;
+                mode = Mode::Compress;
+                table_name = optarg;
+                break;
+            case 'p':
+                page_count = atoi(optarg);
+                break;
+            case 't':
+                thread_count = atoi(optarg);
+                break;
         }
     }
 
@@ -82,7 +129,7 @@ int main(int argc, char *argv[])
     {
         case Mode::Default:
         {
-            Prompt prompt(db_path);
+            Prompt prompt(db_path, page_count, thread_count);
             prompt.run();
             break;
         }
@@ -98,6 +145,63 @@ int main(int argc, char *argv[])
             cleaner.output_info();
             break;
         }
+        case Mode::Upgrade:
+        {
+            Cleaner cleaner(db_path);
+            cleaner.upgrade();
+            break;
+        }
+        case Mode::Import:
+        {
+            if (table_name.empty())
+                table_name = std::filesystem::path(import_path).stem();
+
+            // NOTE: The path is given to COPY as a string, which can't have quotes in it
+            if (import_path.find('\'') != std::string::npos)
+            {
+                std::cerr << "Cannot import from a path with a quote in it\n";
+                return 1;
+            }
+
+            auto db = page_count > 0
+                ? DataBase::open_cached(db_path, page_count)
+                : DataBase::open(db_path);
+            if (!db)
+                return 1;
+
+            auto *table = db->get_table(table_name);
+            auto row_count_before = table ? table->row_count() : 0;
+            auto result = db->execute_sql("COPY " + table_name + " FROM '" + import_path + "'");
+            if (!result.good())
+            {
+                result.output_errors();
+                return 1;
+            }
+
+            table = db->get_table(table_name);
+            std::cout << "Imported " << (table->row_count() - row_count_before)
+                << " rows into '" << table_name << "'\n";
+            break;
+        }
+        case Mode::Compress:
+        {
+            auto db = DataBase::open(db_path);
+            if (!db)
+                return 1;
+
+            db->begin_transaction();
+            auto *table = db->get_table(table_name);
+            if (!table)
+            {
+                std::cerr << "No table with the name '" << table_name << "' found\n";
+                db->rollback_transaction();
+                return 1;
+            }
+
+            table->set_compressed(true);
+            db->commit_transaction();
+            break;
+        }
     }
     return 0;
 }
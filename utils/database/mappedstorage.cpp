@@ -0,0 +1,197 @@
+#include "config.hpp"
+#include "mappedstorage.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace DB;
+
+static size_t round_up(size_t size, size_t to)
+{
+    return ((size + to - 1) / to) * to;
+}
+
+std::unique_ptr<MappedStorage> MappedStorage::open(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        perror("open()");
+        return nullptr;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0)
+    {
+        perror("fstat()");
+        close(fd);
+        return nullptr;
+    }
+
+    auto storage = std::unique_ptr<MappedStorage>(new MappedStorage(fd, file_stat.st_size));
+    if (!storage->map(round_up(std::max<size_t>(storage->m_size, 1), Config::mapping_grow_size)))
+        return nullptr;
+
+    return storage;
+}
+
+MappedStorage::MappedStorage(int fd, size_t size)
+    : m_fd(fd)
+    , m_size(size)
+    , m_file_size(size)
+{
+}
+
+bool MappedStorage::map(size_t mapped_size)
+{
+    // NOTE: The old mapping is only dropped once the new one is
+    //       made, so it's still there if that fails
+    auto *data = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (data == MAP_FAILED)
+    {
+        perror("mmap()");
+        return false;
+    }
+
+    if (m_data)
+    {
+        flush();
+        munmap(m_data, m_mapped_size);
+    }
+
+    m_data = static_cast<char*>(data);
+    m_mapped_size = mapped_size;
+    return true;
+}
+
+void MappedStorage::read(size_t offset, void *buffer, size_t len)
+{
+    assert (offset + len <= m_mapped_size);
+    memcpy(buffer, m_data + offset, len);
+}
+
+void MappedStorage::write(size_t offset, const void *buffer, size_t len)
+{
+    auto end = offset + len;
+    if (end > m_file_size)
+    {
+        // NOTE: Touching the mapping past the end of the file will SIGBUS,
+        //       so the file is grown along with it, in large steps so that
+        //       appending rows doesn't resize and remap it every time. It's
+        //       cut back to the data once no one else has it open.
+        auto step = std::max(Config::mapping_grow_size, m_mapped_size / 4);
+        grow_file(round_up(end, step));
+        if (m_file_size > m_mapped_size)
+            grow_mapping(m_file_size);
+    }
+    m_size = std::max(m_size, end);
+
+    memcpy(m_data + offset, buffer, len);
+    m_dirty_start = std::min(m_dirty_start, offset);
+    m_dirty_end = std::max(m_dirty_end, end);
+}
+
+void MappedStorage::truncate(size_t size)
+{
+    assert (size <= m_size);
+    m_size = size;
+    if (m_file_size == size)
+        return;
+
+    // NOTE: If it can't be cut back, the file is just bigger than it
+    //       needs to be, and what's past the data is never read
+    if (ftruncate(m_fd, size) < 0)
+    {
+        perror("ftruncate()");
+        return;
+    }
+    m_file_size = size;
+}
+
+void MappedStorage::flush()
+{
+    if (m_dirty_start >= m_dirty_end)
+        return;
+
+    // msync needs a page aligned start address
+    auto page_size = (size_t)sysconf(_SC_PAGESIZE);
+    auto start = (m_dirty_start / page_size) * page_size;
+    msync(m_data + start, m_dirty_end - start, MS_ASYNC);
+
+    m_dirty_start = SIZE_MAX;
+    m_dirty_end = 0;
+}
+
+void MappedStorage::sync()
+{
+    flush();
+    if (msync(m_data, m_mapped_size, MS_SYNC) < 0)
+        perror("msync()");
+}
+
+void MappedStorage::reload()
+{
+    struct stat file_stat;
+    if (fstat(m_fd, &file_stat) < 0)
+    {
+        perror("fstat()");
+        return;
+    }
+
+    // NOTE: Another process may have grown the file past its data,
+    //       the log says where that really ends until it's cut back
+    m_size = file_stat.st_size;
+    m_file_size = m_size;
+    if (m_size > m_mapped_size)
+        grow_mapping(round_up(m_size, Config::mapping_grow_size));
+}
+
+void MappedStorage::grow_file(size_t file_size)
+{
+    // NOTE: Another process may have grown it further already, and
+    //       shrinking it would pull it out from under their mapping
+    struct stat file_stat;
+    if (fstat(m_fd, &file_stat) < 0)
+        perror("fstat()");
+    else if ((size_t)file_stat.st_size >= file_size)
+        m_file_size = file_stat.st_size;
+    else if (ftruncate(m_fd, file_size) < 0)
+        perror("ftruncate()");
+    else
+        m_file_size = file_size;
+
+    if (m_file_size >= file_size)
+        return;
+
+    // NOTE: Like `grow_mapping`, writing on would go past the end of the
+    //       file, which crashes the process later on instead of here
+    fprintf(stderr, "MappedStorage: Could not grow the file to %zu bytes\n", file_size);
+    abort();
+}
+
+void MappedStorage::grow_mapping(size_t mapped_size)
+{
+    if (map(mapped_size))
+        return;
+
+    // NOTE: There's no way to go on without the data being mapped, and
+    //       carrying on anyway would write past the end of the mapping
+    fprintf(stderr, "MappedStorage: Could not map %zu bytes of the file\n", mapped_size);
+    abort();
+}
+
+MappedStorage::~MappedStorage()
+{
+    if (m_data)
+    {
+        flush();
+        munmap(m_data, m_mapped_size);
+    }
+
+    close(m_fd);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "storage.hpp"
+#include <memory>
+#include <string>
+
+namespace DB
+{
+
+    class MappedStorage final : public Storage
+    {
+    public:
+        ~MappedStorage();
+
+        MappedStorage(const MappedStorage&) = delete;
+        MappedStorage(MappedStorage&) = delete;
+
+        static std::unique_ptr<MappedStorage> open(const std::string &path);
+
+        virtual size_t size() const override { return m_size; }
+        virtual void read(size_t offset, void *buffer, size_t len) override;
+        virtual void write(size_t offset, const void *buffer, size_t len) override;
+        virtual void truncate(size_t size) override;
+        virtual void flush() override;
+        virtual void sync() override;
+        virtual void reload() override;
+
+    private:
+        MappedStorage(int fd, size_t size);
+
+        bool map(size_t mapped_size);
+
+        // Like `map`, but a failure is fatal, for when
+        // the caller can't go on without the mapping
+        void grow_mapping(size_t mapped_size);
+
+        // Make the file at least this big, which is also fatal if it fails
+        void grow_file(size_t file_size);
+
+        int m_fd;
+        char *m_data { nullptr };
+        size_t m_size { 0 };
+        size_t m_mapped_size { 0 };
+
+        // The file is grown ahead of the data, so it
+        // can be bigger than `m_size`, see `write`
+        size_t m_file_size { 0 };
+
+        // Range of bytes written since the last flush
+        size_t m_dirty_start { SIZE_MAX };
+        size_t m_dirty_end { 0 };
+
+    };
+
+}
@@ -1,12 +1,24 @@
 #include "config.hpp"
 #include "prompt.hpp"
 #include "database.hpp"
+#include "bufferpool.hpp"
 #include <iostream>
 using namespace DB;
 
-Prompt::Prompt(const std::string &database_path)
+Prompt::Prompt(const std::string &database_path, size_t page_count, size_t thread_count)
 {
-    m_db = DataBase::open(database_path);
+    if (page_count > 0)
+    {
+        m_db = DataBase::open_cached(database_path, page_count);
+        m_is_cached = true;
+    }
+    else
+    {
+        m_db = DataBase::open(database_path);
+    }
+
+    if (m_db && thread_count > 0)
+        m_db->set_thread_count(thread_count);
 }
 
 void Prompt::run()
@@ -21,14 +33,30 @@ void Prompt::run()
         
         std::string line;
         std::getline(std::cin, line);
-        if (line == "exit")
+        if (line == "exit" || std::cin.eof())
             break;
+
+        if (line == "stats")
+        {
+            if (m_is_cached)
+            {
+                auto &pool = static_cast<BufferPool&>(m_db->storage());
+                std::cout << "Cache: hits = " << pool.hit_count() <<
+                    ", misses = " << pool.miss_count() <<
+                    ", pages = " << pool.page_count() << "\n";
+            }
+
+            auto &statements = m_db->statement_cache();
+            std::cout << "Statements: hits = " << statements.hit_count() <<
+                ", misses = " << statements.miss_count() << "\n\n";
+            continue;
+        }
         
-        auto result = m_db->execute_sql(line);
-        if (!result.good())
-            result.output_errors();
+        auto cursor = m_db->query(line);
+        if (!cursor.good())
+            cursor.output_errors();
         
-        for (auto &row : result)
+        for (auto &row : cursor)
             std::cout << row << "\n";
         std::cout << "\n";
     }
@@ -9,11 +9,12 @@ namespace DB
     class Prompt
     {
     public:
-        Prompt(const std::string &database_path);
+        Prompt(const std::string &database_path, size_t page_count = 0, size_t thread_count = 0);
         void run();
         
     private:
         std::shared_ptr<DataBase> m_db;
+        bool m_is_cached { false };
     
     };
     
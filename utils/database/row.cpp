@@ -5,46 +5,37 @@
 #include "chunk.hpp"
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 using namespace DB;
 
-Row::Row(const std::vector<Column> &columns)
+Row::Row(std::shared_ptr<const std::vector<Column>> columns, size_t row_size)
+    : m_columns(std::move(columns))
+    , m_row_size(row_size)
 {
-    size_t entry_offset = Config::row_header_size;
-    for (const auto &column : columns)
-    {
-        m_entities.push_back({ column, entry_offset, column.null() });
-        entry_offset += column.data_type().size();
-    }
-
-    m_row_size = entry_offset;
+    m_entities.reserve(m_columns->size());
+    for (const auto &column : *m_columns)
+        m_entities.push_back({ &column, column.null() });
 }
 
-Row::Row(std::vector<std::string> select_columns, Row &&other)
+Row::Row(std::shared_ptr<const std::vector<Column>> columns, size_t row_size, const std::vector<bool> &selected)
+    : m_columns(std::move(columns))
+    , m_row_size(row_size)
 {
-    size_t entry_offset = Config::row_header_size;
-    for (auto &entity : other.m_entities)
+    assert (m_columns->size() == selected.size());
+
+    for (size_t i = 0; i < m_columns->size(); i++)
     {
-        // Only copy in if it's in the selected columns,
-        // then remove it from the list
-        auto column = entity.column;
-        auto index = std::find(select_columns.begin(), select_columns.end(), column.name());
-        if (index != select_columns.end())
-        {
-            m_entities.push_back({ column, entry_offset, std::move(entity.entry)});
-            select_columns.erase(index);
-        }
-        
-        entry_offset += column.data_type().size();
+        if (selected[i])
+            m_entities.push_back({ &(*m_columns)[i], (*m_columns)[i].null() });
     }
-    m_row_size = other.m_row_size;
 }
 
 std::unique_ptr<Entry> const &Row::operator [](const std::string &name)
 {
     for (auto &entity : m_entities)
     {
-        if (entity.column.name() == name)
+        if (entity.column->name() == name)
             return entity.entry;
     }
 
@@ -56,7 +47,7 @@ const std::unique_ptr<Entry> &Row::operator [](const std::string &name) const
 {
     for (const auto &entity : m_entities)
     {
-        if (entity.column.name() == name)
+        if (entity.column->name() == name)
             return entity.entry;
     }
 
@@ -76,26 +67,22 @@ std::ostream &operator<<(std::ostream &stream, const Row& row)
     return stream;
 }
 
-void Row::read(Chunk &chunk, size_t row_offset)
+void Row::decode(Table &table, const char *data)
 {
     for (auto &entitiy : m_entities)
-    {
-        auto &entry = entitiy.entry;
-        auto offset = row_offset + entitiy.offset_in_row;
-        entry = entitiy.column.read(chunk, offset);
-    }
+        entitiy.entry = entitiy.column->decode(table, data);
 }
 
-void Row::write(Chunk &chunk, size_t row_offset)
+void Row::encode(Table &table, char *data)
 {
-    for (size_t i = row_offset; i < m_row_size; i++)
-        chunk.write_byte(i, 0xCD);
-
+    memset(data, 0xCD, m_row_size);
     for (const auto &entitiy : m_entities)
     {
         auto &entry = entitiy.entry;
-        auto offset = row_offset + entitiy.offset_in_row;
-        if (entry)
-            entry->write(chunk, offset);
+        if (!entry)
+            continue;
+
+        entitiy.column->set_null(data, entry->is_null());
+        entry->encode(table, data + entitiy.column->offset());
     }
 }
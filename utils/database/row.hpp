@@ -12,7 +12,11 @@ namespace DB
     class Row
     {
         friend Table;
+        friend RowView;
         friend Sql::SelectStatement;
+        friend Sql::Scan;
+        friend Sql::Aggregation;
+        friend Sql::Sort;
 
     public:
         class const_itorator
@@ -26,7 +30,7 @@ namespace DB
             std::pair<std::string, const Entry*> operator*() const
             {
                 auto &entitiy = m_row.m_entities[m_index];
-                return std::make_pair(entitiy.column.name(), entitiy.entry.get());
+                return std::make_pair(entitiy.column->name(), entitiy.entry.get());
             }
 
         private:
@@ -43,21 +47,26 @@ namespace DB
         std::unique_ptr<Entry> const &operator [](const std::string &name);
         const std::unique_ptr<Entry> &operator [](const std::string &name) const;
 
-        void read(Chunk &chunk, size_t row_offset);
-        void write(Chunk &chunk, size_t row_offset);
+        // Rows are read and written as one buffer of `size_in_bytes()`
+        inline size_t size_in_bytes() const { return m_row_size; }
+        void decode(Table &table, const char *data);
+        void encode(Table &table, char *data);
 
     private:
-        explicit Row(const std::vector<Column> &columns);
+        explicit Row(std::shared_ptr<const std::vector<Column>> columns, size_t row_size);
 
-        // Create a row based of a selection
-        explicit Row(std::vector<std::string> select_columns, Row &&other);
+        // Create a row with only the selected columns, so
+        // decoding it skips the others
+        explicit Row(std::shared_ptr<const std::vector<Column>> columns, size_t row_size, const std::vector<bool> &selected);
 
+        // NOTE: Rows share their columns with the table (or aggregate)
+        //       they're from, rather than each having a copy
         struct Entity
         {
-            Column column;
-            size_t offset_in_row;
+            const Column *column;
             std::unique_ptr<Entry> entry;
         };
+        std::shared_ptr<const std::vector<Column>> m_columns;
         std::vector<Entity> m_entities;
         size_t m_row_size;
     };
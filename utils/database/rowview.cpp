@@ -0,0 +1,66 @@
+#include "rowview.hpp"
+#include "table.hpp"
+#include <cassert>
+#include <cstring>
+using namespace DB;
+
+const std::vector<Column> &RowView::columns() const
+{
+    return m_table->columns();
+}
+
+bool RowView::is_null(size_t column) const
+{
+    return columns()[column].is_null(m_data);
+}
+
+int32_t RowView::integer(size_t column) const
+{
+    const auto &table_column = columns()[column];
+    assert (table_column.data_type().primitive() == DataType::Integer);
+
+    int32_t value;
+    memcpy(&value, m_data + table_column.offset(), sizeof(value));
+    return value;
+}
+
+int64_t RowView::big_int(size_t column) const
+{
+    const auto &table_column = columns()[column];
+    assert (table_column.data_type().primitive() == DataType::BigInt);
+
+    int64_t value;
+    memcpy(&value, m_data + table_column.offset(), sizeof(value));
+    return value;
+}
+
+float RowView::float_(size_t column) const
+{
+    const auto &table_column = columns()[column];
+    assert (table_column.data_type().primitive() == DataType::Float);
+
+    float value;
+    memcpy(&value, m_data + table_column.offset(), sizeof(value));
+    return value;
+}
+
+std::string_view RowView::char_value(size_t column) const
+{
+    return columns()[column].char_value(m_data);
+}
+
+void RowView::read_text(size_t column, std::string &text) const
+{
+    const auto &table_column = columns()[column];
+    assert (table_column.data_type().primitive() == DataType::Text);
+    m_table->read_text(table_column.data_type(), m_data + table_column.offset(), text);
+}
+
+Row RowView::decode() const
+{
+    auto row = m_projection
+        ? Row(m_table->schema(), m_table->row_size(), *m_projection)
+        : Row(m_table->schema(), m_table->row_size());
+    row.decode(*m_table, m_data);
+    return row;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "forward.hpp"
+#include "column.hpp"
+#include "row.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace DB
+{
+
+    // A row of a table as it's encoded, with its columns read one at a
+    // time straight from the bytes, so nothing is allocated to look at
+    // it. It's a view of a buffer owned by whatever made it, like a
+    // scan's batch of rows, and only lasts until that moves on. A `Row`
+    // is only decoded from it when it's handed to the caller.
+    class RowView
+    {
+    public:
+        // Only the selected columns are decoded, if given
+        RowView(Table &table, const char *data, const std::vector<bool> *projection = nullptr)
+            : m_table(&table)
+            , m_data(data)
+            , m_projection(projection) {}
+
+        inline const char *data() const { return m_data; }
+        const std::vector<Column> &columns() const;
+
+        bool is_null(size_t column) const;
+        int32_t integer(size_t column) const;
+        int64_t big_int(size_t column) const;
+        float float_(size_t column) const;
+
+        // Up to the first null byte, which may be a view of the column's dictionary
+        std::string_view char_value(size_t column) const;
+
+        // Text is kept elsewhere, so this reads it into `text`
+        void read_text(size_t column, std::string &text) const;
+
+        Row decode() const;
+
+    private:
+        Table *m_table;
+        const char *m_data;
+        const std::vector<bool> *m_projection;
+
+    };
+
+}
@@ -0,0 +1,458 @@
+#include "aggregate.hpp"
+#include "columnscan.hpp"
+#include "../table.hpp"
+#include "../column.hpp"
+#include "../entry.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+using namespace DB;
+using namespace DB::Sql;
+
+std::optional<AggregateColumn::Function> AggregateColumn::function_from_name(const std::string &name)
+{
+    auto lower = name;
+    std::for_each(lower.begin(), lower.end(), [](char &c)
+    {
+        c = ::tolower(c);
+    });
+
+    if (lower == "count")
+        return Count;
+    else if (lower == "sum")
+        return Sum;
+    else if (lower == "min")
+        return Min;
+    else if (lower == "max")
+        return Max;
+    else if (lower == "avg")
+        return Avg;
+    return std::nullopt;
+}
+
+std::string AggregateColumn::name() const
+{
+    auto argument = column.empty() ? "*" : column;
+    switch (function)
+    {
+        case None: return column;
+        case Count: return "count(" + argument + ")";
+        case Sum: return "sum(" + argument + ")";
+        case Min: return "min(" + argument + ")";
+        case Max: return "max(" + argument + ")";
+        case Avg: return "avg(" + argument + ")";
+    }
+
+    assert (false);
+    return column;
+}
+
+static bool is_numeric(DataType type)
+{
+    switch (type.primitive())
+    {
+        case DataType::Integer:
+        case DataType::BigInt:
+        case DataType::Float:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static int64_t read_integer(const Column &column, const char *row)
+{
+    auto data = row + column.offset();
+    if (column.data_type().primitive() == DataType::Integer)
+    {
+        int32_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    int64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static float read_float(const Column &column, const char *row)
+{
+    float value;
+    memcpy(&value, row + column.offset(), sizeof(value));
+    return value;
+}
+
+Aggregation::Aggregation(Table &table, const std::vector<AggregateColumn> &columns, const std::vector<std::string> &group_by)
+    : m_table(table)
+{
+    for (const auto &name : group_by)
+    {
+        auto column = find_column(name);
+        if (!column)
+            return;
+
+        m_group_by.push_back(column);
+    }
+
+    for (const auto &aggregate : columns)
+    {
+        auto name = aggregate.name();
+        if (aggregate.function == AggregateColumn::Count && aggregate.column.empty())
+        {
+            m_outputs.push_back({ aggregate.function, nullptr });
+            m_result_columns.push_back(Column(name, DataType::big_int()));
+            continue;
+        }
+
+        auto column = find_column(aggregate.column);
+        if (!column)
+            return;
+
+        auto type = column->data_type();
+        switch (aggregate.function)
+        {
+            case AggregateColumn::None:
+                if (std::find(group_by.begin(), group_by.end(), aggregate.column) == group_by.end())
+                {
+                    m_error = "Column '" + aggregate.column + "' has to be grouped by to be selected";
+                    return;
+                }
+                break;
+            case AggregateColumn::Count:
+                type = DataType::big_int();
+                break;
+            case AggregateColumn::Sum:
+            case AggregateColumn::Avg:
+                if (!is_numeric(type))
+                {
+                    m_error = "Cannot find the " + name + " of a non-numeric column";
+                    return;
+                }
+
+                if (aggregate.function == AggregateColumn::Avg || type.primitive() == DataType::Float)
+                    type = DataType::float_();
+                else
+                    type = DataType::big_int();
+                break;
+            case AggregateColumn::Min:
+            case AggregateColumn::Max:
+                break;
+        }
+
+        m_outputs.push_back({ aggregate.function, column });
+        m_result_columns.push_back(Column(name, type));
+    }
+}
+
+const Column *Aggregation::find_column(const std::string &name)
+{
+    auto index = m_table.column_index(name);
+    if (!index)
+    {
+        m_error = "No column with the name '" + name + "' found";
+        return nullptr;
+    }
+
+    return &m_table.columns()[*index];
+}
+
+void Aggregation::make_key(const char *row)
+{
+    m_key.clear();
+    for (const auto *column : m_group_by)
+    {
+        if (column->is_null(row))
+        {
+            m_key += '\0';
+            continue;
+        }
+
+        m_key += '\1';
+        auto data = row + column->offset();
+        auto type = column->data_type();
+        switch (type.primitive())
+        {
+            case DataType::Char:
+                // NOTE: Values with a dictionary are grouped by
+                //       their code, which is the same size for all
+                if (type.has_dictionary())
+                {
+                    m_key.append(data, type.data_size());
+                    break;
+                }
+
+                // NOTE: The value ends at the first null byte, so
+                //       it can be used to mark the end in the key
+                m_key.append(data, strnlen(data, type.data_size()));
+                m_key += '\0';
+                break;
+            case DataType::Text:
+            {
+                // NOTE: Text is kept elsewhere, the row
+                //       only has where to find it
+                auto text = column->decode(m_table, row)->as_string();
+                auto size = text.size();
+                m_key.append(reinterpret_cast<const char*>(&size), sizeof(size));
+                m_key += text;
+                break;
+            }
+            default:
+                m_key.append(data, type.data_size());
+                break;
+        }
+    }
+}
+
+void Aggregation::add(const char *row)
+{
+    if (!good())
+        return;
+
+    make_key(row);
+    auto [it, is_new] = m_group_indices.try_emplace(m_key, m_groups.size());
+    if (is_new)
+    {
+        m_groups.emplace_back(m_outputs.size());
+        for (size_t i = 0; i < m_outputs.size(); i++)
+        {
+            const auto &output = m_outputs[i];
+            if (output.function == AggregateColumn::None)
+                m_groups.back()[i].best = output.column->decode(m_table, row);
+        }
+    }
+
+    auto &totals = m_groups[it->second];
+    for (size_t i = 0; i < m_outputs.size(); i++)
+        update(totals[i], m_outputs[i], row);
+}
+
+void Aggregation::update(Total &total, const Output &output, const char *row)
+{
+    if (output.function == AggregateColumn::None)
+        return;
+
+    // NOTE: Functions ignore null values, and COUNT(*) counts every row
+    const auto *column = output.column;
+    if (column && column->is_null(row))
+        return;
+
+    total.count += 1;
+    switch (output.function)
+    {
+        case AggregateColumn::Sum:
+        case AggregateColumn::Avg:
+            if (column->data_type().primitive() == DataType::Float)
+                total.float_sum += read_float(*column, row);
+            else
+                total.int_sum += read_integer(*column, row);
+            break;
+        case AggregateColumn::Min:
+        case AggregateColumn::Max:
+        {
+            if (!total.best)
+            {
+                total.best = column->decode(m_table, row);
+                break;
+            }
+
+            auto order = compare(*column, row, *total.best);
+            if ((output.function == AggregateColumn::Min && order < 0) ||
+                (output.function == AggregateColumn::Max && order > 0))
+            {
+                total.best = column->decode(m_table, row);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+bool Aggregation::can_add_blocks() const
+{
+    if (!good() || !m_group_by.empty())
+        return false;
+
+    for (const auto &output : m_outputs)
+    {
+        if (output.function == AggregateColumn::Count)
+            continue;
+        if (output.function == AggregateColumn::None || !is_numeric(output.column->data_type()))
+            return false;
+    }
+
+    return true;
+}
+
+template <typename T>
+static std::optional<T> block_best(const char *values, size_t count, const uint64_t *selection, bool is_max)
+{
+    auto *typed_values = reinterpret_cast<const T*>(values);
+    if (is_max)
+        return Kernels::max(typed_values, count, selection);
+    return Kernels::min(typed_values, count, selection);
+}
+
+void Aggregation::add_block(ColumnScan &scan)
+{
+    assert (can_add_blocks());
+
+    // NOTE: Without groups, every row is in the one group
+    if (m_groups.empty())
+        m_groups.emplace_back(m_outputs.size());
+
+    auto count = scan.count();
+    auto words = (count + 63) / 64;
+    auto &totals = m_groups[0];
+    for (size_t i = 0; i < m_outputs.size(); i++)
+    {
+        const auto &output = m_outputs[i];
+        auto &total = totals[i];
+        if (!output.column)
+        {
+            for (size_t word = 0; word < words; word++)
+                total.count += __builtin_popcountll(scan.selection()[word]);
+            continue;
+        }
+
+        // NOTE: Functions ignore null values, so they're taken out of the selection
+        auto column = (size_t)(output.column - m_table.columns().data());
+        const auto *nulls = scan.nulls(column);
+        m_selection.resize(words);
+        for (size_t word = 0; word < words; word++)
+        {
+            m_selection[word] = scan.selection()[word] & ~nulls[word];
+            total.count += __builtin_popcountll(m_selection[word]);
+        }
+
+        if (output.function == AggregateColumn::Count)
+            continue;
+
+        const char *values = scan.values(column);
+        auto primitive = output.column->data_type().primitive();
+        if (output.function == AggregateColumn::Sum || output.function == AggregateColumn::Avg)
+        {
+            if (primitive == DataType::Integer)
+                total.int_sum += Kernels::sum((const int32_t*)values, count, m_selection.data());
+            else if (primitive == DataType::BigInt)
+                total.int_sum += Kernels::sum((const int64_t*)values, count, m_selection.data());
+            else
+                total.float_sum += Kernels::sum((const float*)values, count, m_selection.data());
+            continue;
+        }
+
+        bool is_max = (output.function == AggregateColumn::Max);
+        auto is_better = [&](auto value, auto best)
+        {
+            return is_max ? value > best : value < best;
+        };
+
+        switch (primitive)
+        {
+            case DataType::Integer:
+            {
+                auto best = block_best<int32_t>(values, count, m_selection.data(), is_max);
+                if (best && (!total.best || is_better(*best, total.best->as_int())))
+                    total.best = std::make_unique<IntegerEntry>(*best);
+                break;
+            }
+            case DataType::BigInt:
+            {
+                auto best = block_best<int64_t>(values, count, m_selection.data(), is_max);
+                if (best && (!total.best || is_better(*best, total.best->as_long())))
+                    total.best = std::make_unique<BigIntEntry>(*best);
+                break;
+            }
+            case DataType::Float:
+            {
+                auto best = block_best<float>(values, count, m_selection.data(), is_max);
+                if (best && (!total.best || is_better(*best, total.best->as_float())))
+                    total.best = std::make_unique<FloatEntry>(*best);
+                break;
+            }
+            default:
+                assert (false);
+        }
+    }
+}
+
+int Aggregation::compare(const Column &column, const char *row, const Entry &entry)
+{
+    auto order = [](const auto &a, const auto &b)
+    {
+        return (a > b) - (a < b);
+    };
+
+    auto type = column.data_type();
+    switch (type.primitive())
+    {
+        case DataType::Integer:
+            return order(read_integer(column, row), (int64_t)entry.as_int());
+        case DataType::BigInt:
+            return order(read_integer(column, row), entry.as_long());
+        case DataType::Float:
+            return order(read_float(column, row), entry.as_float());
+        case DataType::Char:
+            return column.char_value(row).compare(entry.as_string());
+        case DataType::Text:
+            return column.decode(m_table, row)->as_string().compare(entry.as_string());
+        default:
+            assert (false);
+            return 0;
+    }
+}
+
+std::unique_ptr<Entry> Aggregation::result(Total &total, size_t output)
+{
+    const auto &result_column = m_result_columns[output];
+    auto function = m_outputs[output].function;
+    if (function == AggregateColumn::Count)
+        return std::make_unique<BigIntEntry>(total.count);
+
+    if (function == AggregateColumn::None ||
+        function == AggregateColumn::Min ||
+        function == AggregateColumn::Max)
+    {
+        if (!total.best)
+            return result_column.null();
+        return std::move(total.best);
+    }
+
+    if (total.count == 0)
+        return result_column.null();
+
+    auto is_float = m_outputs[output].column->data_type().primitive() == DataType::Float;
+    if (function == AggregateColumn::Avg)
+    {
+        auto sum = is_float ? total.float_sum : (double)total.int_sum;
+        return std::make_unique<FloatEntry>(sum / total.count);
+    }
+
+    if (is_float)
+        return std::make_unique<FloatEntry>(total.float_sum);
+    return std::make_unique<BigIntEntry>(total.int_sum);
+}
+
+std::vector<Row> Aggregation::finish()
+{
+    // NOTE: Without any groups, the functions are
+    //       found over all rows, even if there are none
+    if (m_group_by.empty() && m_groups.empty())
+        m_groups.emplace_back(m_outputs.size());
+
+    // NOTE: Every group's row shares the one copy of the columns
+    auto columns = std::make_shared<const std::vector<Column>>(m_result_columns);
+    std::vector<Row> rows;
+    rows.reserve(m_groups.size());
+    for (auto &totals : m_groups)
+    {
+        Row row(columns, 0);
+        for (size_t i = 0; i < m_outputs.size(); i++)
+            row.m_entities[i].entry = result(totals[i], i);
+        rows.push_back(std::move(row));
+    }
+
+    m_groups.clear();
+    m_group_indices.clear();
+    return rows;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "../forward.hpp"
+#include "../row.hpp"
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace DB::Sql
+{
+
+    // A column of an aggregated select, either one of the
+    // columns grouped by or a function of a column's values
+    struct AggregateColumn
+    {
+        enum Function
+        {
+            None,
+            Count,
+            Sum,
+            Min,
+            Max,
+            Avg,
+        };
+
+        Function function { None };
+
+        // Empty for COUNT(*)
+        std::string column;
+
+        static std::optional<Function> function_from_name(const std::string&);
+        std::string name() const;
+    };
+
+    // Groups the rows of a scan by the values of some of their columns,
+    // keeping only a running total of each function for each group.
+    // Groups are found by hashing their values, which are read straight
+    // from the encoded rows, so no row is decoded and only one row per
+    // group is ever made.
+    class Aggregation
+    {
+    public:
+        Aggregation(Table&, const std::vector<AggregateColumn>&, const std::vector<std::string> &group_by);
+
+        inline bool good() const { return m_error.empty(); }
+        inline const std::string &error() const { return m_error; }
+
+        void add(const char *row);
+
+        // Whether whole blocks of a columnar scan can be added, which is
+        // only without groups and for counts or functions of numbers
+        bool can_add_blocks() const;
+
+        // Add the matching rows of the scan's current block, a column
+        // at a time with `Kernels`, without putting any rows together
+        void add_block(ColumnScan&);
+
+        // A row for each group, in the order they were first found
+        std::vector<Row> finish();
+
+    private:
+        struct Output
+        {
+            AggregateColumn::Function function;
+
+            // The table column read, or null for COUNT(*)
+            const Column *column;
+        };
+
+        // Grouped columns keep their value as `best`
+        struct Total
+        {
+            int64_t count { 0 };
+            int64_t int_sum { 0 };
+            double float_sum { 0 };
+            std::unique_ptr<Entry> best;
+        };
+
+        const Column *find_column(const std::string &name);
+        void make_key(const char *row);
+        void update(Total&, const Output&, const char *row);
+        int compare(const Column&, const char *row, const Entry&);
+        std::unique_ptr<Entry> result(Total&, size_t output);
+
+        Table &m_table;
+        std::string m_error;
+        std::vector<Output> m_outputs;
+        std::vector<Column> m_result_columns;
+        std::vector<const Column*> m_group_by;
+
+        std::unordered_map<std::string, size_t> m_group_indices;
+        std::vector<std::vector<Total>> m_groups;
+        std::string m_key;
+        std::vector<uint64_t> m_selection;
+
+    };
+
+}
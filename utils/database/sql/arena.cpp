@@ -0,0 +1,8 @@
+#include "arena.hpp"
+using namespace DB::Sql;
+
+Arena::~Arena()
+{
+    for (auto *destructor = m_destructors; destructor; destructor = destructor->next)
+        destructor->destroy(destructor->object);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "../forward.hpp"
+#include "../config.hpp"
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace DB::Sql
+{
+
+    // Memory for the short-lived objects of one statement, like its
+    // parse tree, handed out by bumping a pointer along a block. The
+    // first block is part of the arena, so small statements don't
+    // allocate at all, and everything is freed in one go when the
+    // arena is. Objects made with `make` have their destructors run
+    // then, in reverse order.
+    //
+    // NOTE: Memory is never reused, so containers that keep growing
+    //       shouldn't use the arena, and it's not thread safe
+    class Arena
+    {
+    public:
+        Arena()
+            : m_memory(m_first_block, sizeof(m_first_block)) {}
+        ~Arena();
+
+        Arena(const Arena&) = delete;
+        Arena(Arena&) = delete;
+
+        inline std::pmr::memory_resource *resource() { return &m_memory; }
+
+        template <typename T, typename... Args>
+        T *make(Args&&... args)
+        {
+            auto *object = new (m_memory.allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            if constexpr (!std::is_trivially_destructible_v<T>)
+            {
+                auto *destructor = new (m_memory.allocate(sizeof(Destructor), alignof(Destructor))) Destructor;
+                destructor->destroy = [](void *object) { static_cast<T*>(object)->~T(); };
+                destructor->object = object;
+                destructor->next = m_destructors;
+                m_destructors = destructor;
+            }
+
+            return object;
+        }
+
+    private:
+        struct Destructor
+        {
+            void (*destroy)(void*);
+            void *object;
+            Destructor *next;
+        };
+
+        alignas(std::max_align_t) std::byte m_first_block[Config::arena_block_size];
+        std::pmr::monotonic_buffer_resource m_memory;
+        Destructor *m_destructors { nullptr };
+
+    };
+
+}
@@ -0,0 +1,12 @@
+#include "begin.hpp"
+#include "../database.hpp"
+using namespace DB;
+using namespace DB::Sql;
+
+SqlResult BeginStatement::execute(DataBase &db) const
+{
+    if (!db.begin_transaction())
+        return SqlResult::error("Already in a transaction");
+
+    return SqlResult::ok();
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "statement.hpp"
+
+namespace DB::Sql
+{
+
+    class BeginStatement : public Statement
+    {
+        friend Parser;
+
+    public:
+        virtual SqlResult execute(DataBase&) const override;
+
+    private:
+        BeginStatement()
+            : Statement(Type::Begin) {}
+
+    };
+
+}
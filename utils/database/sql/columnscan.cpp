@@ -0,0 +1,173 @@
+#include "columnscan.hpp"
+#include "scan.hpp"
+#include "value.hpp"
+#include "../table.hpp"
+#include "../config.hpp"
+#include <algorithm>
+#include <cassert>
+using namespace DB;
+using namespace DB::Sql;
+
+static constexpr size_t block_words = (Config::columnar_segment_rows + 63) / 64;
+
+ColumnScan::ColumnScan(Table &table, const ValueNode *where)
+    : m_table(table)
+    , m_where(where)
+{
+    if (!table.is_columnar() || (m_where && !plan(*m_where)))
+    {
+        m_is_good = false;
+        return;
+    }
+
+    auto column_count = table.columns().size();
+    m_values.resize(column_count);
+    m_nulls.resize(column_count);
+    m_has_read.resize(column_count);
+    m_selection.resize(block_words);
+
+    // NOTE: Blocks of a columnar table are its segments
+    table.for_each_block([&](size_t first, size_t count, const ZoneMap::Zone *zone)
+    {
+        if (zone && m_where && !Scan::could_match(m_table, *m_where, *zone))
+            return;
+        m_blocks.emplace_back(first, count);
+    });
+}
+
+bool ColumnScan::plan(const ValueNode &node)
+{
+    if (node.type() == ValueNode::Type::And)
+        return plan(*node.left()) && plan(*node.right());
+
+    if (node.type() != ValueNode::Type::Equals && node.type() != ValueNode::Type::MoreThan)
+        return false;
+
+    const ValueNode *column = node.left();
+    const ValueNode *value = node.right();
+    bool is_column_on_left = true;
+    if (column->type() != ValueNode::Type::Column)
+    {
+        std::swap(column, value);
+        is_column_on_left = false;
+    }
+
+    if (column->type() != ValueNode::Type::Column || !value->is_constant())
+        return false;
+
+    auto index = m_table.column_index(column->left()->value().as_string());
+    if (!index)
+        return false;
+
+    Filter filter { *index, Kernels::Compare::Equals, 0, 0 };
+    if (node.type() == ValueNode::Type::MoreThan)
+        filter.compare = is_column_on_left ? Kernels::Compare::MoreThan : Kernels::Compare::LessThan;
+
+    // NOTE: Only comparisons done in the column's own type are
+    //       filtered here, the same way the program would do them
+    const auto &constant = value->value();
+    switch (m_table.columns()[*index].data_type().primitive())
+    {
+        case DataType::Integer:
+            if (constant.type() != Value::Integer ||
+                constant.as_int() < INT32_MIN || constant.as_int() > INT32_MAX)
+            {
+                return false;
+            }
+            filter.int_value = constant.as_int();
+            break;
+        case DataType::BigInt:
+            if (constant.type() != Value::Integer)
+                return false;
+            filter.int_value = constant.as_int();
+            break;
+        case DataType::Float:
+            if (constant.type() == Value::Integer)
+                filter.float_value = (float)constant.as_int();
+            else if (constant.type() == Value::Float)
+                filter.float_value = constant.as_float();
+            else
+                return false;
+            break;
+        default:
+            return false;
+    }
+
+    m_filters.push_back(filter);
+    return true;
+}
+
+void ColumnScan::read(size_t column)
+{
+    auto data_size = m_table.columns()[column].data_type().data_size();
+    auto &values = m_values[column];
+    auto &nulls = m_nulls[column];
+    values.resize((Config::columnar_segment_rows * data_size + 7) / 8);
+    nulls.resize(block_words);
+
+    auto [first, count] = m_blocks[m_next_block - 1];
+    m_table.read_column(first, count, column, (char*)values.data(), nulls.data());
+    m_has_read[column] = true;
+}
+
+const char *ColumnScan::values(size_t column)
+{
+    if (!m_has_read[column])
+        read(column);
+    return (const char*)m_values[column].data();
+}
+
+const uint64_t *ColumnScan::nulls(size_t column)
+{
+    if (!m_has_read[column])
+        read(column);
+    return m_nulls[column].data();
+}
+
+bool ColumnScan::next()
+{
+    assert (good());
+    while (m_next_block < m_blocks.size())
+    {
+        auto first = m_blocks[m_next_block].first;
+        m_count = m_blocks[m_next_block].second;
+        m_next_block += 1;
+        std::fill(m_has_read.begin(), m_has_read.end(), false);
+
+        // Start with every row, then narrow it down a column at a time
+        std::fill(m_selection.begin(), m_selection.end(), 0);
+        std::fill(m_selection.begin(), m_selection.begin() + m_count / 64, UINT64_MAX);
+        if (m_count % 64 != 0)
+            m_selection[m_count / 64] = (uint64_t(1) << (m_count % 64)) - 1;
+        m_table.unselect_deleted(first, m_count, m_selection.data());
+
+        for (const auto &filter : m_filters)
+        {
+            const char *data = values(filter.column);
+            switch (m_table.columns()[filter.column].data_type().primitive())
+            {
+                case DataType::Integer:
+                    Kernels::filter((const int32_t*)data, m_count, filter.compare,
+                        (int32_t)filter.int_value, m_selection.data());
+                    break;
+                case DataType::BigInt:
+                    Kernels::filter((const int64_t*)data, m_count, filter.compare,
+                        filter.int_value, m_selection.data());
+                    break;
+                case DataType::Float:
+                    Kernels::filter((const float*)data, m_count, filter.compare,
+                        filter.float_value, m_selection.data());
+                    break;
+                default:
+                    assert (false);
+            }
+        }
+
+        auto has_match = std::any_of(m_selection.begin(), m_selection.end(),
+            [](uint64_t word) { return word != 0; });
+        if (has_match)
+            return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "../forward.hpp"
+#include "kernels.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace DB::Sql
+{
+
+    // Steps through the segments of a columnar table a block at a time,
+    // reading only the columns it's asked for. A condition made only of
+    // numeric columns compared with constants, and'd together, is
+    // checked a column at a time with `Kernels::filter`, giving a
+    // bitmap of the rows in the block that match. Any other condition
+    // can't be, so the scan isn't good and rows have to be read whole.
+    class ColumnScan
+    {
+    public:
+        ColumnScan(Table&, const ValueNode *where);
+
+        inline bool good() const { return m_is_good; }
+
+        // Move on to the next block with any matches,
+        // returns false once there are no more
+        bool next();
+
+        // The rows of the current block, and which of them match
+        inline size_t count() const { return m_count; }
+        inline const uint64_t *selection() const { return m_selection.data(); }
+
+        // A column of the current block, see `Table::read_column`
+        const char *values(size_t column);
+        const uint64_t *nulls(size_t column);
+
+    private:
+        struct Filter
+        {
+            size_t column;
+            Kernels::Compare compare;
+            int64_t int_value;
+            float float_value;
+        };
+
+        bool plan(const ValueNode&);
+        void read(size_t column);
+
+        Table &m_table;
+        const ValueNode *m_where;
+        bool m_is_good { true };
+        std::vector<Filter> m_filters;
+
+        // Blocks the zone map doesn't rule out, as their first row and count
+        std::vector<std::pair<size_t, size_t>> m_blocks;
+        size_t m_next_block { 0 };
+        size_t m_count { 0 };
+        std::vector<uint64_t> m_selection;
+
+        // Each column is read on first use in a block, kept in words
+        // so the values are aligned for any type
+        std::vector<std::vector<uint64_t>> m_values;
+        std::vector<std::vector<uint64_t>> m_nulls;
+        std::vector<bool> m_has_read;
+
+    };
+
+}
@@ -0,0 +1,14 @@
+#include "commit.hpp"
+#include "../database.hpp"
+using namespace DB;
+using namespace DB::Sql;
+
+SqlResult CommitStatement::execute(DataBase &db) const
+{
+    if (!db.is_transaction_thread())
+        return SqlResult::error("Not in a transaction");
+    if (!db.commit_transaction())
+        return SqlResult::error("Could not write to the log, so the transaction was rolled back");
+
+    return SqlResult::ok();
+}
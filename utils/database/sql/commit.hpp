@@ -0,0 +1,20 @@
+#pragma once
+#include "statement.hpp"
+
+namespace DB::Sql
+{
+
+    class CommitStatement : public Statement
+    {
+        friend Parser;
+
+    public:
+        virtual SqlResult execute(DataBase&) const override;
+
+    private:
+        CommitStatement()
+            : Statement(Type::Commit) {}
+
+    };
+
+}
@@ -0,0 +1,196 @@
+#include "copy.hpp"
+#include "../database.hpp"
+#include "../config.hpp"
+#include "value.hpp"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+using namespace DB;
+using namespace DB::Sql;
+
+struct Field
+{
+    std::string text;
+    bool is_quoted;
+};
+
+// Read the fields of the next record, counting the lines it takes up.
+// Returns false once there are no more records.
+static bool read_record(std::streambuf &in, std::vector<Field> &fields, size_t &field_count, size_t &line)
+{
+    if (in.sgetc() == EOF)
+        return false;
+
+    field_count = 0;
+    for (;;)
+    {
+        if (field_count >= fields.size())
+            fields.emplace_back();
+
+        auto &field = fields[field_count++];
+        field.text.clear();
+        field.is_quoted = false;
+
+        auto c = in.sbumpc();
+        if (c == '"')
+        {
+            // NOTE: Quoted fields can have commas and new lines
+            //       in them, and a quote is written twice
+            field.is_quoted = true;
+            for (;;)
+            {
+                c = in.sbumpc();
+                if (c == EOF)
+                    break;
+
+                if (c == '"')
+                {
+                    if (in.sgetc() != '"')
+                        break;
+                    in.sbumpc();
+                }
+                else if (c == '\n')
+                {
+                    line += 1;
+                }
+
+                field.text += (char)c;
+            }
+
+            c = in.sbumpc();
+        }
+
+        while (c != ',' && c != '\n' && c != '\r' && c != EOF)
+        {
+            field.text += (char)c;
+            c = in.sbumpc();
+        }
+
+        if (c == ',')
+            continue;
+
+        if (c == '\r' && in.sgetc() == '\n')
+            in.sbumpc();
+        line += 1;
+        return true;
+    }
+}
+
+static std::optional<Value> parse_field(const Field &field, const DataType &type)
+{
+    const auto &text = field.text;
+    switch (type.primitive())
+    {
+        case DataType::Integer:
+        case DataType::BigInt:
+        {
+            char *end;
+            errno = 0;
+            auto i = std::strtoll(text.c_str(), &end, 10);
+            if (text.empty() || *end != '\0' || errno == ERANGE)
+                return std::nullopt;
+            if (type.primitive() == DataType::Integer && (i < INT_MIN || i > INT_MAX))
+                return std::nullopt;
+            return Value((int64_t)i);
+        }
+        case DataType::Float:
+        {
+            char *end;
+            auto f = std::strtof(text.c_str(), &end);
+            if (text.empty() || *end != '\0')
+                return std::nullopt;
+            return Value(f);
+        }
+        case DataType::Char:
+            if (text.size() > type.length())
+                return std::nullopt;
+            return Value(text);
+        case DataType::Text:
+            return Value(text);
+        default:
+            assert (false);
+            return std::nullopt;
+    }
+}
+
+SqlResult CopyStatement::execute(DataBase &db) const
+{
+    auto table = db.get_table(m_table);
+    if (!table)
+        return SqlResult::error("No table with the name '" + m_table + "' found");
+
+    std::ifstream file(m_path, std::ios::binary);
+    if (!file)
+        return SqlResult::error("Could not open '" + m_path + "'");
+
+    auto &in = *file.rdbuf();
+    std::vector<Field> fields;
+    size_t field_count = 0;
+    size_t line = 1;
+    if (!read_record(in, fields, field_count, line))
+        return SqlResult::error("'" + m_path + "' has no header naming its columns");
+
+    std::vector<std::pair<std::string, DataType>> columns;
+    for (size_t i = 0; i < field_count; i++)
+    {
+        const auto &name = fields[i].text;
+        auto index = table->column_index(name);
+        if (!index)
+            return SqlResult::error("No column with the name '" + name + "' found");
+        columns.emplace_back(name, table->columns()[*index].data_type());
+    }
+
+    std::vector<Row> batch;
+    batch.reserve(Config::bulk_load_batch_size);
+    auto add_batch = [&]()
+    {
+        table->add_rows(std::move(batch));
+        batch.clear();
+    };
+
+    for (;;)
+    {
+        auto record_line = line;
+        if (!read_record(in, fields, field_count, line))
+            break;
+
+        // Skip blank lines
+        if (field_count == 1 && fields[0].text.empty() && !fields[0].is_quoted)
+            continue;
+
+        auto error = [&](const std::string &message)
+        {
+            return SqlResult::error("Line " + std::to_string(record_line) + ": " + message);
+        };
+
+        if (field_count != columns.size())
+        {
+            return error("Expected " + std::to_string(columns.size()) +
+                " fields, got " + std::to_string(field_count));
+        }
+
+        auto row = table->make_row();
+        for (size_t i = 0; i < columns.size(); i++)
+        {
+            const auto &field = fields[i];
+            const auto &[name, type] = columns[i];
+            if (field.text.empty() && !field.is_quoted)
+                continue;
+
+            auto value = parse_field(field, type);
+            if (!value)
+                return error("'" + field.text + "' is not a valid value for column '" + name + "'");
+            row[name]->set(value->as_entry());
+        }
+
+        batch.push_back(std::move(row));
+        if (batch.size() >= Config::bulk_load_batch_size)
+            add_batch();
+    }
+
+    if (!batch.empty())
+        add_batch();
+    return SqlResult::ok();
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "statement.hpp"
+
+namespace DB::Sql
+{
+
+    // Add rows to a table from a CSV file. The first line names the
+    // columns each field is for, and empty fields are null. Rows are
+    // added `Config::bulk_load_batch_size` at a time, but committed all
+    // together, so outside of a transaction a bad line leaves the table
+    // as it was. Inside one, it's up to the transaction to roll back.
+    class CopyStatement : public Statement
+    {
+        friend Parser;
+
+    public:
+        virtual SqlResult execute(DataBase&) const override;
+
+    private:
+        CopyStatement()
+            : Statement(Type::Copy) {}
+
+        std::string m_table;
+        std::string m_path;
+    };
+
+}
@@ -0,0 +1,25 @@
+#include "createindex.hpp"
+#include "../database.hpp"
+#include "../index.hpp"
+using namespace DB;
+using namespace DB::Sql;
+
+SqlResult CreateIndexStatement::execute(DataBase &db) const
+{
+    auto table = db.get_table(m_table);
+    if (!table)
+        return SqlResult::error("No table with the name '" + m_table + "' found");
+
+    auto column = table->column_index(m_column);
+    if (!column)
+        return SqlResult::error("No column with the name '" + m_column + "' found");
+
+    if (!Index::can_index(table->columns()[*column].data_type()))
+        return SqlResult::error("Can not create an index on column '" + m_column + "'");
+
+    if (table->get_index(m_name))
+        return SqlResult::error("Index with the name '" + m_name + "' already exists");
+
+    table->create_index(m_name, m_column);
+    return SqlResult::ok();
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "statement.hpp"
+
+namespace DB::Sql
+{
+
+    class CreateIndexStatement : public Statement
+    {
+        friend Parser;
+
+    public:
+        virtual SqlResult execute(DataBase&) const override;
+
+    private:
+        CreateIndexStatement()
+            : Statement(Type::CreateIndex) {}
+
+        std::string m_name;
+        std::string m_table;
+        std::string m_column;
+
+    };
+
+}
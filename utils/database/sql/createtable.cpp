@@ -1,6 +1,7 @@
 #include "createtable.hpp"
 #include "../table.hpp"
 #include "../database.hpp"
+#include "../dictionary.hpp"
 #include <algorithm>
 #include <cassert>
 using namespace DB;
@@ -12,6 +13,7 @@ SqlResult CreateTableStatement::execute(DataBase& db) const
         return SqlResult::error("Table with the name '" + m_name + "' already exists");
 
     Table::Constructor tc(m_name);
+    tc.set_columnar(m_is_columnar);
     for (const auto &column : m_columns)
     {
         auto type_name = column.type;
@@ -27,12 +29,18 @@ SqlResult CreateTableStatement::execute(DataBase& db) const
             type = DataType::big_int();
         else if (type_name == "float")
             type = DataType::float_();
+        else if (type_name == "char" && column.has_dictionary)
+            type = DataType::dictionary_char(column.length);
         else if (type_name == "char")
             type = DataType::char_(column.length);
         else if (type_name == "text")
             type = DataType::text();
 
         assert (type);
+        if (column.has_dictionary && type->primitive() != DataType::Char)
+            return SqlResult::error("Only Char columns can have a dictionary, not '" + column.name + "'");
+        if (column.has_dictionary && (size_t)column.length > Dictionary::max_value_length)
+            return SqlResult::error("Char column '" + column.name + "' is too long to have a dictionary");
         tc.add_column(column.name, *type);
     }
 
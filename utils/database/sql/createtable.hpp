@@ -23,10 +23,12 @@ namespace DB::Sql
             std::string name;
             std::string type;
             int length;
+            bool has_dictionary;
         };
 
         std::string m_name;
         std::vector<Column> m_columns;
+        bool m_is_columnar { false };
 
     };
 
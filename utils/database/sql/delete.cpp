@@ -1,5 +1,6 @@
 #include "delete.hpp"
 #include "value.hpp"
+#include "scan.hpp"
 #include "../database.hpp"
 using namespace DB;
 using namespace DB::Sql;
@@ -12,15 +13,20 @@ SqlResult DeleteStatement::execute(DataBase &db) const
     if (!table)
         return SqlResult::error("No table with the name '" + m_table + "' found");
     
-    for (size_t i = 0; i < table->row_count(); i++)
-    {
-        auto row = table->get_row(i);
-        assert (row);
-        
-        auto result = m_where->evaluate(*row);
-        if (result.as_bool())
-            table->remove_row(i);
-    }
-    
+    // NOTE: Removing a row moves the ones after it, so find
+    //       them all first, then remove them together
+    std::vector<size_t> rows_to_remove;
+    Scan scan(*table, m_where);
+    if (!scan.good())
+        return SqlResult::error(scan.error());
+
+    // Only the row numbers are needed
+    scan.project({});
+
+    while (auto match = scan.next())
+        rows_to_remove.push_back(match->index);
+
+    table->remove_rows(rows_to_remove);
+
     return SqlResult::ok();
 }
@@ -6,24 +6,33 @@ using namespace DB::Sql;
 
 SqlResult InsertStatement::execute(DataBase& db) const
 {
-    if (m_columns.size() != m_values.size())
-    {
-        assert (false);
-        return SqlResult::error("Column and value counts do not match");
-    }
-
     auto table = db.get_table(m_table);
     if (!table)
         return SqlResult::error("No table with the name '" + m_table + "' found");
 
-    auto row = table->make_row();
-    for (int i = 0; i < (int)m_columns.size(); i++)
+    // NOTE: All the rows are added together, so the table
+    //       is only written to and updated once
+    std::vector<Row> rows;
+    rows.reserve(m_rows.size());
+    for (const auto &values : m_rows)
     {
-        const auto &column = m_columns[i];
-        const auto &value = m_values[i];
-        row[column]->set(value->evaluate(row).as_entry());
+        if (m_columns.size() != values.size())
+        {
+            assert (false);
+            return SqlResult::error("Column and value counts do not match");
+        }
+
+        auto row = table->make_row();
+        for (int i = 0; i < (int)m_columns.size(); i++)
+        {
+            const auto &column = m_columns[i];
+            const auto &value = values[i];
+            row[column]->set(value->evaluate(row).as_entry());
+        }
+
+        rows.push_back(std::move(row));
     }
 
-    table->add_row(std::move(row));
+    table->add_rows(std::move(rows));
     return SqlResult::ok();
 }
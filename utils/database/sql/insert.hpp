@@ -17,7 +17,9 @@ namespace DB::Sql
 
         std::string m_table;
         std::vector<std::string> m_columns;
-        std::vector<std::unique_ptr<ValueNode>> m_values;
+
+        // Each row's values, in the same order as the columns
+        std::vector<std::vector<ValueNode*>> m_rows;
     };
 
 }
@@ -0,0 +1,569 @@
+#include "kernels.hpp"
+#include <algorithm>
+#include <type_traits>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define HAS_X86_KERNELS
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+using namespace DB::Sql;
+using namespace DB::Sql::Kernels;
+
+enum class InstructionSet
+{
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+static InstructionSet detect_instruction_set()
+{
+#ifdef HAS_X86_KERNELS
+    // NOTE: SSE2 is part of x86-64, so it's always there
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return InstructionSet::AVX2;
+    return InstructionSet::SSE2;
+#else
+    return InstructionSet::Scalar;
+#endif
+}
+
+static const InstructionSet instruction_set_in_use = detect_instruction_set();
+
+const char *Kernels::instruction_set()
+{
+    switch (instruction_set_in_use)
+    {
+        case InstructionSet::AVX2: return "avx2";
+        case InstructionSet::SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+// Each kernel is made of one that does a word of 64 values, which is
+// what differs between instruction sets, and a loop over the words
+
+template <typename T>
+static bool compare_values(T a, Compare compare, T b)
+{
+    switch (compare)
+    {
+        case Compare::Equals: return a == b;
+        case Compare::MoreThan: return a > b;
+        case Compare::LessThan: return a < b;
+    }
+
+    return false;
+}
+
+template <typename T>
+static uint64_t compare_word_scalar(const T *values, Compare compare, T value)
+{
+    uint64_t mask = 0;
+    for (size_t i = 0; i < 64; i++)
+        mask |= (uint64_t)compare_values(values[i], compare, value) << i;
+    return mask;
+}
+
+template <typename Sum, typename T>
+static Sum sum_word_scalar(const T *values)
+{
+    Sum sum = 0;
+    for (size_t i = 0; i < 64; i++)
+        sum += values[i];
+    return sum;
+}
+
+template <typename T>
+static T reduce_word_scalar(const T *values, bool is_max)
+{
+    T best = values[0];
+    for (size_t i = 1; i < 64; i++)
+        best = is_max ? std::max(best, values[i]) : std::min(best, values[i]);
+    return best;
+}
+
+template <typename T, typename CompareWord>
+static void filter_words(const T *values, size_t count, uint64_t *selection, CompareWord compare_word)
+{
+    for (size_t word = 0; word < (count + 63) / 64; word++)
+    {
+        if (selection[word] != 0)
+            selection[word] &= compare_word(values + word * 64);
+    }
+}
+
+template <typename Sum, typename T, typename SumWord>
+static Sum sum_words(const T *values, size_t count, const uint64_t *selection, SumWord sum_word)
+{
+    Sum sum = 0;
+    for (size_t word = 0; word < (count + 63) / 64; word++)
+    {
+        auto bits = selection[word];
+        if (bits == UINT64_MAX)
+        {
+            sum += sum_word(values + word * 64);
+            continue;
+        }
+
+        for (; bits != 0; bits &= bits - 1)
+            sum += values[word * 64 + __builtin_ctzll(bits)];
+    }
+
+    return sum;
+}
+
+template <typename T, typename ReduceWord>
+static std::optional<T> reduce_words(const T *values, size_t count, const uint64_t *selection,
+    bool is_max, ReduceWord reduce_word)
+{
+    std::optional<T> best;
+    auto keep = [&](T value)
+    {
+        if (!best || (is_max ? value > *best : value < *best))
+            best = value;
+    };
+
+    for (size_t word = 0; word < (count + 63) / 64; word++)
+    {
+        auto bits = selection[word];
+        if (bits == UINT64_MAX)
+        {
+            keep(reduce_word(values + word * 64, is_max));
+            continue;
+        }
+
+        for (; bits != 0; bits &= bits - 1)
+            keep(values[word * 64 + __builtin_ctzll(bits)]);
+    }
+
+    return best;
+}
+
+#ifdef HAS_X86_KERNELS
+
+TARGET_AVX2 static uint64_t compare_word_avx2(const int32_t *values, Compare compare, int32_t value)
+{
+    auto constant = _mm256_set1_epi32(value);
+    uint64_t mask = 0;
+    for (size_t i = 0; i < 64; i += 8)
+    {
+        auto v = _mm256_loadu_si256((const __m256i*)(values + i));
+        __m256i result;
+        if (compare == Compare::Equals)
+            result = _mm256_cmpeq_epi32(v, constant);
+        else if (compare == Compare::MoreThan)
+            result = _mm256_cmpgt_epi32(v, constant);
+        else
+            result = _mm256_cmpgt_epi32(constant, v);
+        mask |= (uint64_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(result)) << i;
+    }
+
+    return mask;
+}
+
+TARGET_AVX2 static uint64_t compare_word_avx2(const int64_t *values, Compare compare, int64_t value)
+{
+    auto constant = _mm256_set1_epi64x(value);
+    uint64_t mask = 0;
+    for (size_t i = 0; i < 64; i += 4)
+    {
+        auto v = _mm256_loadu_si256((const __m256i*)(values + i));
+        __m256i result;
+        if (compare == Compare::Equals)
+            result = _mm256_cmpeq_epi64(v, constant);
+        else if (compare == Compare::MoreThan)
+            result = _mm256_cmpgt_epi64(v, constant);
+        else
+            result = _mm256_cmpgt_epi64(constant, v);
+        mask |= (uint64_t)(uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(result)) << i;
+    }
+
+    return mask;
+}
+
+TARGET_AVX2 static uint64_t compare_word_avx2(const float *values, Compare compare, float value)
+{
+    auto constant = _mm256_set1_ps(value);
+    uint64_t mask = 0;
+    for (size_t i = 0; i < 64; i += 8)
+    {
+        auto v = _mm256_loadu_ps(values + i);
+        __m256 result;
+        if (compare == Compare::Equals)
+            result = _mm256_cmp_ps(v, constant, _CMP_EQ_OQ);
+        else if (compare == Compare::MoreThan)
+            result = _mm256_cmp_ps(v, constant, _CMP_GT_OQ);
+        else
+            result = _mm256_cmp_ps(v, constant, _CMP_LT_OQ);
+        mask |= (uint64_t)(uint32_t)_mm256_movemask_ps(result) << i;
+    }
+
+    return mask;
+}
+
+TARGET_AVX2 static int64_t sum_word_avx2(const int32_t *values)
+{
+    auto total = _mm256_setzero_si256();
+    for (size_t i = 0; i < 64; i += 8)
+    {
+        auto v = _mm256_loadu_si256((const __m256i*)(values + i));
+        total = _mm256_add_epi64(total, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        total = _mm256_add_epi64(total, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, total);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+TARGET_AVX2 static int64_t sum_word_avx2(const int64_t *values)
+{
+    auto total = _mm256_setzero_si256();
+    for (size_t i = 0; i < 64; i += 4)
+        total = _mm256_add_epi64(total, _mm256_loadu_si256((const __m256i*)(values + i)));
+
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, total);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+TARGET_AVX2 static double sum_word_avx2(const float *values)
+{
+    auto total = _mm256_setzero_pd();
+    for (size_t i = 0; i < 64; i += 4)
+        total = _mm256_add_pd(total, _mm256_cvtps_pd(_mm_loadu_ps(values + i)));
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, total);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+TARGET_AVX2 static int32_t reduce_word_avx2(const int32_t *values, bool is_max)
+{
+    auto best = _mm256_loadu_si256((const __m256i*)values);
+    for (size_t i = 8; i < 64; i += 8)
+    {
+        auto v = _mm256_loadu_si256((const __m256i*)(values + i));
+        best = is_max ? _mm256_max_epi32(best, v) : _mm256_min_epi32(best, v);
+    }
+
+    int32_t lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, best);
+    return is_max ? *std::max_element(lanes, lanes + 8) : *std::min_element(lanes, lanes + 8);
+}
+
+TARGET_AVX2 static int64_t reduce_word_avx2(const int64_t *values, bool is_max)
+{
+    // NOTE: There's no 64-bit min or max before AVX-512,
+    //       so the greater of each pair is picked by mask
+    auto best = _mm256_loadu_si256((const __m256i*)values);
+    for (size_t i = 4; i < 64; i += 4)
+    {
+        auto v = _mm256_loadu_si256((const __m256i*)(values + i));
+        auto is_greater = _mm256_cmpgt_epi64(v, best);
+        best = is_max
+            ? _mm256_blendv_epi8(best, v, is_greater)
+            : _mm256_blendv_epi8(v, best, is_greater);
+    }
+
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, best);
+    return is_max ? *std::max_element(lanes, lanes + 4) : *std::min_element(lanes, lanes + 4);
+}
+
+TARGET_AVX2 static float reduce_word_avx2(const float *values, bool is_max)
+{
+    auto best = _mm256_loadu_ps(values);
+    for (size_t i = 8; i < 64; i += 8)
+    {
+        auto v = _mm256_loadu_ps(values + i);
+        best = is_max ? _mm256_max_ps(best, v) : _mm256_min_ps(best, v);
+    }
+
+    float lanes[8];
+    _mm256_storeu_ps(lanes, best);
+    return is_max ? *std::max_element(lanes, lanes + 8) : *std::min_element(lanes, lanes + 8);
+}
+
+// SSE2 has no 64-bit compares, so those words are done one value at a time
+
+static uint64_t compare_word_sse2(const int32_t *values, Compare compare, int32_t value)
+{
+    auto constant = _mm_set1_epi32(value);
+    uint64_t mask = 0;
+    for (size_t i = 0; i < 64; i += 4)
+    {
+        auto v = _mm_loadu_si128((const __m128i*)(values + i));
+        __m128i result;
+        if (compare == Compare::Equals)
+            result = _mm_cmpeq_epi32(v, constant);
+        else if (compare == Compare::MoreThan)
+            result = _mm_cmpgt_epi32(v, constant);
+        else
+            result = _mm_cmplt_epi32(v, constant);
+        mask |= (uint64_t)(uint32_t)_mm_movemask_ps(_mm_castsi128_ps(result)) << i;
+    }
+
+    return mask;
+}
+
+static uint64_t compare_word_sse2(const float *values, Compare compare, float value)
+{
+    auto constant = _mm_set1_ps(value);
+    uint64_t mask = 0;
+    for (size_t i = 0; i < 64; i += 4)
+    {
+        auto v = _mm_loadu_ps(values + i);
+        __m128 result;
+        if (compare == Compare::Equals)
+            result = _mm_cmpeq_ps(v, constant);
+        else if (compare == Compare::MoreThan)
+            result = _mm_cmpgt_ps(v, constant);
+        else
+            result = _mm_cmplt_ps(v, constant);
+        mask |= (uint64_t)(uint32_t)_mm_movemask_ps(result) << i;
+    }
+
+    return mask;
+}
+
+static int64_t sum_word_sse2(const int32_t *values)
+{
+    // Values are widened by pairing them with their sign
+    auto zero = _mm_setzero_si128();
+    auto total = _mm_setzero_si128();
+    for (size_t i = 0; i < 64; i += 4)
+    {
+        auto v = _mm_loadu_si128((const __m128i*)(values + i));
+        auto sign = _mm_cmpgt_epi32(zero, v);
+        total = _mm_add_epi64(total, _mm_unpacklo_epi32(v, sign));
+        total = _mm_add_epi64(total, _mm_unpackhi_epi32(v, sign));
+    }
+
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, total);
+    return lanes[0] + lanes[1];
+}
+
+static int64_t sum_word_sse2(const int64_t *values)
+{
+    auto total = _mm_setzero_si128();
+    for (size_t i = 0; i < 64; i += 2)
+        total = _mm_add_epi64(total, _mm_loadu_si128((const __m128i*)(values + i)));
+
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, total);
+    return lanes[0] + lanes[1];
+}
+
+static double sum_word_sse2(const float *values)
+{
+    auto total = _mm_setzero_pd();
+    for (size_t i = 0; i < 64; i += 4)
+    {
+        auto v = _mm_loadu_ps(values + i);
+        total = _mm_add_pd(total, _mm_cvtps_pd(v));
+        total = _mm_add_pd(total, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, total);
+    return lanes[0] + lanes[1];
+}
+
+static int32_t reduce_word_sse2(const int32_t *values, bool is_max)
+{
+    // NOTE: 32-bit min and max came with SSE4.1,
+    //       so the greater of each pair is picked by mask
+    auto best = _mm_loadu_si128((const __m128i*)values);
+    for (size_t i = 4; i < 64; i += 4)
+    {
+        auto v = _mm_loadu_si128((const __m128i*)(values + i));
+        auto is_greater = _mm_cmpgt_epi32(v, best);
+        auto greater = _mm_or_si128(_mm_and_si128(is_greater, v), _mm_andnot_si128(is_greater, best));
+        auto lesser = _mm_or_si128(_mm_and_si128(is_greater, best), _mm_andnot_si128(is_greater, v));
+        best = is_max ? greater : lesser;
+    }
+
+    int32_t lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, best);
+    return is_max ? *std::max_element(lanes, lanes + 4) : *std::min_element(lanes, lanes + 4);
+}
+
+static float reduce_word_sse2(const float *values, bool is_max)
+{
+    auto best = _mm_loadu_ps(values);
+    for (size_t i = 4; i < 64; i += 4)
+    {
+        auto v = _mm_loadu_ps(values + i);
+        best = is_max ? _mm_max_ps(best, v) : _mm_min_ps(best, v);
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, best);
+    return is_max ? *std::max_element(lanes, lanes + 4) : *std::min_element(lanes, lanes + 4);
+}
+
+#endif
+
+void Kernels::filter(const int32_t *values, size_t count, Compare compare, int32_t value, uint64_t *selection)
+{
+    switch (instruction_set_in_use)
+    {
+#ifdef HAS_X86_KERNELS
+        case InstructionSet::AVX2:
+            return filter_words(values, count, selection,
+                [&](const int32_t *word) { return compare_word_avx2(word, compare, value); });
+        case InstructionSet::SSE2:
+            return filter_words(values, count, selection,
+                [&](const int32_t *word) { return compare_word_sse2(word, compare, value); });
+#endif
+        default:
+            return filter_words(values, count, selection,
+                [&](const int32_t *word) { return compare_word_scalar(word, compare, value); });
+    }
+}
+
+void Kernels::filter(const int64_t *values, size_t count, Compare compare, int64_t value, uint64_t *selection)
+{
+    switch (instruction_set_in_use)
+    {
+#ifdef HAS_X86_KERNELS
+        case InstructionSet::AVX2:
+            return filter_words(values, count, selection,
+                [&](const int64_t *word) { return compare_word_avx2(word, compare, value); });
+#endif
+        default:
+            return filter_words(values, count, selection,
+                [&](const int64_t *word) { return compare_word_scalar(word, compare, value); });
+    }
+}
+
+void Kernels::filter(const float *values, size_t count, Compare compare, float value, uint64_t *selection)
+{
+    switch (instruction_set_in_use)
+    {
+#ifdef HAS_X86_KERNELS
+        case InstructionSet::AVX2:
+            return filter_words(values, count, selection,
+                [&](const float *word) { return compare_word_avx2(word, compare, value); });
+        case InstructionSet::SSE2:
+            return filter_words(values, count, selection,
+                [&](const float *word) { return compare_word_sse2(word, compare, value); });
+#endif
+        default:
+            return filter_words(values, count, selection,
+                [&](const float *word) { return compare_word_scalar(word, compare, value); });
+    }
+}
+
+int64_t Kernels::sum(const int32_t *values, size_t count, const uint64_t *selection)
+{
+    switch (instruction_set_in_use)
+    {
+#ifdef HAS_X86_KERNELS
+        case InstructionSet::AVX2:
+            return sum_words<int64_t>(values, count, selection,
+                [](const int32_t *word) { return sum_word_avx2(word); });
+        case InstructionSet::SSE2:
+            return sum_words<int64_t>(values, count, selection,
+                [](const int32_t *word) { return sum_word_sse2(word); });
+#endif
+        default:
+            return sum_words<int64_t>(values, count, selection,
+                [](const int32_t *word) { return sum_word_scalar<int64_t>(word); });
+    }
+}
+
+int64_t Kernels::sum(const int64_t *values, size_t count, const uint64_t *selection)
+{
+    switch (instruction_set_in_use)
+    {
+#ifdef HAS_X86_KERNELS
+        case InstructionSet::AVX2:
+            return sum_words<int64_t>(values, count, selection,
+                [](const int64_t *word) { return sum_word_avx2(word); });
+        case InstructionSet::SSE2:
+            return sum_words<int64_t>(values, count, selection,
+                [](const int64_t *word) { return sum_word_sse2(word); });
+#endif
+        default:
+            return sum_words<int64_t>(values, count, selection,
+                [](const int64_t *word) { return sum_word_scalar<int64_t>(word); });
+    }
+}
+
+double Kernels::sum(const float *values, size_t count, const uint64_t *selection)
+{
+    switch (instruction_set_in_use)
+    {
+#ifdef HAS_X86_KERNELS
+        case InstructionSet::AVX2:
+            return sum_words<double>(values, count, selection,
+                [](const float *word) { return sum_word_avx2(word); });
+        case InstructionSet::SSE2:
+            return sum_words<double>(values, count, selection,
+                [](const float *word) { return sum_word_sse2(word); });
+#endif
+        default:
+            return sum_words<double>(values, count, selection,
+                [](const float *word) { return sum_word_scalar<double>(word); });
+    }
+}
+
+template <typename T>
+static std::optional<T> reduce(const T *values, size_t count, const uint64_t *selection, bool is_max)
+{
+    switch (instruction_set_in_use)
+    {
+#ifdef HAS_X86_KERNELS
+        case InstructionSet::AVX2:
+            return reduce_words(values, count, selection, is_max,
+                [](const T *word, bool is_max) { return reduce_word_avx2(word, is_max); });
+        case InstructionSet::SSE2:
+            if constexpr (!std::is_same_v<T, int64_t>)
+            {
+                return reduce_words(values, count, selection, is_max,
+                    [](const T *word, bool is_max) { return reduce_word_sse2(word, is_max); });
+            }
+            break;
+#endif
+        default:
+            break;
+    }
+
+    return reduce_words(values, count, selection, is_max,
+        [](const T *word, bool is_max) { return reduce_word_scalar(word, is_max); });
+}
+
+std::optional<int32_t> Kernels::min(const int32_t *values, size_t count, const uint64_t *selection)
+{
+    return reduce(values, count, selection, false);
+}
+
+std::optional<int64_t> Kernels::min(const int64_t *values, size_t count, const uint64_t *selection)
+{
+    return reduce(values, count, selection, false);
+}
+
+std::optional<float> Kernels::min(const float *values, size_t count, const uint64_t *selection)
+{
+    return reduce(values, count, selection, false);
+}
+
+std::optional<int32_t> Kernels::max(const int32_t *values, size_t count, const uint64_t *selection)
+{
+    return reduce(values, count, selection, true);
+}
+
+std::optional<int64_t> Kernels::max(const int64_t *values, size_t count, const uint64_t *selection)
+{
+    return reduce(values, count, selection, true);
+}
+
+std::optional<float> Kernels::max(const float *values, size_t count, const uint64_t *selection)
+{
+    return reduce(values, count, selection, true);
+}
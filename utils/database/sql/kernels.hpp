@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace DB::Sql::Kernels
+{
+
+    // Loops over the values of one column of a block, with the rows to
+    // use given as a selection bitmap of 64 rows to a word, where bit r
+    // of word w is row w * 64 + r. Words with every row selected are
+    // done with AVX2 if the CPU has it, else SSE2 on x86-64, and one
+    // value at a time everywhere else.
+    //
+    // NOTE: Values are read 64 at a time, so there has to be room for a
+    //       whole number of words of them, and rows past `count` must
+    //       never be selected
+
+    enum class Compare
+    {
+        Equals,
+        MoreThan,
+        LessThan,
+    };
+
+    // The name of the instruction set the kernels use on this CPU
+    const char *instruction_set();
+
+    // Unselect the rows whose value doesn't compare with `value`
+    void filter(const int32_t *values, size_t count, Compare, int32_t value, uint64_t *selection);
+    void filter(const int64_t *values, size_t count, Compare, int64_t value, uint64_t *selection);
+    void filter(const float *values, size_t count, Compare, float value, uint64_t *selection);
+
+    // Floats are added up as doubles, like when aggregating rows
+    int64_t sum(const int32_t *values, size_t count, const uint64_t *selection);
+    int64_t sum(const int64_t *values, size_t count, const uint64_t *selection);
+    double sum(const float *values, size_t count, const uint64_t *selection);
+
+    // Empty if no rows are selected
+    std::optional<int32_t> min(const int32_t *values, size_t count, const uint64_t *selection);
+    std::optional<int64_t> min(const int64_t *values, size_t count, const uint64_t *selection);
+    std::optional<float> min(const float *values, size_t count, const uint64_t *selection);
+    std::optional<int32_t> max(const int32_t *values, size_t count, const uint64_t *selection);
+    std::optional<int64_t> max(const int64_t *values, size_t count, const uint64_t *selection);
+    std::optional<float> max(const float *values, size_t count, const uint64_t *selection);
+
+}
@@ -1,176 +1,175 @@
 #include "lexer.hpp"
-#include <algorithm>
 #include <cassert>
-#include <iostream>
+#include <cctype>
 using namespace DB::Sql;
 
-std::optional<Lexer::Token> Lexer::next()
+std::optional<Lexer::Token> Lexer::lex()
 {
-    if (m_peek_stack.size() > 0)
-    {
-        auto token = m_peek_stack.front();
-        m_peek_stack.erase(m_peek_stack.begin());
-        return token;
-    }
-
-    std::string buffer;
+    auto size = m_query.size();
     for (;;)
     {
-        if (m_pointer > m_query.size())
-            break;
-
-        if (!m_should_reconsume)
-        {
-            m_curr_char = m_query[m_pointer];
+        while (m_pointer < size && isspace(m_query[m_pointer]))
             m_pointer += 1;
-        }
-        m_should_reconsume = false;
+        if (m_pointer >= size)
+            return std::nullopt;
 
-        auto c = m_curr_char;
-        switch (m_state)
+        auto start = m_pointer;
+        auto c = m_query[m_pointer];
+        auto token = [&](Type type)
         {
-            case State::Normal:
-                if (isspace(c))
-                    break;
-
-                if (isalpha(c))
-                {
-                    m_should_reconsume = true;
-                    m_state = State::Name;
-                    break;
-                }
-
-                if (isdigit(c))
-                {
-                    m_should_reconsume = true;
-                    m_state = State::Integer;
-                    break;
-                }
-
-                if (c == '\'')
-                {
-                    m_state = State::String;
-                    break;
-                }
-
-                switch (c)
-                {
-                    case '*':
-                        return Token { "*", Type::Star };
-                    case ',':
-                        return Token { ",", Type::Comma };
-                    case '(':
-                        return Token { "(", Type::OpenBrace };
-                    case ')':
-                        return Token { ")", Type::CloseBrace };
-                    case '>':
-                        return Token { ">", Type::MoreThan };
-                    case '=':
-                        return Token { "=", Type::Equals };
-                    default:
-                        break;
-                }
-
-                if (!c)
-                    return std::nullopt;
-
-                assert (false);
-                break;
+            return Token { m_query.substr(start, m_pointer - start), type };
+        };
 
-            case State::Name:
-                if (!isalnum(c))
-                {
-                    m_should_reconsume = true;
-                    m_state = State::Normal;
-                    return parse_name(buffer);
-                }
-
-                buffer += c;
-                break;
+        if (isalpha(c))
+        {
+            while (m_pointer < size && isalnum(m_query[m_pointer]))
+                m_pointer += 1;
 
-            case State::Integer:
-                if (c == '.')
-                {
-                    buffer += c;
-                    m_state = State::Float;
-                    break;
-                }
+            auto name = token(Type::Name);
+            name.type = keyword_type(name.data);
+            return name;
+        }
 
-                if (!isdigit(c))
-                {
-                    m_should_reconsume = true;
-                    m_state = State::Normal;
-                    return Token { buffer, Type::Integer };
-                }
+        if (isdigit(c))
+        {
+            while (m_pointer < size && isdigit(m_query[m_pointer]))
+                m_pointer += 1;
+            if (m_pointer >= size || m_query[m_pointer] != '.')
+                return token(Type::Integer);
 
-                buffer += c;
-                break;
+            m_pointer += 1;
+            while (m_pointer < size && isdigit(m_query[m_pointer]))
+                m_pointer += 1;
+            return token(Type::Float);
+        }
 
-            case State::Float:
-                if (!isdigit(c))
-                {
-                    m_should_reconsume = true;
-                    m_state = State::Normal;
-                    return Token { buffer, Type::Float };
-                }
+        if (c == '\'')
+        {
+            // NOTE: A string that's never closed is dropped,
+            //       along with the rest of the query
+            auto end = m_query.find('\'', start + 1);
+            if (end == std::string_view::npos)
+            {
+                m_pointer = size;
+                return std::nullopt;
+            }
+
+            m_pointer = end + 1;
+            return Token { m_query.substr(start + 1, end - start - 1), Type::String };
+        }
 
-                buffer += c;
+        m_pointer += 1;
+        switch (c)
+        {
+            case '*': return token(Type::Star);
+            case ',': return token(Type::Comma);
+            case '(': return token(Type::OpenBrace);
+            case ')': return token(Type::CloseBrace);
+            case '>': return token(Type::MoreThan);
+            case '=': return token(Type::Equals);
+            case '?': return token(Type::Parameter);
+            default:
                 break;
+        }
 
-            case State::String:
-                if (c == '\'')
-                {
-                    m_state = State::Normal;
-                    return Token { buffer, Type::String };
-                }
-
-                buffer += c;
-                break;
+        // NOTE: A null character ends the query
+        if (!c)
+        {
+            m_pointer = size;
+            return std::nullopt;
         }
-    }
 
-    return std::nullopt;
+        assert (false);
+    }
 }
 
-Lexer::Token Lexer::parse_name(const std::string &buffer)
+Lexer::Type Lexer::keyword_type(std::string_view name)
 {
-    auto lower = buffer;
-    std::for_each(lower.begin(), lower.end(), [](char &c)
+    // NOTE: Names are only letters and digits, so setting the
+    //       0x20 bit makes them lower case without a lookup
+    auto is = [&](std::string_view keyword)
     {
-        c = ::tolower(c);
-    });
-
-    if (lower == "select")
-        return { buffer, Type::Select };
-    else if (lower == "from")
-        return { buffer, Type::From };
-    else if (lower == "insert")
-        return { buffer, Type::Insert };
-    else if (lower == "into")
-        return { buffer, Type::Into };
-    else if (lower == "values")
-        return { buffer, Type::Values };
-    else if (lower == "create")
-        return { buffer, Type::Create };
-    else if (lower == "table")
-        return { buffer, Type::Table };
-    else if (lower == "where")
-        return { buffer, Type::Where };
-    else if (lower == "update")
-        return { buffer, Type::Update };
-    else if (lower == "set")
-        return { buffer, Type::Set };
-    else if (lower == "delete")
-        return { buffer, Type::Delete };
-    else if (lower == "if")
-        return { buffer, Type::If };
-    else if (lower == "not")
-        return { buffer, Type::Not };
-    else if (lower == "exists")
-        return { buffer, Type::Exists };
-    else if (lower == "and")
-        return { buffer, Type::And };
-    return { buffer, Type::Name };
+        for (size_t i = 1; i < keyword.size(); i++)
+        {
+            if ((name[i] | 0x20) != keyword[i])
+                return false;
+        }
+        return true;
+    };
+
+    // Only keywords of the same length and first letter are compared
+    switch (name.size())
+    {
+        case 2:
+            switch (name[0] | 0x20)
+            {
+                case 'b': if (is("by")) return Type::By; break;
+                case 'i': if (is("if")) return Type::If; break;
+                case 'o': if (is("on")) return Type::On; break;
+            }
+            break;
+        case 3:
+            switch (name[0] | 0x20)
+            {
+                case 'a':
+                    if (is("and")) return Type::And;
+                    if (is("asc")) return Type::Asc;
+                    break;
+                case 'n': if (is("not")) return Type::Not; break;
+                case 's': if (is("set")) return Type::Set; break;
+            }
+            break;
+        case 4:
+            switch (name[0] | 0x20)
+            {
+                case 'c': if (is("copy")) return Type::Copy; break;
+                case 'd': if (is("desc")) return Type::Desc; break;
+                case 'f': if (is("from")) return Type::From; break;
+                case 'i': if (is("into")) return Type::Into; break;
+            }
+            break;
+        case 5:
+            switch (name[0] | 0x20)
+            {
+                case 'b': if (is("begin")) return Type::Begin; break;
+                case 'g': if (is("group")) return Type::Group; break;
+                case 'i': if (is("index")) return Type::Index; break;
+                case 'l': if (is("limit")) return Type::Limit; break;
+                case 'o': if (is("order")) return Type::Order; break;
+                case 't': if (is("table")) return Type::Table; break;
+                case 'w': if (is("where")) return Type::Where; break;
+            }
+            break;
+        case 6:
+            switch (name[0] | 0x20)
+            {
+                case 'c':
+                    if (is("commit")) return Type::Commit;
+                    if (is("create")) return Type::Create;
+                    break;
+                case 'd': if (is("delete")) return Type::Delete; break;
+                case 'e': if (is("exists")) return Type::Exists; break;
+                case 'i': if (is("insert")) return Type::Insert; break;
+                case 'o': if (is("offset")) return Type::Offset; break;
+                case 's': if (is("select")) return Type::Select; break;
+                case 'u': if (is("update")) return Type::Update; break;
+                case 'v': if (is("values")) return Type::Values; break;
+            }
+            break;
+        case 8:
+            switch (name[0] | 0x20)
+            {
+                case 'c': if (is("columnar")) return Type::Columnar; break;
+                case 'r': if (is("rollback")) return Type::Rollback; break;
+            }
+            break;
+        case 10:
+            if ((name[0] | 0x20) == 'd' && is("dictionary"))
+                return Type::Dictionary;
+            break;
+    }
+
+    return Type::Name;
 }
 
 std::optional<Lexer::Token> Lexer::consume(Type type)
@@ -179,29 +178,28 @@ std::optional<Lexer::Token> Lexer::consume(Type type)
     if (!token)
         return std::nullopt;
 
-    if (type != Type::None && token->type != type)
+    if (type == Type::Name && is_name(token->type))
+        token->type = Type::Name;
+    else if (type != Type::None && token->type != type)
         return std::nullopt;
 
-    return next();
+    m_peek_start = (m_peek_start + 1) % max_peek;
+    m_peek_count -= 1;
+    return token;
 }
 
 std::optional<Lexer::Token> Lexer::peek(size_t count)
 {
-    std::optional<Token> token;
-    for (size_t i = 0; i <= count; i++)
+    assert (count < max_peek);
+    while (m_peek_count <= count)
     {
-        if (i < m_peek_stack.size())
-        {
-            token = m_peek_stack[i];
-            continue;
-        }
-
-        token = next();
+        auto token = lex();
         if (!token)
             return std::nullopt;
 
-        m_peek_stack.push_back(*token);
+        m_peeked[(m_peek_start + m_peek_count) % max_peek] = *token;
+        m_peek_count += 1;
     }
 
-    return token;
+    return m_peeked[(m_peek_start + count) % max_peek];
 }
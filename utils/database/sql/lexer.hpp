@@ -1,12 +1,16 @@
 #pragma once
 #include "../forward.hpp"
-#include <string>
-#include <vector>
+#include <array>
+#include <string_view>
 #include <optional>
 
 namespace DB::Sql
 {
 
+// Splits a query into tokens without copying it. A token's data is a
+// view of the query (strings without their quotes), so the query has
+// to outlive the lexer and anything kept from its tokens has to be
+// copied.
 class Lexer
 {
 public:
@@ -32,6 +36,25 @@ public:
         Not,
         Exists,
 
+        // NOTE: Keywords from here to `Columnar` are not reserved,
+        //       and are taken as a name wherever one is expected,
+        //       so schemas from before they were added still work
+        Begin,
+        Commit,
+        Rollback,
+        Index,
+        On,
+        Group,
+        By,
+        Order,
+        Asc,
+        Desc,
+        Limit,
+        Offset,
+        Copy,
+        Dictionary,
+        Columnar,
+
         Integer,
         Float,
         String,
@@ -42,41 +65,39 @@ public:
 
         Star,
         Comma,
+        Parameter,
     };
 
     struct Token
     {
-        std::string data;
-        Type type;
+        std::string_view data;
+        Type type { None };
     };
 
-    Lexer(const std::string &query)
-        : m_query(query)
-        , m_should_reconsume(false) {}
+    // How many tokens ahead can be peeked at
+    static constexpr size_t max_peek = 4;
+
+    Lexer(std::string_view query)
+        : m_query(query) {}
 
+    // Consuming a `Name` also takes a keyword that isn't reserved,
+    // which is then returned as a name
     std::optional<Token> consume(Type type = None);
     std::optional<Token> peek(size_t count = 0);
 
-private:
-    enum class State
-    {
-        Normal,
-        Name,
-        Integer,
-        Float,
-        String,
-    };
-
-    std::optional<Token> next();
-    Token parse_name(const std::string &buffer);
+    static bool is_name(Type type) { return type == Name || (type >= Begin && type <= Columnar); }
 
-    std::string m_query;
-    State m_state { State::Normal };
-    char m_curr_char { 0 };
+private:
+    std::optional<Token> lex();
+    static Type keyword_type(std::string_view name);
 
-    bool m_should_reconsume { false };
+    std::string_view m_query;
     size_t m_pointer { 0 };
-    std::vector<Token> m_peek_stack;
+
+    // Tokens peeked at and not yet consumed, from `m_peek_start` on
+    std::array<Token, max_peek> m_peeked;
+    size_t m_peek_start { 0 };
+    size_t m_peek_count { 0 };
 
 };
 
@@ -5,18 +5,36 @@
 #include "createtableifnotexists.hpp"
 #include "update.hpp"
 #include "delete.hpp"
+#include "begin.hpp"
+#include "commit.hpp"
+#include "rollback.hpp"
+#include "createindex.hpp"
+#include "copy.hpp"
 #include "../entry.hpp"
+#include <algorithm>
 #include <cassert>
+#include <charconv>
 #include <iostream>
 #include <memory>
 using namespace DB;
 using namespace DB::Sql;
 
 Parser::Parser(const std::string &query)
-    : m_lexer(query)
+    : m_arena(std::make_shared<Arena>())
+    , m_lexer(query)
+    , m_parameters(m_arena->make<std::vector<Value>>())
 {
 }
 
+// The lexer only gives numbers that are digits, with a '.' for floats
+template <typename T>
+static T parse_number(std::string_view data)
+{
+    T value {};
+    std::from_chars(data.data(), data.data() + data.size(), value);
+    return value;
+}
+
 SqlResult Parser::errors_as_result()
 {
     SqlResult result;
@@ -27,9 +45,15 @@ SqlResult Parser::errors_as_result()
 void Parser::expected(const std::string &name)
 {
     auto token = m_lexer.consume();
+    if (!token)
+    {
+        m_errors.push_back("Expected token '" + name + "', got the end of the statement instead");
+        return;
+    }
+
     m_errors.push_back("Expected token '" +
         name + "', got '" +
-        token->data + "' instead");
+        std::string(token->data) + "' instead");
 }
 
 void Parser::match(Lexer::Type type, const std::string &name)
@@ -54,40 +78,46 @@ void Parser::parse_list(std::function<void()> callback)
     match(Lexer::CloseBrace, ")");
 }
 
-std::unique_ptr<ValueNode> Parser::parse_value()
+ValueNode *Parser::parse_value()
 {
     auto peek = m_lexer.peek();
     if (!peek)
         return nullptr;
 
-    std::unique_ptr<ValueNode> value;
-    switch (peek->type)
+    ValueNode *value = nullptr;
+    switch (Lexer::is_name(peek->type) ? Lexer::Name : peek->type)
     {
         case Lexer::Integer:
         {
             m_lexer.consume();
-            auto i = atol(peek->data.c_str());
-            value = std::make_unique<ValueNode>(Value(i));
+            value = m_arena->make<ValueNode>(Value(parse_number<int64_t>(peek->data)));
             break;
         }
         case Lexer::Float:
         {
             m_lexer.consume();
-            float f = atof(peek->data.c_str());
-            value = std::make_unique<ValueNode>(Value(f));
+            auto f = (float)parse_number<double>(peek->data);
+            value = m_arena->make<ValueNode>(Value(f));
             break;
         }
         case Lexer::String:
         {
             m_lexer.consume();
-            value = std::make_unique<ValueNode>(Value(peek->data));
+            value = m_arena->make<ValueNode>(Value(std::string(peek->data)));
             break;
         }
         case Lexer::Name:
         {
             m_lexer.consume();
-            auto operand = std::make_unique<ValueNode>(Value(peek->data));
-            value = std::make_unique<ValueNode>(ValueNode::Type::Column, std::move(operand));
+            auto *operand = m_arena->make<ValueNode>(Value(std::string(peek->data)));
+            value = m_arena->make<ValueNode>(ValueNode::Type::Column, operand);
+            break;
+        }
+        case Lexer::Parameter:
+        {
+            m_lexer.consume();
+            value = m_arena->make<ValueNode>(m_parameters, m_parameters->size());
+            m_parameters->emplace_back();
             break;
         }
         default:
@@ -100,7 +130,7 @@ std::unique_ptr<ValueNode> Parser::parse_value()
     return value;
 }
 
-std::unique_ptr<ValueNode> Parser::parse_comparison()
+ValueNode *Parser::parse_comparison()
 {
     auto left = parse_value();
     auto peek = m_lexer.peek();
@@ -108,7 +138,7 @@ std::unique_ptr<ValueNode> Parser::parse_comparison()
         return left;
 
     ValueNode::Type operation;
-    std::unique_ptr<ValueNode> right;
+    ValueNode *right;
     switch (peek->type)
     {
         case Lexer::MoreThan:
@@ -125,11 +155,10 @@ std::unique_ptr<ValueNode> Parser::parse_comparison()
             return left;
     }
 
-    return std::make_unique<ValueNode>(
-        std::move(left), operation, std::move(right));
+    return m_arena->make<ValueNode>(left, operation, right);
 }
 
-std::unique_ptr<ValueNode> Parser::parse_condition()
+ValueNode *Parser::parse_condition()
 {
     auto left = parse_comparison();
     auto peek = m_lexer.peek();
@@ -137,7 +166,7 @@ std::unique_ptr<ValueNode> Parser::parse_condition()
         return left;
 
     ValueNode::Type operation;
-    std::unique_ptr<ValueNode> right;
+    ValueNode *right;
     switch (peek->type)
     {
         case Lexer::And:
@@ -149,8 +178,7 @@ std::unique_ptr<ValueNode> Parser::parse_condition()
             return left;
     }
 
-    return std::make_unique<ValueNode>(
-        std::move(left), operation, std::move(right));
+    return m_arena->make<ValueNode>(left, operation, right);
 }
 
 std::shared_ptr<Statement> Parser::parse_select()
@@ -166,11 +194,9 @@ std::shared_ptr<Statement> Parser::parse_select()
     {
         for (;;)
         {
-            auto token = m_lexer.consume(Lexer::Name);
-            if (token)
-                select->m_columns.push_back(token->data);
-            else
-                expected("column name");
+            auto column = parse_select_column();
+            if (column)
+                select->m_aggregates.push_back(*column);
             
             if (!m_lexer.consume(Lexer::Comma))
                 break;
@@ -194,13 +220,125 @@ std::shared_ptr<Statement> Parser::parse_select()
             return nullptr;
         }
 
-        select->m_where = std::move(condition);
+        select->m_where = condition;
+    }
+
+    if (m_lexer.consume(Lexer::Group))
+    {
+        match(Lexer::By, "by");
+        for (;;)
+        {
+            auto token = m_lexer.consume(Lexer::Name);
+            if (token)
+                select->m_group_by.emplace_back(token->data);
+            else
+                expected("column name");
+
+            if (!m_lexer.consume(Lexer::Comma))
+                break;
+        }
+    }
+
+    if (m_lexer.consume(Lexer::Order))
+    {
+        match(Lexer::By, "by");
+        for (;;)
+        {
+            auto column = parse_select_column();
+            if (!column)
+                return nullptr;
+
+            OrderBy order { column->name() };
+            if (m_lexer.consume(Lexer::Desc))
+                order.is_descending = true;
+            else
+                m_lexer.consume(Lexer::Asc);
+            select->m_order_by.push_back(order);
+
+            if (!m_lexer.consume(Lexer::Comma))
+                break;
+        }
+    }
+
+    if (m_lexer.consume(Lexer::Limit))
+    {
+        auto limit = m_lexer.consume(Lexer::Integer);
+        if (!limit)
+        {
+            expected("limit");
+            return nullptr;
+        }
+
+        select->m_limit = parse_number<size_t>(limit->data);
+    }
+
+    if (m_lexer.consume(Lexer::Offset))
+    {
+        auto offset = m_lexer.consume(Lexer::Integer);
+        if (!offset)
+        {
+            expected("offset");
+            return nullptr;
+        }
+
+        select->m_offset = parse_number<size_t>(offset->data);
+    }
+
+    // NOTE: Without any functions or groups, only
+    //       the selected columns are needed
+    auto has_function = std::any_of(select->m_aggregates.begin(), select->m_aggregates.end(),
+        [](const auto &column) { return column.function != AggregateColumn::None; });
+    if (select->m_all && !select->m_group_by.empty())
+    {
+        m_errors.push_back("Cannot select '*' when grouping");
+        return nullptr;
+    }
+    else if (!has_function && select->m_group_by.empty())
+    {
+        for (const auto &column : select->m_aggregates)
+            select->m_columns.push_back(column.column);
+        select->m_aggregates.clear();
     }
 
     select->m_table = table->data;
     return select;
 }
 
+std::optional<AggregateColumn> Parser::parse_select_column()
+{
+    auto token = m_lexer.consume(Lexer::Name);
+    if (!token)
+    {
+        expected("column name");
+        return std::nullopt;
+    }
+
+    auto peek = m_lexer.peek();
+    if (!peek || peek->type != Lexer::OpenBrace)
+        return AggregateColumn { AggregateColumn::None, std::string(token->data) };
+
+    auto function = AggregateColumn::function_from_name(std::string(token->data));
+    if (!function)
+    {
+        m_errors.push_back("Unknown function '" + std::string(token->data) + "'");
+        return std::nullopt;
+    }
+
+    AggregateColumn column { *function, "" };
+    match(Lexer::OpenBrace, "(");
+    if (*function != AggregateColumn::Count || !m_lexer.consume(Lexer::Star))
+    {
+        auto argument = m_lexer.consume(Lexer::Name);
+        if (argument)
+            column.column = argument->data;
+        else
+            expected("column name");
+    }
+    match(Lexer::CloseBrace, ")");
+
+    return column;
+}
+
 std::shared_ptr<Statement> Parser::parse_insert()
 {
     match(Lexer::Insert, "instert");
@@ -221,18 +359,34 @@ std::shared_ptr<Statement> Parser::parse_insert()
         if (!column)
             expected("column name");
         else
-            insert->m_columns.push_back(column->data);
+            insert->m_columns.emplace_back(column->data);
     });
 
     match(Lexer::Values, "values");
-    parse_list([&]()
+    do
     {
-        auto value = parse_value();
-        if (!value)
-            expected("value");
-        else
-            insert->m_values.push_back(std::move(value));
-    });
+        std::vector<ValueNode*> values;
+        parse_list([&]()
+        {
+            auto value = parse_value();
+            if (!value)
+                expected("value");
+            else
+                values.push_back(value);
+        });
+
+        if (!good())
+            return nullptr;
+
+        if (values.size() != insert->m_columns.size())
+        {
+            m_errors.push_back("Expected " + std::to_string(insert->m_columns.size()) +
+                " values, got " + std::to_string(values.size()));
+            return nullptr;
+        }
+
+        insert->m_rows.push_back(std::move(values));
+    } while (m_lexer.consume(Lexer::Comma));
 
     return std::move(insert);
 }
@@ -291,17 +445,55 @@ std::shared_ptr<Statement> Parser::parse_create_table()
                 return;
             }
 
-            column_type_length = atoi(length->data.c_str());
+            column_type_length = parse_number<int>(length->data);
             match(Lexer::CloseBrace, ")");
         }
 
+        bool has_dictionary = m_lexer.consume(Lexer::Dictionary).has_value();
         create_table->m_columns.push_back({
-            column_name->data, column_type->data, column_type_length});
+            std::string(column_name->data), std::string(column_type->data), column_type_length, has_dictionary});
     });
 
+    create_table->m_is_columnar = m_lexer.consume(Lexer::Columnar).has_value();
     return std::move(create_table);
 }
 
+std::shared_ptr<Statement> Parser::parse_create_index()
+{
+    match(Lexer::Create, "create");
+    match(Lexer::Index, "index");
+
+    auto create_index = std::shared_ptr<CreateIndexStatement>(new CreateIndexStatement());
+    auto name = m_lexer.consume(Lexer::Name);
+    if (!name)
+    {
+        expected("index name");
+        return nullptr;
+    }
+
+    match(Lexer::On, "on");
+    auto table = m_lexer.consume(Lexer::Name);
+    if (!table)
+    {
+        expected("table name");
+        return nullptr;
+    }
+
+    match(Lexer::OpenBrace, "(");
+    auto column = m_lexer.consume(Lexer::Name);
+    if (!column)
+    {
+        expected("column name");
+        return nullptr;
+    }
+    match(Lexer::CloseBrace, ")");
+
+    create_index->m_name = name->data;
+    create_index->m_table = table->data;
+    create_index->m_column = column->data;
+    return create_index;
+}
+
 std::shared_ptr<Statement> Parser::parse_update()
 {
     match(Lexer::Update, "update");
@@ -333,7 +525,7 @@ std::shared_ptr<Statement> Parser::parse_update()
             return nullptr;
         }
 
-        update->m_columns.push_back({column->data, std::move(value)});
+        update->m_columns.push_back({std::string(column->data), value});
         if (!m_lexer.consume(Lexer::Comma))
             break;
     }
@@ -347,7 +539,7 @@ std::shared_ptr<Statement> Parser::parse_update()
             return nullptr;
         }
 
-        update->m_where = std::move(where);
+        update->m_where = where;
     }
 
     return update;
@@ -374,12 +566,91 @@ std::shared_ptr<Statement> Parser::parse_delete()
         expected("condition");
         return nullptr;
     }
-    delete_->m_where = std::move(where);
+    delete_->m_where = where;
 
     return delete_;
 }
 
+void Parser::parse_optional_transaction_keyword()
+{
+    // NOTE: 'transaction' is not a keyword, as it's
+    //       a perfectly good column name
+    auto peek = m_lexer.peek();
+    if (!peek || peek->type != Lexer::Name)
+        return;
+
+    auto name = std::string(peek->data);
+    std::for_each(name.begin(), name.end(), [](char &c)
+    {
+        c = ::tolower(c);
+    });
+
+    if (name == "transaction")
+        m_lexer.consume();
+}
+
+std::shared_ptr<Statement> Parser::parse_begin()
+{
+    match(Lexer::Begin, "begin");
+    parse_optional_transaction_keyword();
+
+    return std::shared_ptr<BeginStatement>(new BeginStatement());
+}
+
+std::shared_ptr<Statement> Parser::parse_commit()
+{
+    match(Lexer::Commit, "commit");
+    parse_optional_transaction_keyword();
+
+    return std::shared_ptr<CommitStatement>(new CommitStatement());
+}
+
+std::shared_ptr<Statement> Parser::parse_rollback()
+{
+    match(Lexer::Rollback, "rollback");
+    parse_optional_transaction_keyword();
+
+    return std::shared_ptr<RollbackStatement>(new RollbackStatement());
+}
+
+std::shared_ptr<Statement> Parser::parse_copy()
+{
+    match(Lexer::Copy, "copy");
+
+    auto copy = std::shared_ptr<CopyStatement>(new CopyStatement());
+    auto table = m_lexer.consume(Lexer::Name);
+    if (!table)
+    {
+        expected("table name");
+        return nullptr;
+    }
+    copy->m_table = table->data;
+
+    match(Lexer::From, "from");
+    auto path = m_lexer.consume(Lexer::String);
+    if (!path)
+    {
+        expected("file name");
+        return nullptr;
+    }
+    copy->m_path = path->data;
+
+    return copy;
+}
+
 std::shared_ptr<Statement> Parser::run()
+{
+    auto statement = parse_statement();
+    if (statement)
+    {
+        statement->m_arena = m_arena;
+        statement->m_parameters = m_parameters;
+    }
+
+    return statement;
+}
+
+std::shared_ptr<Statement> Parser::parse_statement()
 {
     auto peek = m_lexer.peek();
     if (!peek)
@@ -392,11 +663,21 @@ std::shared_ptr<Statement> Parser::run()
     {
         case Lexer::Select: return parse_select();
         case Lexer::Insert: return parse_insert();
-        case Lexer::Create: return parse_create_table();
+        case Lexer::Create:
+        {
+            auto next = m_lexer.peek(1);
+            if (next && next->type == Lexer::Index)
+                return parse_create_index();
+            return parse_create_table();
+        }
         case Lexer::Update: return parse_update();
         case Lexer::Delete: return parse_delete();
+        case Lexer::Begin: return parse_begin();
+        case Lexer::Commit: return parse_commit();
+        case Lexer::Rollback: return parse_rollback();
+        case Lexer::Copy: return parse_copy();
         default:
-            m_errors.push_back("Unkown statement '" + peek->data + "'");
+            m_errors.push_back("Unkown statement '" + std::string(peek->data) + "'");
             return nullptr;
     }
 }
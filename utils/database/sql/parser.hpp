@@ -2,6 +2,8 @@
 #include "lexer.hpp"
 #include "statement.hpp"
 #include "value.hpp"
+#include "aggregate.hpp"
+#include "arena.hpp"
 #include <functional>
 
 namespace DB::Sql
@@ -19,21 +21,34 @@ namespace DB::Sql
 
     private:
 
+        std::shared_ptr<Statement> parse_statement();
         void expected(const std::string &name);
         void match(Lexer::Type, const std::string &name);
         std::shared_ptr<Statement> parse_select();
+        std::optional<AggregateColumn> parse_select_column();
         std::shared_ptr<Statement> parse_insert();
         std::shared_ptr<Statement> parse_create_table();
+        std::shared_ptr<Statement> parse_create_index();
         std::shared_ptr<Statement> parse_update();
         std::shared_ptr<Statement> parse_delete();
-
-        std::unique_ptr<ValueNode> parse_value();
-        std::unique_ptr<ValueNode> parse_comparison();
-        std::unique_ptr<ValueNode> parse_condition();
+        std::shared_ptr<Statement> parse_begin();
+        std::shared_ptr<Statement> parse_commit();
+        std::shared_ptr<Statement> parse_rollback();
+        std::shared_ptr<Statement> parse_copy();
+
+        ValueNode *parse_value();
+        ValueNode *parse_comparison();
+        ValueNode *parse_condition();
         void parse_list(std::function<void()>);
+        void parse_optional_transaction_keyword();
+
+        // Everything parsed is made in here, and the
+        // statement takes it over once it's done
+        std::shared_ptr<Arena> m_arena;
 
         Lexer m_lexer;
         std::vector<std::string> m_errors;
+        std::vector<Value> *m_parameters;
     };
 
 }
@@ -0,0 +1,104 @@
+#include "preparedstatement.hpp"
+#include "statement.hpp"
+#include "resultcursor.hpp"
+#include "../database.hpp"
+using namespace DB;
+using namespace DB::Sql;
+
+PreparedStatement::PreparedStatement(DataBase &db, std::shared_ptr<Statement> statement)
+    : m_db(db)
+    , m_statement(std::move(statement))
+    , m_values(m_statement->parameter_count())
+{
+}
+
+PreparedStatement::PreparedStatement(DataBase &db, std::vector<std::string> errors)
+    : m_db(db)
+    , m_errors(std::move(errors))
+{
+}
+
+void PreparedStatement::bind_value(size_t index, Value value)
+{
+    if (!m_statement)
+        return;
+
+    if (index >= m_values.size())
+    {
+        m_errors.push_back("No parameter with the index " + std::to_string(index));
+        return;
+    }
+
+    m_values[index] = std::move(value);
+}
+
+void PreparedStatement::bind(size_t index, int i)
+{
+    bind_value(index, Value((int64_t)i));
+}
+
+void PreparedStatement::bind(size_t index, int64_t i)
+{
+    bind_value(index, Value(i));
+}
+
+void PreparedStatement::bind(size_t index, float f)
+{
+    bind_value(index, Value(f));
+}
+
+void PreparedStatement::bind(size_t index, double d)
+{
+    bind_value(index, Value((float)d));
+}
+
+void PreparedStatement::bind(size_t index, const std::string &str)
+{
+    bind_value(index, Value(str));
+}
+
+void PreparedStatement::clear_bindings()
+{
+    for (auto &value : m_values)
+        value = Value();
+}
+
+std::vector<std::string> PreparedStatement::bind_parameters()
+{
+    if (!good())
+        return m_errors;
+
+    for (size_t i = 0; i < m_values.size(); i++)
+    {
+        if (m_values[i].type() == Value::Null)
+            return { "Parameter " + std::to_string(i) + " has not been bound" };
+    }
+
+    // NOTE: Statements without parameters are shared with other
+    //       handles and the cache, so they're left alone
+    if (!m_values.empty())
+        m_statement->parameters() = m_values;
+    return {};
+}
+
+SqlResult PreparedStatement::execute()
+{
+    auto errors = bind_parameters();
+    if (!errors.empty())
+    {
+        SqlResult result;
+        result.m_errors = std::move(errors);
+        return result;
+    }
+
+    return m_db.execute_statement(*m_statement);
+}
+
+ResultCursor PreparedStatement::query()
+{
+    auto errors = bind_parameters();
+    if (!errors.empty())
+        return ResultCursor(std::move(errors));
+
+    return m_db.open_cursor(m_statement);
+}
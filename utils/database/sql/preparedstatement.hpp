@@ -0,0 +1,53 @@
+#pragma once
+#include "../forward.hpp"
+#include "sql.hpp"
+#include "value.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace DB
+{
+
+    // A parsed statement that can be run many times with different
+    // values bound to its '?' parameters. Parameters are numbered from
+    // 0 in the order they appear, and keep their values between runs.
+    // It must not outlive the database it was prepared on. Each handle
+    // has its own parameters, so different ones can be run at the same
+    // time, but one handle should only be used from one thread at a time.
+    class PreparedStatement
+    {
+        friend DataBase;
+
+    public:
+        inline bool good() const { return m_errors.size() == 0; }
+        inline size_t parameter_count() const { return m_values.size(); }
+
+        void bind(size_t index, int);
+        void bind(size_t index, int64_t);
+        void bind(size_t index, float);
+        void bind(size_t index, double);
+        void bind(size_t index, const std::string&);
+        void clear_bindings();
+
+        SqlResult execute();
+
+        // Run with the current values, reading rows through a cursor.
+        // Binding new values does not change a cursor already open.
+        ResultCursor query();
+
+    private:
+        PreparedStatement(DataBase&, std::shared_ptr<Sql::Statement>);
+        PreparedStatement(DataBase&, std::vector<std::string> errors);
+
+        void bind_value(size_t index, Sql::Value);
+        std::vector<std::string> bind_parameters();
+
+        DataBase &m_db;
+        std::shared_ptr<Sql::Statement> m_statement;
+        std::vector<Sql::Value> m_values;
+        std::vector<std::string> m_errors;
+
+    };
+
+}
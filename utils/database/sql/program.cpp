@@ -0,0 +1,415 @@
+#include "program.hpp"
+#include "../table.hpp"
+#include "../chunk.hpp"
+#include "../dictionary.hpp"
+#include <cassert>
+#include <cstring>
+using namespace DB;
+using namespace DB::Sql;
+
+static std::string type_name(Value::Type type)
+{
+    switch (type)
+    {
+        case Value::Null: return "null";
+        case Value::Integer: return "integer";
+        case Value::Float: return "float";
+        case Value::Boolean: return "boolean";
+        case Value::String: return "string";
+        default:
+            assert (false);
+    }
+}
+
+Program::Program(Table &table, const ValueNode &node, std::pmr::memory_resource *memory)
+    : m_table(table)
+    , m_code(memory)
+    , m_strings(memory)
+    , m_text_types(memory)
+    , m_dictionaries(memory)
+    , m_stack(memory)
+    , m_text(memory)
+{
+    auto type = compile(&node);
+    if (good())
+        m_result_type = type;
+}
+
+void Program::emit(Instruction instruction)
+{
+    switch (instruction.op)
+    {
+        case Op::PushInteger:
+        case Op::PushFloat:
+        case Op::PushBoolean:
+        case Op::PushString:
+        case Op::LoadInteger:
+        case Op::LoadBigInt:
+        case Op::LoadFloat:
+        case Op::LoadChar:
+        case Op::LoadDictionary:
+        case Op::LoadCode:
+        case Op::LoadText:
+            m_depth += 1;
+            break;
+
+        case Op::IntegerToFloat:
+            break;
+
+        case Op::EqualsInteger:
+        case Op::EqualsFloat:
+        case Op::EqualsString:
+        case Op::MoreThanInteger:
+        case Op::MoreThanFloat:
+        case Op::MoreThanString:
+        case Op::AndJump:
+            assert (m_depth > 0);
+            m_depth -= 1;
+            break;
+    }
+
+    if (m_depth > m_stack.size())
+        m_stack.resize(m_depth);
+    m_code.push_back(instruction);
+}
+
+Value::Type Program::compile(const ValueNode *node)
+{
+    if (!good())
+        return Value::Null;
+
+    if (!node)
+    {
+        m_error = "Expected a value";
+        return Value::Null;
+    }
+
+    switch (node->type())
+    {
+        case ValueNode::Type::Value:
+        case ValueNode::Type::Parameter:
+        {
+            const auto &value = node->value();
+            Instruction instruction;
+            switch (value.type())
+            {
+                case Value::Integer:
+                    instruction.op = Op::PushInteger;
+                    instruction.immediate.i = value.as_int();
+                    break;
+                case Value::Float:
+                    instruction.op = Op::PushFloat;
+                    instruction.immediate.f = value.as_float();
+                    break;
+                case Value::Boolean:
+                    instruction.op = Op::PushBoolean;
+                    instruction.immediate.b = value.as_bool();
+                    break;
+                case Value::String:
+                    instruction.op = Op::PushString;
+                    instruction.offset = m_strings.size();
+                    m_strings.emplace_back(value.as_string());
+                    break;
+                default:
+                    m_error = "Unsupported value of type " + type_name(value.type());
+                    return Value::Null;
+            }
+
+            emit(instruction);
+            return value.type();
+        }
+
+        case ValueNode::Type::Column:
+        {
+            const auto &name = node->left()->value().as_string();
+            auto column = m_table.column_index(name);
+            if (!column)
+            {
+                m_error = "No column with the name '" + name + "' found";
+                return Value::Null;
+            }
+
+            const auto &table_column = m_table.columns()[*column];
+            const auto &data_type = table_column.data_type();
+            Instruction instruction;
+            instruction.offset = m_table.column_offset(*column);
+            switch (data_type.primitive())
+            {
+                case DataType::Integer:
+                    instruction.op = Op::LoadInteger;
+                    emit(instruction);
+                    return Value::Integer;
+                case DataType::BigInt:
+                    instruction.op = Op::LoadBigInt;
+                    emit(instruction);
+                    return Value::Integer;
+                case DataType::Float:
+                    instruction.op = Op::LoadFloat;
+                    emit(instruction);
+                    return Value::Float;
+                case DataType::Char:
+                    if (table_column.dictionary())
+                    {
+                        instruction.op = Op::LoadDictionary;
+                        instruction.length = m_dictionaries.size();
+                        m_dictionaries.push_back(table_column.dictionary());
+                        emit(instruction);
+                        return Value::String;
+                    }
+
+                    instruction.op = Op::LoadChar;
+                    instruction.length = data_type.length();
+                    emit(instruction);
+                    return Value::String;
+                case DataType::Text:
+                    // Each text load gets its own buffer to read into
+                    instruction.op = Op::LoadText;
+                    instruction.length = m_text.size();
+                    m_text.emplace_back();
+                    m_text_types.push_back(data_type);
+                    emit(instruction);
+                    return Value::String;
+                default:
+                    assert (false);
+            }
+        }
+
+        case ValueNode::Type::MoreThan:
+        case ValueNode::Type::Equals:
+            return compile_comparison(*node);
+
+        case ValueNode::Type::And:
+        {
+            if (compile(node->left()) != Value::Boolean)
+            {
+                if (good())
+                    m_error = "Expected a condition on the left of 'and'";
+                return Value::Null;
+            }
+
+            auto jump = m_code.size();
+            emit({ Op::AndJump });
+
+            if (compile(node->right()) != Value::Boolean)
+            {
+                if (good())
+                    m_error = "Expected a condition on the right of 'and'";
+                return Value::Null;
+            }
+
+            m_code[jump].offset = m_code.size();
+            return Value::Boolean;
+        }
+
+        default:
+            assert (false);
+    }
+}
+
+bool Program::compile_code_equals(const ValueNode &node)
+{
+    const ValueNode *column = node.left();
+    const ValueNode *value = node.right();
+    if (!column || !value)
+        return false;
+    if (column->type() != ValueNode::Type::Column)
+        std::swap(column, value);
+
+    if (column->type() != ValueNode::Type::Column || !value->is_constant())
+        return false;
+    if (value->value().type() != Value::String)
+        return false;
+
+    auto index = m_table.column_index(column->left()->value().as_string());
+    if (!index)
+        return false;
+
+    const auto &table_column = m_table.columns()[*index];
+    auto *dictionary = table_column.dictionary();
+    if (!dictionary)
+        return false;
+
+    // NOTE: A value not in the dictionary can't be equal to
+    //       any row's, so it gets a code no row can have
+    auto code = dictionary->find(value->value().as_string());
+    Instruction load { Op::LoadCode };
+    load.offset = m_table.column_offset(*index);
+    emit(load);
+
+    Instruction push { Op::PushInteger };
+    push.immediate.i = code ? (int64_t)*code : -1;
+    emit(push);
+
+    emit({ Op::EqualsInteger });
+    return true;
+}
+
+Value::Type Program::compile_comparison(const ValueNode &node)
+{
+    if (node.type() == ValueNode::Type::Equals && compile_code_equals(node))
+        return Value::Boolean;
+
+    auto left = compile(node.left());
+    auto right = compile(node.right());
+    if (!good())
+        return Value::Null;
+
+    bool is_equals = (node.type() == ValueNode::Type::Equals);
+    if (left == Value::Integer && right == Value::Integer)
+    {
+        emit({ is_equals ? Op::EqualsInteger : Op::MoreThanInteger });
+        return Value::Boolean;
+    }
+
+    bool is_left_number = (left == Value::Integer || left == Value::Float);
+    bool is_right_number = (right == Value::Integer || right == Value::Float);
+    if (is_left_number && is_right_number)
+    {
+        // Mixed comparisons are done as floats, the offset
+        // is how far from the top the operand is
+        if (left == Value::Integer)
+            emit({ Op::IntegerToFloat, 1 });
+        if (right == Value::Integer)
+            emit({ Op::IntegerToFloat, 0 });
+
+        emit({ is_equals ? Op::EqualsFloat : Op::MoreThanFloat });
+        return Value::Boolean;
+    }
+
+    if (left == Value::String && right == Value::String)
+    {
+        emit({ is_equals ? Op::EqualsString : Op::MoreThanString });
+        return Value::Boolean;
+    }
+
+    m_error = "Cannot compare " + type_name(left) + " with " + type_name(right);
+    return Value::Null;
+}
+
+const Program::Slot &Program::run(const char *row)
+{
+    assert (good());
+
+    auto *stack = m_stack.data();
+    size_t top = 0;
+    for (size_t i = 0; i < m_code.size(); i++)
+    {
+        const auto &instruction = m_code[i];
+        const char *data = row + instruction.offset;
+        switch (instruction.op)
+        {
+            case Op::PushInteger:
+                stack[top++].i = instruction.immediate.i;
+                break;
+            case Op::PushFloat:
+                stack[top++].f = instruction.immediate.f;
+                break;
+            case Op::PushBoolean:
+                stack[top++].b = instruction.immediate.b;
+                break;
+            case Op::PushString:
+                stack[top++].str = m_strings[instruction.offset];
+                break;
+
+            case Op::LoadInteger:
+            {
+                int32_t i;
+                memcpy(&i, data, sizeof(i));
+                stack[top++].i = i;
+                break;
+            }
+            case Op::LoadBigInt:
+                memcpy(&stack[top++].i, data, sizeof(int64_t));
+                break;
+            case Op::LoadFloat:
+                memcpy(&stack[top++].f, data, sizeof(float));
+                break;
+            case Op::LoadChar:
+                stack[top++].str = std::string_view(data, strnlen(data, instruction.length));
+                break;
+            case Op::LoadDictionary:
+            {
+                uint32_t code;
+                memcpy(&code, data, sizeof(code));
+                stack[top++].str = m_dictionaries[instruction.length]->value(code);
+                break;
+            }
+            case Op::LoadCode:
+            {
+                uint32_t code;
+                memcpy(&code, data, sizeof(code));
+                stack[top++].i = code;
+                break;
+            }
+            case Op::LoadText:
+            {
+                auto &text = m_text[instruction.length];
+                m_table.read_text(m_text_types[instruction.length], data, text);
+                stack[top++].str = std::string_view(text.data(), strnlen(text.data(), text.size()));
+                break;
+            }
+
+            case Op::IntegerToFloat:
+            {
+                auto &slot = stack[top - 1 - instruction.offset];
+                slot.f = (float)slot.i;
+                break;
+            }
+
+            case Op::EqualsInteger:
+                top -= 1;
+                stack[top - 1].b = stack[top - 1].i == stack[top].i;
+                break;
+            case Op::EqualsFloat:
+                top -= 1;
+                stack[top - 1].b = stack[top - 1].f == stack[top].f;
+                break;
+            case Op::EqualsString:
+                top -= 1;
+                stack[top - 1].b = stack[top - 1].str == stack[top].str;
+                break;
+            case Op::MoreThanInteger:
+                top -= 1;
+                stack[top - 1].b = stack[top - 1].i > stack[top].i;
+                break;
+            case Op::MoreThanFloat:
+                top -= 1;
+                stack[top - 1].b = stack[top - 1].f > stack[top].f;
+                break;
+            case Op::MoreThanString:
+                top -= 1;
+                stack[top - 1].b = stack[top - 1].str > stack[top].str;
+                break;
+
+            case Op::AndJump:
+                if (!stack[top - 1].b)
+                    i = instruction.offset - 1;
+                else
+                    top -= 1;
+                break;
+        }
+    }
+
+    assert (top == 1);
+    return stack[0];
+}
+
+bool Program::matches(const char *row)
+{
+    assert (m_result_type == Value::Boolean);
+    return run(row).b;
+}
+
+Value Program::evaluate(const char *row)
+{
+    const auto &result = run(row);
+    switch (m_result_type)
+    {
+        case Value::Integer: return Value(result.i);
+        case Value::Float: return Value(result.f);
+        case Value::Boolean: return Value(result.b);
+        case Value::String: return Value(std::string(result.str));
+        default:
+            assert (false);
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "../forward.hpp"
+#include "../entry.hpp"
+#include "value.hpp"
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace DB::Sql
+{
+
+    // A value expression compiled against the row layout of a table.
+    // Column references become loads from fixed offsets in the encoded
+    // row, and every operation is picked for the types of its operands
+    // up front, so running the program does not look anything up or
+    // allocate (apart from reading TEXT data). Char columns with a
+    // dictionary are compared with a string by their codes, so the
+    // string is only looked up once, when compiling.
+    class Program
+    {
+    public:
+        // The compiled code is kept in `memory`, but a copy
+        // of the program always uses the default resource
+        Program(Table&, const ValueNode&, std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+
+        inline bool good() const { return m_error.empty(); }
+        inline const std::string &error() const { return m_error; }
+        inline Value::Type result_type() const { return m_result_type; }
+
+        // `row` is an encoded row of the table the program was compiled for
+        bool matches(const char *row);
+        Value evaluate(const char *row);
+
+    private:
+        enum class Op : uint8_t
+        {
+            PushInteger,
+            PushFloat,
+            PushBoolean,
+            PushString,
+
+            LoadInteger,
+            LoadBigInt,
+            LoadFloat,
+            LoadChar,
+            LoadDictionary,
+            LoadCode,
+            LoadText,
+
+            IntegerToFloat,
+
+            EqualsInteger,
+            EqualsFloat,
+            EqualsString,
+            MoreThanInteger,
+            MoreThanFloat,
+            MoreThanString,
+
+            // Leaves false and jumps if the top is false,
+            // otherwise pops it and carries on
+            AndJump,
+        };
+
+        struct Instruction
+        {
+            Op op;
+            uint32_t offset { 0 };
+            uint32_t length { 0 };
+
+            union
+            {
+                int64_t i;
+                float f;
+                bool b;
+            } immediate { 0 };
+        };
+
+        struct Slot
+        {
+            union
+            {
+                int64_t i;
+                float f;
+                bool b;
+            };
+            std::string_view str;
+        };
+
+        Value::Type compile(const ValueNode*);
+        Value::Type compile_comparison(const ValueNode&);
+        bool compile_code_equals(const ValueNode&);
+        void emit(Instruction);
+        const Slot &run(const char *row);
+
+        Table &m_table;
+        std::pmr::vector<Instruction> m_code;
+        std::pmr::vector<std::pmr::string> m_strings;
+        std::pmr::vector<DataType> m_text_types;
+        std::pmr::vector<const Dictionary*> m_dictionaries;
+        std::pmr::vector<Slot> m_stack;
+
+        // NOTE: Text is read into these strings for every row,
+        //       so only the list of them is kept in `memory`
+        std::pmr::vector<std::string> m_text;
+        size_t m_depth { 0 };
+        Value::Type m_result_type { Value::Null };
+        std::string m_error;
+
+    };
+
+}
@@ -0,0 +1,76 @@
+#include "resultcursor.hpp"
+#include "scan.hpp"
+#include "sort.hpp"
+#include "../database.hpp"
+using namespace DB;
+using namespace DB::Sql;
+
+ResultCursor::ResultCursor(std::vector<std::string> errors)
+    : m_errors(std::move(errors))
+{
+}
+
+ResultCursor::ResultCursor(ResultCursor&&) = default;
+ResultCursor::~ResultCursor() = default;
+
+void ResultCursor::close()
+{
+    m_scan = nullptr;
+    m_sort = nullptr;
+    m_read_lock = nullptr;
+}
+
+std::optional<Row> ResultCursor::read_next()
+{
+    if (m_next_row < m_rows.size())
+        return std::move(m_rows[m_next_row++]);
+
+    if (m_sort)
+    {
+        auto row = m_sort->next();
+        if (!row)
+            close();
+        return row;
+    }
+
+    if (!m_scan)
+    {
+        close();
+        return std::nullopt;
+    }
+
+    auto match = m_scan->next();
+    if (!match)
+    {
+        close();
+        return std::nullopt;
+    }
+
+    // NOTE: This is where rows are handed over,
+    //       so it's the only place they're decoded
+    return match->row.decode();
+}
+
+std::optional<Row> ResultCursor::next()
+{
+    for (; m_offset > 0; m_offset--)
+    {
+        if (!read_next())
+            return std::nullopt;
+    }
+
+    // NOTE: Nothing past the limit is read, so
+    //       the scan can stop as soon as it's hit
+    if (m_limit)
+    {
+        if (*m_limit == 0)
+        {
+            close();
+            return std::nullopt;
+        }
+
+        *m_limit -= 1;
+    }
+
+    return read_next();
+}
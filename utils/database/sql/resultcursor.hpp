@@ -0,0 +1,85 @@
+#pragma once
+#include "../forward.hpp"
+#include "../row.hpp"
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace DB
+{
+
+    // Reads the rows of a query one at a time, as they're found,
+    // instead of collecting them all up front. Nothing can be written
+    // to the database from this process while the cursor is still in
+    // use, so finish with it before writing from the same thread.
+    class ResultCursor
+    {
+        friend DataBase;
+        friend PreparedStatement;
+        friend Sql::SelectStatement;
+
+    public:
+        ResultCursor(ResultCursor&&);
+        ~ResultCursor();
+
+        class iterator
+        {
+            friend ResultCursor;
+
+        public:
+            void operator++ () { m_row = m_cursor->next(); }
+            bool operator== (const iterator &other) const { return !m_row && !other.m_row; }
+            bool operator!= (const iterator &other) const { return !(*this == other); }
+            Row &operator* () { return *m_row; }
+
+        private:
+            iterator(ResultCursor *cursor)
+                : m_cursor(cursor)
+                , m_row(cursor ? cursor->next() : std::nullopt) {}
+
+            ResultCursor *m_cursor;
+            std::optional<Row> m_row;
+        };
+
+        // NOTE: A cursor can only be stepped through once
+        iterator begin() { return iterator(this); }
+        iterator end() { return iterator(nullptr); }
+        std::optional<Row> next();
+
+        bool good() const { return m_errors.size() == 0; }
+        void output_errors(std::ostream &out = std::cerr) const
+        {
+            for (const auto &error : m_errors)
+                out << "SQL Error: " << error << "\n";
+        }
+
+    private:
+        ResultCursor(std::vector<std::string> errors = {});
+
+        // Keeps what the scan reads from the same until it's done
+        std::unique_ptr<ReadLock> m_read_lock;
+
+        // Keeps the statement the scan refers to alive
+        std::shared_ptr<Sql::Statement> m_statement;
+        std::unique_ptr<Sql::Scan> m_scan;
+        std::unique_ptr<Sql::Sort> m_sort;
+
+        // Rows worked out before the cursor was opened, like
+        // the groups of an aggregate, are read from here
+        std::vector<Row> m_rows;
+        size_t m_next_row { 0 };
+
+        // Rows to skip, and how many to read after them
+        size_t m_offset { 0 };
+        std::optional<size_t> m_limit;
+
+        std::optional<Row> read_next();
+        void close();
+
+        std::vector<std::string> m_errors;
+
+    };
+
+}
@@ -0,0 +1,12 @@
+#include "rollback.hpp"
+#include "../database.hpp"
+using namespace DB;
+using namespace DB::Sql;
+
+SqlResult RollbackStatement::execute(DataBase &db) const
+{
+    if (!db.rollback_transaction())
+        return SqlResult::error("Not in a transaction");
+
+    return SqlResult::ok();
+}
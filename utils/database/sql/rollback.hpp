@@ -0,0 +1,20 @@
+#pragma once
+#include "statement.hpp"
+
+namespace DB::Sql
+{
+
+    class RollbackStatement : public Statement
+    {
+        friend Parser;
+
+    public:
+        virtual SqlResult execute(DataBase&) const override;
+
+    private:
+        RollbackStatement()
+            : Statement(Type::Rollback) {}
+
+    };
+
+}
@@ -0,0 +1,398 @@
+#include "scan.hpp"
+#include "value.hpp"
+#include "../index.hpp"
+#include "../dictionary.hpp"
+#include "../table.hpp"
+#include "../database.hpp"
+#include "../config.hpp"
+#include <algorithm>
+#include <cassert>
+using namespace DB;
+using namespace DB::Sql;
+
+Scan::Scan(Table &table, ValueNode *where)
+    : m_table(table)
+    , m_where(where)
+    , m_buffer(table.row_size() * Config::scan_batch_size)
+{
+    if (!m_where)
+        return;
+
+    m_filter.emplace(table, *m_where, m_arena.resource());
+    if (!m_filter->good())
+    {
+        m_error = m_filter->error();
+        return;
+    }
+
+    if (m_filter->result_type() != Value::Boolean)
+    {
+        m_error = "Expected a condition";
+        return;
+    }
+
+    plan(*m_where);
+    if (!m_candidates)
+    {
+        plan_zones();
+        plan_morsels();
+    }
+}
+
+// The key a column's value would have in an index or zone map. Char
+// columns with a dictionary can only be compared for being equal,
+// and a value that's not in the dictionary gets a key no code has.
+static std::optional<uint64_t> key_for_value(const Column &column, const Value &value, bool is_equals)
+{
+    const auto &type = column.data_type();
+    switch (type.primitive())
+    {
+        case DataType::Integer:
+        case DataType::BigInt:
+            if (value.type() == Value::Integer)
+                return Index::key_for_int(value.as_int());
+            break;
+        case DataType::Float:
+            if (value.type() == Value::Integer)
+                return Index::key_for_float(value.as_int());
+            if (value.type() == Value::Float)
+                return Index::key_for_float(value.as_float());
+            break;
+        case DataType::Char:
+        {
+            if (value.type() != Value::String)
+                break;
+            if (!type.has_dictionary())
+                return Index::key_for_string(value.as_string());
+            if (!is_equals)
+                break;
+
+            auto code = column.dictionary()->find(value.as_string());
+            return code ? *code : UINT64_MAX;
+        }
+        default:
+            break;
+    }
+
+    return std::nullopt;
+}
+
+bool Scan::plan(const ValueNode &node)
+{
+    if (node.type() == ValueNode::Type::And)
+        return plan(*node.left()) || plan(*node.right());
+
+    if (node.type() != ValueNode::Type::Equals && node.type() != ValueNode::Type::MoreThan)
+        return false;
+
+    // Find which side is the column
+    const ValueNode *column = node.left();
+    const ValueNode *value = node.right();
+    bool is_column_on_left = true;
+    if (column->type() != ValueNode::Type::Column)
+    {
+        std::swap(column, value);
+        is_column_on_left = false;
+    }
+
+    if (column->type() != ValueNode::Type::Column || !value->is_constant())
+        return false;
+
+    const auto &column_name = column->left()->value().as_string();
+    auto *index = m_table.find_index_for_column(column_name);
+    if (!index)
+        return false;
+
+    bool is_equals = (node.type() == ValueNode::Type::Equals);
+    const auto &table_column = m_table.columns()[*m_table.column_index(column_name)];
+    auto key = key_for_value(table_column, value->value(), is_equals);
+    if (!key)
+        return false;
+
+    // NOTE: Keys may be shared by values that are not equal (like
+    //       strings with the same prefix), so ranges are inclusive
+    //       and every row found still has to be checked.
+    uint64_t low = 0;
+    uint64_t high = UINT64_MAX;
+    if (is_equals)
+        low = high = *key;
+    else if (is_column_on_left)
+        low = *key;
+    else
+        high = *key;
+
+    auto rows = index->find(low, high);
+    std::sort(rows.begin(), rows.end());
+    m_candidates = std::move(rows);
+    return true;
+}
+
+bool Scan::could_match(const Table &table, const ValueNode &node, const ZoneMap::Zone &zone)
+{
+    if (node.type() == ValueNode::Type::And)
+        return could_match(table, *node.left(), zone) && could_match(table, *node.right(), zone);
+
+    if (node.type() != ValueNode::Type::Equals && node.type() != ValueNode::Type::MoreThan)
+        return true;
+
+    const ValueNode *column = node.left();
+    const ValueNode *value = node.right();
+    bool is_column_on_left = true;
+    if (column->type() != ValueNode::Type::Column)
+    {
+        std::swap(column, value);
+        is_column_on_left = false;
+    }
+
+    if (column->type() != ValueNode::Type::Column || !value->is_constant())
+        return true;
+
+    auto index = table.column_index(column->left()->value().as_string());
+    if (!index)
+        return true;
+
+    const auto &table_column = table.columns()[*index];
+    bool is_equals = (node.type() == ValueNode::Type::Equals);
+    auto key = Index::can_index(table_column.data_type())
+        ? key_for_value(table_column, value->value(), is_equals)
+        : std::nullopt;
+    if (!key)
+        return true;
+
+    // NOTE: Keys never go down as values go up, but values with the
+    //       same key may still differ, so equal keys could match
+    const auto &column_zone = zone.columns[*index];
+    if (column_zone.is_empty())
+        return false;
+    if (is_equals)
+        return *key >= column_zone.min && *key <= column_zone.max;
+    if (is_column_on_left)
+        return column_zone.max >= *key;
+    return column_zone.min <= *key;
+}
+
+void Scan::plan_zones()
+{
+    if (!m_table.zone_map())
+        return;
+
+    m_table.for_each_block([&](size_t first, size_t count, const ZoneMap::Zone *zone)
+    {
+        if (!zone || could_match(m_table, *m_where, *zone))
+            return;
+
+        // Join up neighbouring blocks
+        if (!m_skipped.empty() && m_skipped.back().first + m_skipped.back().second == first)
+            m_skipped.back().second += count;
+        else
+            m_skipped.emplace_back(first, count);
+    });
+}
+
+bool Scan::is_skipped(size_t first, size_t count) const
+{
+    auto it = std::upper_bound(m_skipped.begin(), m_skipped.end(), first,
+        [](size_t row, const auto &range) { return row < range.first; });
+    if (it == m_skipped.begin())
+        return false;
+
+    --it;
+    return first + count <= it->first + it->second;
+}
+
+void Scan::plan_morsels()
+{
+    if (m_table.db().thread_count() <= 1 || m_table.row_count() < Config::parallel_scan_min_rows)
+        return;
+
+    // NOTE: Morsels don't cross chunks, so they're about the same
+    //       amount of work and can be read without looking for
+    //       where the next chunk starts
+    m_pool = m_table.db().worker_pool();
+    m_morsels.emplace();
+    for (auto [first, count] : m_table.row_ranges())
+    {
+        for (size_t start = 0; start < count; start += Config::scan_morsel_size)
+        {
+            auto morsel_size = std::min(Config::scan_morsel_size, count - start);
+            if (!is_skipped(first + start, morsel_size))
+                m_morsels->emplace_back(first + start, morsel_size);
+        }
+    }
+}
+
+void Scan::filter_next_wave()
+{
+    auto &pool = *m_pool;
+    auto wave_size = std::min(pool.thread_count(), m_morsels->size() - m_next_morsel);
+    while (m_worker_filters.size() < wave_size)
+        m_worker_filters.push_back(*m_filter);
+
+    auto row_size = m_table.row_size();
+    std::vector<std::vector<size_t>> matches(wave_size);
+    std::vector<std::vector<char>> match_data(wave_size);
+    pool.run(wave_size, [&](size_t worker)
+    {
+        auto [first, count] = (*m_morsels)[m_next_morsel + worker];
+        auto &filter = m_worker_filters[worker];
+        std::vector<char> buffer(row_size * Config::scan_batch_size);
+        for (size_t start = first; start < first + count; start += Config::scan_batch_size)
+        {
+            auto batch_size = std::min(Config::scan_batch_size, first + count - start);
+            m_table.read_rows(start, batch_size, buffer.data());
+            for (size_t i = 0; i < batch_size; i++)
+            {
+                auto *row_data = buffer.data() + i * row_size;
+                if (m_table.is_deleted(start + i) || !filter.matches(row_data))
+                    continue;
+
+                matches[worker].push_back(start + i);
+                match_data[worker].insert(match_data[worker].end(), row_data, row_data + row_size);
+            }
+        }
+    });
+    m_next_morsel += wave_size;
+
+    // Morsels are in row order, so joining them keeps it
+    m_matches.clear();
+    m_match_data.clear();
+    m_position = 0;
+    for (size_t worker = 0; worker < wave_size; worker++)
+    {
+        m_matches.insert(m_matches.end(), matches[worker].begin(), matches[worker].end());
+        m_match_data.insert(m_match_data.end(), match_data[worker].begin(), match_data[worker].end());
+    }
+}
+
+void Scan::project(const std::vector<std::string> &columns)
+{
+    const auto &table_columns = m_table.columns();
+    m_projection = std::vector<bool>(table_columns.size(), false);
+    for (size_t i = 0; i < table_columns.size(); i++)
+    {
+        auto it = std::find(columns.begin(), columns.end(), table_columns[i].name());
+        (*m_projection)[i] = (it != columns.end());
+    }
+}
+
+void Scan::order_by(Index &index)
+{
+    assert (!m_candidates);
+
+    auto column = m_table.column_index(index.column_name());
+    assert (column);
+
+    m_morsels = std::nullopt;
+    m_order_index = &index;
+    m_order_column = &m_table.columns()[*column];
+    m_next_leaf = index.first_leaf();
+    m_candidates.emplace();
+    m_position = 0;
+}
+
+bool Scan::read_next_leaf()
+{
+    if (!m_order_index || m_is_reading_nulls)
+        return false;
+
+    m_position = 0;
+    if (m_next_leaf == UINT32_MAX)
+    {
+        m_candidates = std::move(m_null_rows);
+        m_is_reading_nulls = true;
+        return true;
+    }
+
+    m_next_leaf = m_order_index->read_leaf(m_next_leaf, *m_candidates);
+    return true;
+}
+
+std::optional<Scan::Match> Scan::next()
+{
+    if (!good())
+        return std::nullopt;
+
+    if (m_morsels)
+    {
+        while (m_position >= m_matches.size() && m_next_morsel < m_morsels->size())
+            filter_next_wave();
+
+        if (m_position >= m_matches.size())
+        {
+            // NOTE: Rows added since the scan started are
+            //       checked one batch at a time like before
+            auto [first, count] = m_morsels->empty()
+                ? std::pair<size_t, size_t>(0, 0)
+                : m_morsels->back();
+            m_morsels = std::nullopt;
+            m_position = first + count;
+            m_buffer_end = 0;
+            return next();
+        }
+
+        auto index = m_matches[m_position];
+        m_row_data = m_match_data.data() + m_position * m_table.row_size();
+        m_position += 1;
+        return make_match(index);
+    }
+
+    for (;;)
+    {
+        size_t index;
+        if (m_candidates)
+        {
+            if (m_position >= m_candidates->size())
+            {
+                if (read_next_leaf())
+                    continue;
+                return std::nullopt;
+            }
+            index = (*m_candidates)[m_position++];
+            if (m_table.is_deleted(index))
+                continue;
+
+            m_table.read_row(index, m_buffer.data());
+            m_row_data = m_buffer.data();
+
+            if (m_order_column && !m_is_reading_nulls && m_order_column->is_null(m_row_data))
+            {
+                m_null_rows.push_back(index);
+                continue;
+            }
+        }
+        else
+        {
+            while (m_next_skipped < m_skipped.size() && m_position >= m_skipped[m_next_skipped].first)
+            {
+                auto [first, count] = m_skipped[m_next_skipped++];
+                m_position = std::max(m_position, first + count);
+            }
+
+            if (m_position >= m_table.row_count())
+                return std::nullopt;
+            index = m_position++;
+
+            if (index >= m_buffer_end)
+            {
+                auto count = std::min(Config::scan_batch_size, m_table.row_count() - index);
+                m_table.read_rows(index, count, m_buffer.data());
+                m_buffer_start = index;
+                m_buffer_end = index + count;
+            }
+            m_row_data = m_buffer.data() + (index - m_buffer_start) * m_table.row_size();
+            if (m_table.is_deleted(index))
+                continue;
+        }
+
+        if (m_filter && !m_filter->matches(m_row_data))
+            continue;
+
+        return make_match(index);
+    }
+}
+
+Scan::Match Scan::make_match(size_t index)
+{
+    auto *projection = m_projection ? &*m_projection : nullptr;
+    return Match { index, RowView(m_table, m_row_data, projection) };
+}
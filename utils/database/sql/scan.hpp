@@ -0,0 +1,112 @@
+#pragma once
+#include "../forward.hpp"
+#include "../rowview.hpp"
+#include "../zonemap.hpp"
+#include "arena.hpp"
+#include "program.hpp"
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace DB::Sql
+{
+
+    // Steps through the rows of a table that match a condition. If
+    // part of the condition can be answered by an index, only the
+    // rows it finds are checked, otherwise every row is. The condition
+    // is compiled once and checked against the encoded rows, and
+    // matches are views of them, so nothing is decoded until a `Row`
+    // is wanted.
+    //
+    // Full scans of big tables are split into morsels of rows, which
+    // are filtered on the database's worker threads a wave at a time.
+    // Each wave's matches are kept in row order until they're used.
+    // Blocks of rows whose zones can't match are skipped entirely.
+    class Scan
+    {
+    public:
+        Scan(Table&, ValueNode *where);
+
+        // The view is of the scan's buffer, so it only
+        // lasts until the next row is read
+        struct Match
+        {
+            size_t index;
+            RowView row;
+        };
+
+        inline bool good() const { return m_error.empty(); }
+        inline const std::string &error() const { return m_error; }
+
+        std::optional<Match> next();
+
+        // Only decode these columns of the rows found
+        void project(const std::vector<std::string> &columns);
+
+        // Step through the rows in the order of an index instead, a
+        // leaf at a time, so reading can stop after the first few. Rows
+        // without a value come last. Only for scans not already using
+        // an index.
+        void order_by(Index&);
+        inline bool uses_index() const { return m_candidates.has_value(); }
+
+        // The encoded form of the last match
+        inline const char *row_data() const { return m_row_data; }
+
+        // Whether any row in a zone could match a condition, only the
+        // same comparisons an index can answer are checked
+        static bool could_match(const Table&, const ValueNode&, const ZoneMap::Zone&);
+
+    private:
+        bool plan(const ValueNode&);
+        void plan_zones();
+        void plan_morsels();
+        bool is_skipped(size_t first, size_t count) const;
+        void filter_next_wave();
+        Match make_match(size_t index);
+        bool read_next_leaf();
+
+        Table &m_table;
+        ValueNode *m_where;
+
+        // Memory for the filter, which lasts as long as the scan
+        Arena m_arena;
+        std::optional<Program> m_filter;
+        std::string m_error;
+        std::optional<std::vector<bool>> m_projection;
+
+        // Rows found using an index, in row order
+        std::optional<std::vector<size_t>> m_candidates;
+        size_t m_position { 0 };
+
+        // When ordered by an index, its leaves are read as candidates,
+        // skipping null rows until the end
+        Index *m_order_index { nullptr };
+        const Column *m_order_column { nullptr };
+        uint32_t m_next_leaf { UINT32_MAX };
+        std::vector<size_t> m_null_rows;
+        bool m_is_reading_nulls { false };
+
+        // Blocks of rows the zone map shows can't match, as
+        // their first row and row count, in row order
+        std::vector<std::pair<size_t, size_t>> m_skipped;
+        size_t m_next_skipped { 0 };
+
+        // Rows are read a batch at a time when not using an index
+        std::vector<char> m_buffer;
+        size_t m_buffer_start { 0 };
+        size_t m_buffer_end { 0 };
+        const char *m_row_data { nullptr };
+
+        // Morsels are the first row and row count of some rows in one
+        // chunk. Each worker has its own copy of the filter.
+        std::shared_ptr<WorkerPool> m_pool;
+        std::optional<std::vector<std::pair<size_t, size_t>>> m_morsels;
+        size_t m_next_morsel { 0 };
+        std::vector<Program> m_worker_filters;
+        std::vector<size_t> m_matches;
+        std::vector<char> m_match_data;
+
+    };
+
+}
@@ -1,6 +1,12 @@
 #include "select.hpp"
 #include "value.hpp"
+#include "scan.hpp"
+#include "columnscan.hpp"
+#include "resultcursor.hpp"
 #include "../database.hpp"
+#include "../index.hpp"
+#include "../table.hpp"
+#include <algorithm>
 #include <cassert>
 using namespace DB;
 using namespace DB::Sql;
@@ -9,31 +15,174 @@ SelectStatement::SelectStatement()
     : Statement(Type::Select) {}
 
 SqlResult SelectStatement::execute(DataBase& db) const
+{
+    auto cursor = open(db);
+    if (!cursor.good())
+    {
+        SqlResult result;
+        result.m_errors = cursor.m_errors;
+        return result;
+    }
+
+    SqlResult result;
+    while (auto row = cursor.next())
+        result.m_rows.push_back(std::move(*row));
+
+    return result;
+}
+
+static int compare_entries(const Entry &a, const Entry &b)
+{
+    auto order = [](const auto &a, const auto &b)
+    {
+        return (a > b) - (a < b);
+    };
+
+    // NOTE: Nulls come after every value, like when sorting rows
+    if (a.is_null() || b.is_null())
+        return order(a.is_null(), b.is_null());
+
+    switch (a.data_type().primitive())
+    {
+        case DataType::Integer: return order(a.as_int(), b.as_int());
+        case DataType::BigInt: return order(a.as_long(), b.as_long());
+        case DataType::Float: return order(a.as_float(), b.as_float());
+        default: return a.as_string().compare(b.as_string());
+    }
+}
+
+std::optional<std::string> SelectStatement::sort_groups(std::vector<Row> &rows) const
+{
+    if (m_order_by.empty())
+        return std::nullopt;
+
+    for (const auto &order : m_order_by)
+    {
+        auto it = std::find_if(m_aggregates.begin(), m_aggregates.end(),
+            [&](const auto &column) { return column.name() == order.column; });
+        if (it == m_aggregates.end())
+            return "Cannot order by '" + order.column + "', it has to be selected";
+    }
+
+    std::stable_sort(rows.begin(), rows.end(), [&](const Row &a, const Row &b)
+    {
+        for (const auto &order : m_order_by)
+        {
+            auto result = compare_entries(*a[order.column], *b[order.column]);
+            if (result != 0)
+                return order.is_descending ? result > 0 : result < 0;
+        }
+        return false;
+    });
+
+    return std::nullopt;
+}
+
+Index *SelectStatement::find_order_index(Table &table, const Scan &scan) const
+{
+    // NOTE: Reading rows in index order is only worth it if it can
+    //       stop early, and leaves can only be read forwards
+    if (!m_limit || m_order_by.size() != 1 || m_order_by[0].is_descending || scan.uses_index())
+        return nullptr;
+
+    auto *index = table.find_index_for_column(m_order_by[0].column);
+    if (!index)
+        return nullptr;
+
+    // NOTE: Char columns are only indexed by a prefix,
+    //       so their keys are not always in order
+    switch (index->column_type().primitive())
+    {
+        case DataType::Integer:
+        case DataType::BigInt:
+        case DataType::Float:
+            return index;
+        default:
+            return nullptr;
+    }
+}
+
+ResultCursor SelectStatement::open(DataBase &db) const
 {
     auto table = db.get_table(m_table);
     if (!table)
-        return SqlResult::error("No table with the name '" + m_table + "' found");
+        return ResultCursor({ "No table with the name '" + m_table + "' found" });
 
-    SqlResult result;
-    for (size_t i = 0; i < table->row_count(); i++)
+    auto scan = std::make_unique<Scan>(*table, m_where);
+    if (!scan->good())
+        return ResultCursor({ scan->error() });
+
+    // NOTE: The condition is checked on the encoded row,
+    //       so only the selected columns need decoding
+    if (!m_all)
+        scan->project(m_columns);
+
+    ResultCursor cursor;
+    cursor.m_offset = m_offset;
+    cursor.m_limit = m_limit;
+
+    if (is_aggregate())
     {
-        auto row = table->get_row(i);
-        assert (row);
-        
-        if (m_where)
+        Aggregation aggregation(*table, m_aggregates, m_group_by);
+        if (!aggregation.good())
+            return ResultCursor({ aggregation.error() });
+
+        // NOTE: Columnar tables are aggregated a block at a time, unless an
+        //       index already narrows down the rows, others read the
+        //       encoded rows directly, so none are decoded
+        std::optional<ColumnScan> column_scan;
+        if (table->is_columnar() && aggregation.can_add_blocks() && !scan->uses_index())
+            column_scan.emplace(*table, m_where);
+
+        if (column_scan && column_scan->good())
+        {
+            while (column_scan->next())
+                aggregation.add_block(*column_scan);
+        }
+        else
         {
-            auto where_result = m_where->evaluate(*row);
-            if (!where_result.as_bool())
-                continue;
+            while (scan->next())
+                aggregation.add(scan->row_data());
         }
 
-        if (m_all)
+        auto rows = aggregation.finish();
+        if (auto error = sort_groups(rows))
+            return ResultCursor({ *error });
+
+        cursor.m_rows = std::move(rows);
+        return cursor;
+    }
+
+    if (!m_order_by.empty())
+    {
+        if (auto *index = find_order_index(*table, *scan))
         {
-            result.m_rows.push_back(std::move(*row));
-            continue;
+            scan->order_by(*index);
+        }
+        else
+        {
+            auto limit = m_limit ? std::optional<size_t>(*m_limit + m_offset) : std::nullopt;
+            auto sort = std::make_unique<Sort>(*table, m_order_by, limit);
+            if (!sort->good())
+                return ResultCursor({ sort->error() });
+
+            // NOTE: Rows are sorted encoded, and only
+            //       decoded as they're read back
+            scan->project({});
+            while (auto match = scan->next())
+                sort->add(match->index, scan->row_data());
+
+            sort->finish();
+            if (!sort->good())
+                return ResultCursor({ sort->error() });
+
+            if (!m_all)
+                sort->project(m_columns);
+            cursor.m_sort = std::move(sort);
+            return cursor;
         }
-        result.m_rows.push_back(Row(m_columns, std::move(*row)));
     }
 
-    return result;
+    cursor.m_scan = std::move(scan);
+    return cursor;
 }
@@ -1,5 +1,8 @@
 #pragma once
 #include "statement.hpp"
+#include "aggregate.hpp"
+#include "sort.hpp"
+#include <optional>
 #include <vector>
 #include <string>
 
@@ -13,14 +16,32 @@ namespace DB::Sql
     public:
         virtual SqlResult execute(DataBase&) const override;
 
+        // Start reading the rows lazily, the statement
+        // has to outlive the cursor
+        ResultCursor open(DataBase&) const;
+
     private:
         SelectStatement();
 
+        inline bool is_aggregate() const { return !m_aggregates.empty(); }
+
         std::vector<std::string> m_columns;
         std::string m_table;
-        std::unique_ptr<ValueNode> m_where;
+        ValueNode *m_where { nullptr };
         bool m_all { false };
 
+        // Set instead of `m_columns` when selecting aggregates
+        // or grouping, these are worked out during the scan
+        std::vector<AggregateColumn> m_aggregates;
+        std::vector<std::string> m_group_by;
+
+        std::vector<OrderBy> m_order_by;
+        std::optional<size_t> m_limit;
+        size_t m_offset { 0 };
+
+        Index *find_order_index(Table&, const Scan&) const;
+        std::optional<std::string> sort_groups(std::vector<Row>&) const;
+
     };
 
 }
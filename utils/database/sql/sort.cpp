@@ -0,0 +1,274 @@
+#include "sort.hpp"
+#include "../index.hpp"
+#include "../table.hpp"
+#include "../column.hpp"
+#include "../config.hpp"
+#include "../rowview.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+using namespace DB;
+using namespace DB::Sql;
+
+static bool record_less(const std::string &a, const std::string &b)
+{
+    // NOTE: Compares like memcmp, so the bytes are unsigned
+    return a < b;
+}
+
+Sort::Sort(Table &table, const std::vector<OrderBy> &order_by, std::optional<size_t> limit)
+    : m_table(table)
+    , m_limit(limit)
+{
+    for (const auto &order : order_by)
+    {
+        auto index = table.column_index(order.column);
+        if (!index)
+        {
+            m_error = "No column with the name '" + order.column + "' found";
+            return;
+        }
+
+        m_columns.push_back({ &table.columns()[*index], order.is_descending });
+    }
+
+    m_is_heap = m_limit && *m_limit * table.row_size() <= Config::sort_memory_budget;
+}
+
+Sort::~Sort()
+{
+    for (auto &run : m_runs)
+        std::fclose(run.file);
+}
+
+static void append_big_endian(std::string &key, uint64_t value)
+{
+    for (int shift = 56; shift >= 0; shift -= 8)
+        key += (char)((value >> shift) & 0xFF);
+}
+
+void Sort::make_key(size_t index, const char *row, std::string &key)
+{
+    key.clear();
+    for (const auto &[column, is_descending] : m_columns)
+    {
+        // NOTE: Nulls come after every value
+        auto start = key.size();
+        if (column->is_null(row))
+        {
+            key += '\1';
+        }
+        else
+        {
+            key += '\0';
+
+            auto data = row + column->offset();
+            auto type = column->data_type();
+            switch (type.primitive())
+            {
+                case DataType::Integer:
+                {
+                    int32_t value;
+                    memcpy(&value, data, sizeof(value));
+                    append_big_endian(key, Index::key_for_int(value));
+                    break;
+                }
+                case DataType::BigInt:
+                {
+                    int64_t value;
+                    memcpy(&value, data, sizeof(value));
+                    append_big_endian(key, Index::key_for_int(value));
+                    break;
+                }
+                case DataType::Float:
+                {
+                    float value;
+                    memcpy(&value, data, sizeof(value));
+                    append_big_endian(key, Index::key_for_float(value));
+                    break;
+                }
+                case DataType::Char:
+                    // NOTE: Values end at their first null byte, so
+                    //       shorter ones come before longer ones
+                    key += column->char_value(row);
+                    key += '\0';
+                    break;
+                case DataType::Text:
+                    key += column->decode(m_table, row)->as_string();
+                    key += '\0';
+                    break;
+                default:
+                    assert (false);
+            }
+        }
+
+        if (is_descending)
+        {
+            for (size_t i = start; i < key.size(); i++)
+                key[i] = ~key[i];
+        }
+    }
+
+    // NOTE: Rows that are equal keep the order they were found in
+    append_big_endian(key, index);
+}
+
+void Sort::add(size_t index, const char *row)
+{
+    if (!good())
+        return;
+
+    Record record;
+    make_key(index, row, record.key);
+    if (m_is_heap)
+    {
+        if (*m_limit == 0)
+            return;
+
+        auto less = [](const Record &a, const Record &b) { return record_less(a.key, b.key); };
+        if (m_records.size() >= *m_limit)
+        {
+            // NOTE: Only keep the row if it comes before the last one kept
+            if (!less(record, m_records.front()))
+                return;
+
+            std::pop_heap(m_records.begin(), m_records.end(), less);
+            m_records.pop_back();
+        }
+
+        record.row.assign(row, m_table.row_size());
+        m_records.push_back(std::move(record));
+        std::push_heap(m_records.begin(), m_records.end(), less);
+        return;
+    }
+
+    record.row.assign(row, m_table.row_size());
+    m_memory_used += sizeof(Record) + record.key.size() + record.row.size();
+    m_records.push_back(std::move(record));
+    if (m_memory_used >= Config::sort_memory_budget)
+        spill();
+}
+
+void Sort::spill()
+{
+    auto *file = std::tmpfile();
+    if (!file)
+    {
+        m_error = "Could not make a temporary file to sort rows in";
+        return;
+    }
+
+    std::sort(m_records.begin(), m_records.end(), [](const Record &a, const Record &b)
+    {
+        return record_less(a.key, b.key);
+    });
+
+    for (const auto &record : m_records)
+    {
+        auto key_size = (uint32_t)record.key.size();
+        std::fwrite(&key_size, sizeof(key_size), 1, file);
+        std::fwrite(record.key.data(), 1, record.key.size(), file);
+        std::fwrite(record.row.data(), 1, record.row.size(), file);
+    }
+
+    if (std::ferror(file))
+        m_error = "Could not write rows to a temporary file";
+
+    std::rewind(file);
+    m_runs.push_back({ file, {} });
+    m_records.clear();
+    m_memory_used = 0;
+}
+
+bool Sort::read_record(std::FILE *file, Record &record)
+{
+    uint32_t key_size;
+    if (std::fread(&key_size, sizeof(key_size), 1, file) != 1)
+        return false;
+
+    record.key.resize(key_size);
+    record.row.resize(m_table.row_size());
+    if (std::fread(record.key.data(), 1, key_size, file) != key_size)
+        return false;
+    return std::fread(record.row.data(), 1, record.row.size(), file) == record.row.size();
+}
+
+void Sort::finish()
+{
+    auto less = [](const Record &a, const Record &b) { return record_less(a.key, b.key); };
+    if (m_is_heap)
+    {
+        std::sort_heap(m_records.begin(), m_records.end(), less);
+        return;
+    }
+
+    if (m_runs.empty())
+    {
+        std::sort(m_records.begin(), m_records.end(), less);
+        return;
+    }
+
+    // NOTE: Once there are runs on disk, the rest is
+    //       written out too so they can all be merged
+    if (!m_records.empty())
+        spill();
+
+    for (size_t i = 0; i < m_runs.size(); i++)
+    {
+        if (read_record(m_runs[i].file, m_runs[i].head))
+            m_merge.push_back(i);
+    }
+
+    std::make_heap(m_merge.begin(), m_merge.end(), [this](size_t a, size_t b)
+    {
+        return record_less(m_runs[b].head.key, m_runs[a].head.key);
+    });
+}
+
+void Sort::project(const std::vector<std::string> &columns)
+{
+    const auto &table_columns = m_table.columns();
+    m_projection = std::vector<bool>(table_columns.size(), false);
+    for (size_t i = 0; i < table_columns.size(); i++)
+    {
+        auto it = std::find(columns.begin(), columns.end(), table_columns[i].name());
+        (*m_projection)[i] = (it != columns.end());
+    }
+}
+
+Row Sort::decode(const Record &record)
+{
+    auto *projection = m_projection ? &*m_projection : nullptr;
+    return RowView(m_table, record.row.data(), projection).decode();
+}
+
+std::optional<Row> Sort::next()
+{
+    if (!good())
+        return std::nullopt;
+
+    if (m_runs.empty())
+    {
+        if (m_next_record >= m_records.size())
+            return std::nullopt;
+        return decode(m_records[m_next_record++]);
+    }
+
+    if (m_merge.empty())
+        return std::nullopt;
+
+    auto greater = [this](size_t a, size_t b)
+    {
+        return record_less(m_runs[b].head.key, m_runs[a].head.key);
+    };
+
+    std::pop_heap(m_merge.begin(), m_merge.end(), greater);
+    auto &run = m_runs[m_merge.back()];
+    auto row = decode(run.head);
+    if (read_record(run.file, run.head))
+        std::push_heap(m_merge.begin(), m_merge.end(), greater);
+    else
+        m_merge.pop_back();
+
+    return row;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "../forward.hpp"
+#include "../row.hpp"
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace DB::Sql
+{
+
+    struct OrderBy
+    {
+        std::string column;
+        bool is_descending { false };
+    };
+
+    // Puts the encoded rows of a scan in order. Each row is given a key
+    // that compares byte by byte in the order wanted, so rows are only
+    // decoded as they're read back. If only the first `limit` rows are
+    // needed, and they fit in memory, just those are kept in a heap.
+    // Otherwise rows are sorted in memory until they use up the sort
+    // budget, then written out to a temporary file as a sorted run, and
+    // the runs are merged as they're read.
+    class Sort
+    {
+    public:
+        Sort(Table&, const std::vector<OrderBy>&, std::optional<size_t> limit);
+        ~Sort();
+
+        Sort(const Sort&) = delete;
+        Sort(Sort&) = delete;
+
+        inline bool good() const { return m_error.empty(); }
+        inline const std::string &error() const { return m_error; }
+
+        void add(size_t index, const char *row);
+
+        // Called once every row has been added, before reading them
+        void finish();
+
+        // Only decode these columns of the sorted rows
+        void project(const std::vector<std::string> &columns);
+        std::optional<Row> next();
+
+    private:
+        struct Record
+        {
+            std::string key;
+            std::string row;
+        };
+
+        struct Run
+        {
+            std::FILE *file;
+            Record head;
+        };
+
+        void make_key(size_t index, const char *row, std::string &key);
+        void spill();
+        bool read_record(std::FILE*, Record&);
+        Row decode(const Record&);
+
+        Table &m_table;
+        std::vector<std::pair<const Column*, bool>> m_columns;
+        std::optional<std::vector<bool>> m_projection;
+        std::string m_error;
+
+        // With a small enough limit, `m_records` is a heap with
+        // the last of the rows kept at the top
+        std::optional<size_t> m_limit;
+        bool m_is_heap { false };
+
+        std::vector<Record> m_records;
+        size_t m_memory_used { 0 };
+        size_t m_next_record { 0 };
+
+        // Runs are merged with a heap of their next records
+        std::vector<Run> m_runs;
+        std::vector<size_t> m_merge;
+
+    };
+
+}
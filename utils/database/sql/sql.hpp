@@ -10,6 +10,8 @@ namespace DB
 
     class SqlResult
     {
+        friend DataBase;
+        friend PreparedStatement;
         friend Sql::Parser;
         friend Sql::Statement;
         friend Sql::SelectStatement;
@@ -18,6 +20,11 @@ namespace DB
         friend Sql::CreateTableIfNotExistsStatement;
         friend Sql::UpdateStatement;
         friend Sql::DeleteStatement;
+        friend Sql::BeginStatement;
+        friend Sql::CommitStatement;
+        friend Sql::RollbackStatement;
+        friend Sql::CreateIndexStatement;
+        friend Sql::CopyStatement;
 
     public:
         const auto begin() const { return m_rows.begin(); }
@@ -1,12 +1,17 @@
 #pragma once
 #include "../forward.hpp"
 #include "sql.hpp"
+#include "value.hpp"
+#include <memory>
+#include <vector>
 
 namespace DB::Sql
 {
 
     class Statement
     {
+        friend Parser;
+
     public:
         virtual ~Statement() {}
 
@@ -18,11 +23,20 @@ namespace DB::Sql
             CreateTableIfNotExists,
             Update,
             Delete,
+            Begin,
+            Commit,
+            Rollback,
+            CreateIndex,
+            Copy,
         };
 
         virtual SqlResult execute(DataBase&) const = 0;
         inline Type type() const { return m_type; }
 
+        // Values for each '?' in the statement, in the order they appear
+        inline std::vector<Value> &parameters() { return *m_parameters; }
+        inline size_t parameter_count() const { return m_parameters->size(); }
+
     protected:
         Statement(Type type)
             : m_type(type) {}
@@ -30,6 +44,11 @@ namespace DB::Sql
     private:
         Type m_type;
 
+        // The statement's parse tree is made in its arena,
+        // so it's all freed in one go with the statement
+        std::shared_ptr<Arena> m_arena;
+        std::vector<Value> *m_parameters { nullptr };
+
     };
 
 }
@@ -0,0 +1,44 @@
+#include "statementcache.hpp"
+#include "statement.hpp"
+using namespace DB;
+using namespace DB::Sql;
+
+std::shared_ptr<Statement> StatementCache::find(const std::string &query)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_lookup.find(query);
+    if (it == m_lookup.end())
+    {
+        m_miss_count += 1;
+        return nullptr;
+    }
+
+    m_hit_count += 1;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->statement;
+}
+
+void StatementCache::insert(const std::string &query, std::shared_ptr<Statement> statement)
+{
+    if (m_capacity == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_lookup.find(query);
+    if (it != m_lookup.end())
+    {
+        it->second->statement = std::move(statement);
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return;
+    }
+
+    if (m_entries.size() >= m_capacity)
+    {
+        m_lookup.erase(m_entries.back().query);
+        m_entries.pop_back();
+    }
+
+    m_entries.push_front({ query, std::move(statement) });
+    m_lookup[query] = m_entries.begin();
+}
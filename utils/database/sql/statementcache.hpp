@@ -0,0 +1,46 @@
+#pragma once
+#include "../forward.hpp"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace DB::Sql
+{
+
+    // Keeps the most recently used parsed statements by their SQL text,
+    // so running the same query again skips the lexer and parser. It
+    // can be used from any number of threads.
+    class StatementCache
+    {
+    public:
+        StatementCache(size_t capacity)
+            : m_capacity(capacity) {}
+
+        std::shared_ptr<Statement> find(const std::string &query);
+        void insert(const std::string &query, std::shared_ptr<Statement>);
+
+        inline size_t hit_count() const { return m_hit_count; }
+        inline size_t miss_count() const { return m_miss_count; }
+
+    private:
+        struct Entry
+        {
+            std::string query;
+            std::shared_ptr<Statement> statement;
+        };
+
+        size_t m_capacity;
+        std::mutex m_mutex;
+
+        // Most recently used statements are at the front
+        std::list<Entry> m_entries;
+        std::unordered_map<std::string, std::list<Entry>::iterator> m_lookup;
+
+        size_t m_hit_count { 0 };
+        size_t m_miss_count { 0 };
+
+    };
+
+}
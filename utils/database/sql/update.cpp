@@ -1,5 +1,7 @@
 #include "update.hpp"
 #include "value.hpp"
+#include "scan.hpp"
+#include "program.hpp"
 #include "../database.hpp"
 #include <cassert>
 using namespace DB;
@@ -11,29 +13,29 @@ SqlResult UpdateStatement::execute(DataBase &db) const
     if (!table)
         return SqlResult::error("No table the the name '" + m_table + "' found");
 
-    auto execute_assignments_on_row = [&](size_t index, Row &row)
+    std::vector<Program> values;
+    for (const auto &column : m_columns)
     {
-        for (const auto &column : m_columns)
-            row[column.column]->set(column.value->evaluate(row).as_entry());
+        auto &value = values.emplace_back(*table, *column.value);
+        if (!value.good())
+            return SqlResult::error(value.error());
+    }
 
-        table->update_row(index, std::move(row));
-    };
+    Scan scan(*table, m_where);
+    if (!scan.good())
+        return SqlResult::error(scan.error());
 
-    for (size_t i = 0; i < table->row_count(); i++)
+    auto execute_assignments_on_row = [&](size_t index, const RowView &view)
     {
-        auto row = table->get_row(i);
-        assert (row);
+        auto row = view.decode();
+        for (size_t i = 0; i < m_columns.size(); i++)
+            row[m_columns[i].column]->set(values[i].evaluate(view.data()).as_entry());
 
-        if (!m_where)
-        {
-            execute_assignments_on_row(i, *row);
-            continue;
-        }
+        table->update_row(index, std::move(row));
+    };
 
-        auto result = m_where->evaluate(*row);
-        if (result.as_bool())
-            execute_assignments_on_row(i, *row);
-    }
+    while (auto match = scan.next())
+        execute_assignments_on_row(match->index, match->row);
 
     return SqlResult::ok();
 }
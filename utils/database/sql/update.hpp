@@ -18,12 +18,12 @@ namespace DB::Sql
         struct Assignment
         {
             std::string column;
-            std::unique_ptr<ValueNode> value;
+            ValueNode *value;
         };
         
         std::string m_table;
         std::vector<Assignment> m_columns;
-        std::unique_ptr<ValueNode> m_where;
+        ValueNode *m_where { nullptr };
     };
     
 }
@@ -79,9 +79,10 @@ Value ValueNode::evaluate(const Row &row)
     switch (m_type)
     {
         case Type::Value:
+        case Type::Parameter:
             assert (!m_left);
             assert (!m_right);
-            return m_value;
+            return value();
         
         case Type::Column:
             assert (m_left);
@@ -4,6 +4,7 @@
 #include <memory>
 #include <type_traits>
 #include <string>
+#include <vector>
 
 namespace DB::Sql
 {
@@ -64,6 +65,7 @@ namespace DB::Sql
         {
             Value,
             Column,
+            Parameter,
             MoreThan,
             Equals,
             And,
@@ -72,25 +74,48 @@ namespace DB::Sql
         explicit ValueNode(Value value)
             : m_type(Type::Value)
             , m_value(value) {}
+
+        // A '?' that takes the value bound to `parameters[index]`
+        explicit ValueNode(const std::vector<Value> *parameters, size_t index)
+            : m_type(Type::Parameter)
+            , m_parameters(parameters)
+            , m_parameter_index(index) {}
         
         // Binary operator
-        explicit ValueNode(std::unique_ptr<ValueNode> left, Type operation, std::unique_ptr<ValueNode> right)
+        explicit ValueNode(ValueNode *left, Type operation, ValueNode *right)
             : m_type(operation)
-            , m_left(std::move(left))
-            , m_right(std::move(right)) {}
+            , m_left(left)
+            , m_right(right) {}
 
         // Unary operator
-        explicit ValueNode(Type operation, std::unique_ptr<ValueNode> operand)
+        explicit ValueNode(Type operation, ValueNode *operand)
             : m_type(operation)
-            , m_left(std::move(operand)) {}
+            , m_left(operand) {}
         
         Value evaluate(const Row &row);
+
+        inline Type type() const { return m_type; }
+        inline const Value &value() const
+        {
+            if (m_type == Type::Parameter)
+                return (*m_parameters)[m_parameter_index];
+            return m_value;
+        }
+
+        inline bool is_constant() const { return m_type == Type::Value || m_type == Type::Parameter; }
+        inline const ValueNode *left() const { return m_left; }
+        inline const ValueNode *right() const { return m_right; }
         
     private:
         Type m_type;
         Value m_value;
-        std::unique_ptr<ValueNode> m_left { nullptr };
-        std::unique_ptr<ValueNode> m_right { nullptr };
+        const std::vector<Value> *m_parameters { nullptr };
+        size_t m_parameter_index { 0 };
+
+        // NOTE: Nodes are made in their statement's
+        //       arena, which owns all of them
+        ValueNode *m_left { nullptr };
+        ValueNode *m_right { nullptr };
         
     };
     
@@ -0,0 +1,34 @@
+#pragma once
+#include "forward.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace DB
+{
+
+    class Storage
+    {
+    public:
+        virtual ~Storage() = default;
+
+        // The number of bytes of actual data, not including any
+        // space the backend has reserved for itself
+        virtual size_t size() const = 0;
+
+        virtual void read(size_t offset, void *buffer, size_t len) = 0;
+        virtual void write(size_t offset, const void *buffer, size_t len) = 0;
+        virtual void truncate(size_t size) = 0;
+
+        // Hand any modified data off to the OS
+        virtual void flush() = 0;
+
+        // Wait for everything written so far to reach the disk
+        virtual void sync() = 0;
+
+        // Another process may have written to the file, so forget
+        // anything kept from it and read its size again
+        virtual void reload() = 0;
+
+    };
+
+}
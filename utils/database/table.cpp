@@ -3,26 +3,78 @@
 #include "table.hpp"
 #include "database.hpp"
 #include "dynamicdata.hpp"
+#include "index.hpp"
+#include "textheap.hpp"
+#include "dictionary.hpp"
+#include "zonemap.hpp"
+#include "rowview.hpp"
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 using namespace DB;
 
+// Table headers end in a byte of flags, which older ones don't have
+static constexpr uint8_t compressed_flag = 1 << 0;
+static constexpr uint8_t columnar_flag = 1 << 1;
+
+// Segments start with their row count, padded so what follows is aligned
+static constexpr size_t segment_header_size = sizeof(int64_t);
+
+// Set in a column's primitive byte if it has a dictionary
+static constexpr uint8_t dictionary_flag = 1 << 7;
+
+// Deleted row bitmaps start with room for this many bytes
+static constexpr size_t initial_deleted_rows_capacity = 512;
+
 Table::Table(DataBase& db, Constructor constructor)
     : m_db(db)
 {
     m_id = db.generate_table_id();
     m_name = constructor.m_name;
     m_header = db.new_chunk("TH", m_id, 0xCD);
-    m_row_size = Config::row_header_size;
+    m_is_columnar = constructor.m_is_columnar;
     for (const auto &it : constructor.m_columns)
-    {
         m_columns.push_back(Column(it.first, it.second));
-        m_row_size += it.second.size();
-    }
+    lay_out_columns();
+    lay_out_segment();
 
     // Create table object
     write_header();
     m_name = constructor.m_name;
+    for (auto &column : m_columns)
+    {
+        if (column.m_dictionary)
+            column.m_dictionary->create();
+    }
+
+    m_zone_map = std::shared_ptr<ZoneMap>(new ZoneMap(db, m_id, m_columns));
+    m_zone_map->create();
+}
+
+void Table::reload(Table &&table)
+{
+    assert (&m_db == &table.m_db);
+    m_header = std::move(table.m_header);
+    m_row_data_chunks = std::move(table.m_row_data_chunks);
+    m_dynamic_data_chunks = std::move(table.m_dynamic_data_chunks);
+    m_indexes = std::move(table.m_indexes);
+    m_text_heap = std::move(table.m_text_heap);
+    m_zone_map = std::move(table.m_zone_map);
+    m_deleted_rows_chunk = std::move(table.m_deleted_rows_chunk);
+    m_deleted_rows = std::move(table.m_deleted_rows);
+    m_row_count_offset = table.m_row_count_offset;
+    m_flags_offset = table.m_flags_offset;
+    m_segment_offsets = std::move(table.m_segment_offsets);
+    m_segment_size = table.m_segment_size;
+    m_segment_row_counts = std::move(table.m_segment_row_counts);
+    m_id = table.m_id;
+    m_name = std::move(table.m_name);
+    m_columns = std::move(table.m_columns);
+    m_schema = std::move(table.m_schema);
+    m_row_size = table.m_row_size;
+    m_row_count = table.m_row_count;
+    m_is_compressed = table.m_is_compressed;
+    m_is_columnar = table.m_is_columnar;
 }
 
 Table::Table(DataBase &db, std::shared_ptr<Chunk> header)
@@ -40,10 +92,9 @@ Table::Table(DataBase &db, std::shared_ptr<Chunk> header)
     // Column and row count
     auto column_count = header->read_byte(offset);
     m_row_count_offset = offset + 1;
-    m_row_count = header->read_int(offset + 1);
-    offset += 1 + sizeof(int);
+    m_row_count = read_row_count();
+    offset += 1 + row_count_size();
 
-    m_row_size = Config::row_header_size;
     for (size_t i = 0; i < column_count; i++)
     {
         // Column name
@@ -52,9 +103,11 @@ Table::Table(DataBase &db, std::shared_ptr<Chunk> header)
         offset += 1 + column_name_len;
 
         // Column type
-        auto primitive = static_cast<DataType::Primitive>(header->read_byte(offset));
+        auto primitive_byte = (uint8_t)header->read_byte(offset);
+        auto primitive = static_cast<DataType::Primitive>(primitive_byte & ~dictionary_flag);
         auto length = header->read_byte(offset + 1);
-        auto type = DataType(primitive, DataType::size_from_primitive(primitive), length);
+        auto type = DataType(primitive, DataType::size_from_primitive(primitive), length,
+            primitive_byte & dictionary_flag);
         offset += 1 + 1;
 
 #ifdef DEBUG_TABLE_LOAD
@@ -65,8 +118,17 @@ Table::Table(DataBase &db, std::shared_ptr<Chunk> header)
             "offset = " << m_row_size << " }\n";
 #endif
         m_columns.push_back(Column(column_name, type));
-        m_row_size += type.size();
     }
+    lay_out_columns();
+
+    m_flags_offset = offset;
+    if (offset < header->size_in_bytes())
+    {
+        auto flags = header->read_byte(offset);
+        m_is_compressed = (flags & compressed_flag);
+        m_is_columnar = (flags & columnar_flag);
+    }
+    lay_out_segment();
 
 #ifdef DEBUG_TABLE_LOAD
     std::cout << "Loaded Table { " <<
@@ -76,6 +138,104 @@ Table::Table(DataBase &db, std::shared_ptr<Chunk> header)
 #endif
 }
 
+void Table::lay_out_columns()
+{
+    // NOTE: Each column with a dictionary gets one here, which is
+    //       then either created or loaded from its "DI" chunk
+    for (size_t i = 0; i < m_columns.size(); i++)
+    {
+        if (m_columns[i].data_type().has_dictionary())
+            m_columns[i].m_dictionary = std::shared_ptr<Dictionary>(new Dictionary(m_db, m_id, i));
+    }
+
+    if (!m_db.format().has_aligned_rows())
+    {
+        // A row header, then each column's 'is null'
+        // flag followed by its data
+        m_row_size = Config::row_header_size;
+        for (auto &column : m_columns)
+        {
+            column.m_null_offset = m_row_size;
+            column.m_null_mask = 0xFF;
+            column.m_offset = m_row_size + 1;
+            m_row_size += column.data_type().size();
+        }
+        m_schema = std::make_shared<const std::vector<Column>>(m_columns);
+        return;
+    }
+
+    // Columns are placed biggest alignment first, so they're all
+    // aligned with as little padding as possible. The null bitmap
+    // goes after them, and the row is padded so the next one is
+    // aligned too.
+    std::vector<size_t> order(m_columns.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+    {
+        return m_columns[a].data_type().alignment() > m_columns[b].data_type().alignment();
+    });
+
+    size_t offset = 0;
+    size_t row_alignment = 1;
+    for (auto i : order)
+    {
+        const auto &type = m_columns[i].data_type();
+        auto alignment = type.alignment();
+        offset = (offset + alignment - 1) / alignment * alignment;
+        m_columns[i].m_offset = offset;
+        offset += type.data_size();
+        row_alignment = std::max(row_alignment, alignment);
+    }
+
+    for (size_t i = 0; i < m_columns.size(); i++)
+    {
+        m_columns[i].m_null_offset = offset + i / 8;
+        m_columns[i].m_null_mask = 1 << (i % 8);
+    }
+
+    offset += (m_columns.size() + 7) / 8;
+    m_row_size = (offset + row_alignment - 1) / row_alignment * row_alignment;
+    m_schema = std::make_shared<const std::vector<Column>>(m_columns);
+}
+
+void Table::lay_out_segment()
+{
+    m_segment_offsets.clear();
+    m_segment_size = 0;
+    if (!m_is_columnar)
+        return;
+
+    auto rows = Config::columnar_segment_rows;
+    m_segment_size = segment_header_size;
+    for (const auto &column : m_columns)
+    {
+        m_segment_offsets.push_back(m_segment_size);
+        m_segment_size += rows / 8 + rows * column.data_type().data_size();
+        m_segment_size = (m_segment_size + 7) / 8 * 8;
+    }
+}
+
+size_t Table::row_count_size() const
+{
+    return m_db.format().has_wide_ids() ? sizeof(int64_t) : sizeof(int);
+}
+
+size_t Table::read_row_count()
+{
+    if (m_db.format().has_wide_ids())
+        return m_header->read_long(m_row_count_offset);
+    return m_header->read_int(m_row_count_offset);
+}
+
+void Table::write_row_count()
+{
+    if (m_db.format().has_wide_ids())
+        m_header->write_long(m_row_count_offset, m_row_count);
+    else
+        m_header->write_int(m_row_count_offset, m_row_count);
+}
+
 void Table::write_header()
 {
     size_t curr_offset = 0;
@@ -86,8 +246,8 @@ void Table::write_header()
 
     m_header->write_byte(curr_offset, m_columns.size());
     m_row_count_offset = curr_offset + 1;
-    m_header->write_int(curr_offset + 1, 0);
-    curr_offset += 1 + sizeof(int);
+    write_row_count();
+    curr_offset += 1 + row_count_size();
 
     for (const auto &column : m_columns)
     {
@@ -101,15 +261,78 @@ void Table::write_header()
         m_header->write_string(curr_offset + 1, name);
         curr_offset += 1 + name.size();
 
-        m_header->write_byte(curr_offset, (int)type.primitive());
+        uint8_t primitive = type.primitive();
+        if (type.has_dictionary())
+            primitive |= dictionary_flag;
+        m_header->write_byte(curr_offset, primitive);
         m_header->write_byte(curr_offset + 1, type.length());
         curr_offset += 2;
     }
 
+    m_flags_offset = curr_offset;
+    write_flags();
+
     // TODO: Add this API
     // m_header.flush();
 }
 
+void Table::write_flags()
+{
+    if (m_flags_offset >= m_header->size_in_bytes() && !m_header->is_active())
+    {
+        // NOTE: Headers from before there were flags have no room
+        //       for them, so they're moved to a new chunk at the end
+        std::vector<char> data(m_header->size_in_bytes());
+        m_header->read_bytes(0, data.data(), data.size());
+
+        auto header = m_db.new_chunk("TH", m_id, 0xCD);
+        header->write_bytes(0, data.data(), data.size());
+        m_header->drop();
+        m_header = header;
+    }
+
+    uint8_t flags = 0;
+    if (m_is_compressed)
+        flags |= compressed_flag;
+    if (m_is_columnar)
+        flags |= columnar_flag;
+    m_header->write_byte(m_flags_offset, flags);
+}
+
+void Table::set_compressed(bool is_compressed)
+{
+    m_is_compressed = is_compressed;
+    if (m_text_heap)
+        m_text_heap->m_is_compressed = is_compressed;
+    write_flags();
+
+    if (is_compressed)
+    {
+        compress();
+        return;
+    }
+
+    for (auto &chunk : m_row_data_chunks)
+    {
+        if (chunk->is_compressed())
+            m_db.expand_chunk(*chunk);
+    }
+    if (m_text_heap)
+        m_text_heap->expand();
+}
+
+void Table::compress()
+{
+    for (auto &chunk : m_row_data_chunks)
+    {
+        if (chunk->size_in_bytes() >= Config::compression_min_chunk_size)
+            chunk = m_db.compress_chunk(chunk);
+    }
+
+    if (m_text_heap)
+        m_text_heap->compress();
+}
+
 std::unique_ptr<DynamicData> Table::new_dynamic_data()
 {
     size_t max_id = 0;
@@ -132,32 +355,109 @@ void Table::add_row(Row row)
         return;
     }
 
-    // Find or create the active chunk
-    std::shared_ptr<Chunk> active_chunk;
-    auto new_chunk = [&]() {
-        auto chunk = m_db.new_chunk("RD", m_id, find_next_row_chunk_index());
+    // NOTE: Encoding may create dynamic data chunks, so has to be
+    //       done before we find the active chunk to append to
+    std::vector<char> buffer(m_row_size);
+    row.encode(*this, buffer.data());
+    append_rows(buffer.data(), 1);
+}
+
+void Table::add_rows(std::vector<Row> rows)
+{
+    if (rows.empty())
+        return;
+
+    std::vector<char> buffer(rows.size() * m_row_size);
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        auto &row = rows[i];
+        if (row.m_entities.size() != m_columns.size())
+        {
+            // TODO: Error
+            assert (false);
+            return;
+        }
+
+        row.encode(*this, buffer.data() + i * m_row_size);
+    }
+
+    append_rows(buffer.data(), rows.size());
+}
+
+void Table::append_rows(const char *data, size_t count)
+{
+    auto &zone_map = writable_zone_map();
+    auto new_chunk = [&]()
+    {
+        if (!m_is_columnar)
+        {
+            auto chunk = m_db.new_chunk("RD", m_id, find_next_row_chunk_index());
+            m_row_data_chunks.push_back(chunk);
+            return chunk;
+        }
+
+        // NOTE: Segments are made full size, so they can
+        //       be written to without being the active chunk
+        auto chunk = m_db.new_chunk("CS", m_id, find_next_row_chunk_index());
+        chunk->write_byte(m_segment_size - 1, 0);
+        chunk->write_long(0, 0);
         m_row_data_chunks.push_back(chunk);
+        m_segment_row_counts.push_back(0);
         return chunk;
     };
 
-    if (m_row_data_chunks.size() <= 0)
-    {
-        active_chunk = new_chunk();
-    }
-    else
+    while (count > 0)
     {
-        active_chunk = m_row_data_chunks.back();
-        if (!active_chunk->is_active())
+        // Find or create a chunk with room for the rows
+        std::shared_ptr<Chunk> active_chunk;
+        if (m_row_data_chunks.size() <= 0)
+        {
             active_chunk = new_chunk();
-    }
+        }
+        else if (m_is_columnar)
+        {
+            active_chunk = m_row_data_chunks.back();
+            if (m_segment_row_counts.back() >= Config::columnar_segment_rows)
+                active_chunk = new_chunk();
+        }
+        else
+        {
+            active_chunk = m_row_data_chunks.back();
+            if (!active_chunk->is_active())
+            {
+                // Nothing more will be added to the last chunk
+                auto &last_chunk = m_row_data_chunks.back();
+                if (m_is_compressed && last_chunk->size_in_bytes() >= Config::compression_min_chunk_size)
+                    last_chunk = m_db.compress_chunk(last_chunk);
+                active_chunk = new_chunk();
+            }
+        }
 
-    // Write the row to disk
-    auto offset = active_chunk->size_in_bytes();
-    row.write(*active_chunk, offset);
+        // Write the rows to disk
+        auto position = m_row_data_chunks.size() - 1;
+        auto first_row = rows_in_chunk(position);
+        auto rows_to_write = count;
+        if (m_is_columnar)
+            rows_to_write = std::min(count, Config::columnar_segment_rows - first_row);
+        write_chunk_rows(*active_chunk, first_row, rows_to_write, data);
+        if (m_is_columnar)
+            set_rows_in_chunk(position, first_row + rows_to_write);
 
-    // Update row count
-    m_row_count += 1;
-    m_header->write_int(m_row_count_offset, m_row_count);
+        for (size_t i = 0; i < rows_to_write; i++)
+        {
+            const char *row = data + i * m_row_size;
+            for (auto &tree : m_indexes)
+                tree->insert(tree->key_for_row(row), m_row_count + i);
+            zone_map.add(active_chunk->index(), (first_row + i) / Config::zone_map_rows, row);
+        }
+
+        // Update row count
+        m_row_count += rows_to_write;
+        write_row_count();
+
+        data += rows_to_write * m_row_size;
+        count -= rows_to_write;
+    }
 }
 
 void Table::update_row(size_t index, Row row)
@@ -165,31 +465,231 @@ void Table::update_row(size_t index, Row row)
     auto [chunk, offset] = find_chunk_and_offset_for_row(index);
     assert (chunk);
 
-    row.write(*chunk, offset);
+    std::vector<char> buffer(m_row_size);
+    row.encode(*this, buffer.data());
+
+    std::vector<char> old_buffer(m_row_size);
+    auto row_in_chunk = offset / m_row_size;
+    read_chunk_rows(*chunk, row_in_chunk, 1, old_buffer.data());
+    for (auto &tree : m_indexes)
+    {
+        auto old_key = tree->key_for_row(old_buffer.data());
+        auto new_key = tree->key_for_row(buffer.data());
+        if (old_key == new_key)
+            continue;
+
+        tree->remove(old_key, index);
+        tree->insert(new_key, index);
+    }
+
+    writable_zone_map().update(chunk->index(), row_in_chunk / Config::zone_map_rows,
+        old_buffer.data(), buffer.data());
+    write_chunk_rows(*chunk, row_in_chunk, 1, buffer.data());
 }
 
 void Table::remove_row(size_t index)
 {
-    auto [chunk, offset] = find_chunk_and_offset_for_row(index);
+    remove_rows({ index });
+}
+
+void Table::remove_rows(const std::vector<size_t> &rows)
+{
+    std::vector<size_t> removed;
+    removed.reserve(rows.size());
+    for (auto row : rows)
+    {
+        if (!is_deleted(row))
+            removed.push_back(row);
+    }
+    if (removed.empty())
+        return;
+
+    if (!m_indexes.empty())
+    {
+        std::vector<char> buffer(m_row_size);
+        for (auto row : removed)
+        {
+            read_row(row, buffer.data());
+            for (auto &tree : m_indexes)
+                tree->remove(tree->key_for_row(buffer.data()), row);
+        }
+    }
+
+    // Free the TEXT values of the removed rows
+    std::vector<size_t> text_offsets;
+    for (size_t i = 0; i < m_columns.size() && m_text_heap; i++)
+    {
+        const auto &type = m_columns[i].data_type();
+        if (type.primitive() == DataType::Text && type.length() != 1)
+            text_offsets.push_back(column_offset(i));
+    }
+
+    if (!text_offsets.empty())
+    {
+        std::vector<char> buffer(m_row_size);
+        for (auto row : removed)
+        {
+            read_row(row, buffer.data());
+            for (auto offset : text_offsets)
+            {
+                uint32_t id;
+                memcpy(&id, buffer.data() + offset, sizeof(id));
+                if (id != TextHeap::null_id)
+                    m_text_heap->remove(id);
+            }
+        }
+    }
+
+    // NOTE: The rows are only marked as deleted, moving the ones after
+    //       them would mean renumbering every index entry past them
+    mark_deleted(removed);
+}
+
+bool Table::is_deleted(size_t row) const
+{
+    auto word = row / 64;
+    if (word >= m_deleted_rows.size())
+        return false;
+    return m_deleted_rows[word] & (uint64_t(1) << (row % 64));
+}
+
+void Table::unselect_deleted(size_t first, size_t count, uint64_t *selection) const
+{
+    if (first / 64 >= m_deleted_rows.size())
+        return;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (is_deleted(first + i))
+            selection[i / 64] &= ~(uint64_t(1) << (i % 64));
+    }
+}
+
+void Table::set_deleted_rows(std::shared_ptr<Chunk> data)
+{
+    m_deleted_rows_chunk = std::move(data);
+    m_deleted_rows.assign(m_deleted_rows_chunk->size_in_bytes() / sizeof(uint64_t), 0);
+    m_deleted_rows_chunk->read_bytes(0, (char*)m_deleted_rows.data(),
+        m_deleted_rows.size() * sizeof(uint64_t));
+}
 
-    // Copy data up a row
-    for (size_t i = offset; i < chunk->size_in_bytes() - m_row_size; i++)
+void Table::mark_deleted(const std::vector<size_t> &rows)
+{
+    auto word_count = rows.back() / 64 + 1;
+    auto size = word_count * sizeof(uint64_t);
+    if (!m_deleted_rows_chunk)
+    {
+        m_deleted_rows_chunk = m_db.new_chunk("DL", m_id, 0);
+        m_deleted_rows_chunk->write_byte(std::max(size, initial_deleted_rows_capacity) - 1, 0);
+    }
+    else if (size > m_deleted_rows_chunk->size_in_bytes() && !m_deleted_rows_chunk->is_active())
     {
-        auto byte = chunk->read_byte(i + m_row_size);
-        chunk->write_byte(i, byte);
+        // NOTE: Only the active chunk can grow, so the bitmap is
+        //       moved to a new one with room to spare
+        auto new_chunk = m_db.new_chunk("DL", m_id, 0);
+        new_chunk->write_bytes(0, (const char*)m_deleted_rows.data(), m_deleted_rows.size() * sizeof(uint64_t));
+        new_chunk->write_byte(std::max(size, m_deleted_rows_chunk->size_in_bytes() * 2) - 1, 0);
+        m_deleted_rows_chunk->drop();
+        m_deleted_rows_chunk = new_chunk;
     }
 
-    // Shrink chunk by one row
-    chunk->shrink_to(chunk->size_in_bytes() - m_row_size);
+    if (m_deleted_rows.size() < word_count)
+        m_deleted_rows.resize(word_count, 0);
+
+    // Only the words that changed are written back
+    for (size_t i = 0; i < rows.size();)
+    {
+        auto word = rows[i] / 64;
+        for (; i < rows.size() && rows[i] / 64 == word; i++)
+            m_deleted_rows[word] |= uint64_t(1) << (rows[i] % 64);
+        m_deleted_rows_chunk->write_long(word * sizeof(uint64_t), m_deleted_rows[word]);
+    }
+}
+
+void Table::purge_deleted_rows()
+{
+    if (!m_deleted_rows_chunk)
+        return;
+
+    std::vector<size_t> rows;
+    for (size_t row = 0; row < m_row_count; row++)
+    {
+        if (is_deleted(row))
+            rows.push_back(row);
+    }
+
+    m_deleted_rows_chunk->drop();
+    m_deleted_rows_chunk = nullptr;
+    m_deleted_rows.clear();
+    if (rows.empty())
+        return;
+
+    for (auto &tree : m_indexes)
+        tree->shift_rows(rows);
+
+    // Mark which rows in each chunk are removed, then
+    // move the rest of them up in one go
+    auto &zone_map = writable_zone_map();
+    auto it = rows.begin();
+    size_t row_count_at_start_of_chunk = 0;
+    std::vector<bool> is_removed;
+    std::vector<char> buffer;
+    for (size_t position = 0; position < m_row_data_chunks.size(); position++)
+    {
+        const auto &chunk = m_row_data_chunks[position];
+        auto chunk_row_count = rows_in_chunk(position);
+        auto first_row = row_count_at_start_of_chunk;
+        row_count_at_start_of_chunk += chunk_row_count;
+        if (it == rows.end() || *it >= row_count_at_start_of_chunk)
+            continue;
+
+        is_removed.assign(chunk_row_count, false);
+        for (; it != rows.end() && *it < row_count_at_start_of_chunk; ++it)
+            is_removed[*it - first_row] = true;
+
+        // Nothing before the first removed row moves
+        size_t first_removed = std::find(is_removed.begin(), is_removed.end(), true) - is_removed.begin();
+        buffer.resize((chunk_row_count - first_removed) * m_row_size);
+        read_chunk_rows(*chunk, first_removed, chunk_row_count - first_removed, buffer.data());
+
+        size_t kept = 0;
+        for (size_t i = first_removed; i < chunk_row_count; i++)
+        {
+            if (is_removed[i])
+                continue;
+
+            auto from = (i - first_removed) * m_row_size;
+            memmove(buffer.data() + kept * m_row_size, buffer.data() + from, m_row_size);
+            kept += 1;
+        }
+
+        if (kept > 0)
+            write_chunk_rows(*chunk, first_removed, kept, buffer.data());
+        set_rows_in_chunk(position, first_removed + kept);
+
+        // Rows have moved from the first removed one's block
+        // on, so the zones from there are worked out again
+        auto first_block = first_removed / Config::zone_map_rows;
+        auto block_start = first_block * Config::zone_map_rows;
+        auto new_row_count = first_removed + kept;
+        zone_map.clear(chunk->index(), first_block);
+        buffer.resize((new_row_count - block_start) * m_row_size);
+        read_chunk_rows(*chunk, block_start, new_row_count - block_start, buffer.data());
+        for (size_t i = block_start; i < new_row_count; i++)
+        {
+            auto *row_data = buffer.data() + (i - block_start) * m_row_size;
+            zone_map.add(chunk->index(), i / Config::zone_map_rows, row_data);
+        }
+    }
 
     // Update row count
-    m_row_count -= 1;
-    m_header->write_int(m_row_count_offset, m_row_count);
+    m_row_count -= rows.size();
+    write_row_count();
 }
 
 Row Table::make_row()
 {
-    return Row(m_columns);
+    return Row(m_schema, m_row_size);
 }
 
 std::tuple<std::shared_ptr<Chunk>, size_t> Table::find_chunk_and_offset_for_row(size_t row)
@@ -198,10 +698,10 @@ std::tuple<std::shared_ptr<Chunk>, size_t> Table::find_chunk_and_offset_for_row(
     size_t curr_max_row_count = 0;
     size_t row_count_at_start_of_chunk = 0;
 
-    for (const auto &chunk : m_row_data_chunks)
+    for (size_t position = 0; position < m_row_data_chunks.size(); position++)
     {
-        auto chunk_size_in_bytes = chunk->size_in_bytes();
-        auto chunk_row_count = chunk_size_in_bytes / m_row_size;
+        const auto &chunk = m_row_data_chunks[position];
+        auto chunk_row_count = rows_in_chunk(position);
         row_count_at_start_of_chunk = curr_max_row_count;
         curr_max_row_count += chunk_row_count;
 
@@ -229,25 +729,207 @@ int Table::find_next_row_chunk_index()
     return max_index + 1;
 }
 
-std::optional<Row> Table::get_row(size_t index)
+size_t Table::rows_in_chunk(size_t position) const
+{
+    if (!m_is_columnar)
+        return m_row_data_chunks[position]->size_in_bytes() / m_row_size;
+    return m_segment_row_counts[position];
+}
+
+void Table::set_rows_in_chunk(size_t position, size_t count)
+{
+    auto &chunk = m_row_data_chunks[position];
+    if (!m_is_columnar)
+    {
+        chunk->shrink_to(count * m_row_size);
+        return;
+    }
+
+    chunk->write_long(0, count);
+    m_segment_row_counts[position] = count;
+}
+
+void Table::read_chunk_rows(Chunk &chunk, size_t first, size_t count, char *data)
+{
+    if (!m_is_columnar)
+    {
+        chunk.read_bytes(first * m_row_size, data, count * m_row_size);
+        return;
+    }
+
+    // Put the rows together from each column's values
+    memset(data, 0xCD, count * m_row_size);
+    std::vector<char> values;
+    std::vector<uint64_t> nulls;
+    for (size_t i = 0; i < m_columns.size(); i++)
+    {
+        const auto &column = m_columns[i];
+        auto data_size = column.data_type().data_size();
+        auto segment_offset = m_segment_offsets[i];
+        values.resize(count * data_size);
+        chunk.read_bytes(segment_offset + Config::columnar_segment_rows / 8 + first * data_size,
+            values.data(), values.size());
+
+        // NOTE: Whole bytes of the bitmap are read, so it's
+        //       shifted by the rows before the first in its byte
+        auto first_byte = first / 8;
+        auto last_byte = (first + count + 7) / 8;
+        nulls.assign((last_byte - first_byte + 7) / 8, 0);
+        chunk.read_bytes(segment_offset + first_byte, (char*)nulls.data(), last_byte - first_byte);
+
+        for (size_t row = 0; row < count; row++)
+        {
+            auto bit = first % 8 + row;
+            char *row_data = data + row * m_row_size;
+            column.set_null(row_data, (nulls[bit / 64] >> (bit % 64)) & 1);
+            memcpy(row_data + column.offset(), values.data() + row * data_size, data_size);
+        }
+    }
+}
+
+void Table::write_chunk_rows(Chunk &chunk, size_t first, size_t count, const char *data)
+{
+    if (!m_is_columnar)
+    {
+        chunk.write_bytes(first * m_row_size, data, count * m_row_size);
+        return;
+    }
+
+    // Split the rows into each column's values
+    std::vector<char> values;
+    std::vector<char> nulls;
+    for (size_t i = 0; i < m_columns.size(); i++)
+    {
+        const auto &column = m_columns[i];
+        auto data_size = column.data_type().data_size();
+        auto segment_offset = m_segment_offsets[i];
+        values.resize(count * data_size);
+        for (size_t row = 0; row < count; row++)
+            memcpy(values.data() + row * data_size, data + row * m_row_size + column.offset(), data_size);
+        chunk.write_bytes(segment_offset + Config::columnar_segment_rows / 8 + first * data_size,
+            values.data(), values.size());
+
+        // The bytes at either end may have bits of other rows
+        auto first_byte = first / 8;
+        auto last_byte = (first + count + 7) / 8;
+        nulls.resize(last_byte - first_byte);
+        chunk.read_bytes(segment_offset + first_byte, nulls.data(), nulls.size());
+        for (size_t row = 0; row < count; row++)
+        {
+            auto bit = first % 8 + row;
+            auto mask = (char)(1 << (bit % 8));
+            if (column.is_null(data + row * m_row_size))
+                nulls[bit / 8] |= mask;
+            else
+                nulls[bit / 8] &= ~mask;
+        }
+        chunk.write_bytes(segment_offset + first_byte, nulls.data(), nulls.size());
+    }
+}
+
+void Table::read_column(size_t first, size_t count, size_t column, char *values, uint64_t *nulls)
+{
+    assert (m_is_columnar);
+    auto [chunk, offset] = find_chunk_and_offset_for_row(first);
+    assert (chunk && offset == 0);
+
+    auto data_size = m_columns[column].data_type().data_size();
+    auto segment_offset = m_segment_offsets[column];
+    chunk->read_bytes(segment_offset + Config::columnar_segment_rows / 8, values, count * data_size);
+
+    auto words = (count + 63) / 64;
+    memset(nulls, 0, words * sizeof(uint64_t));
+    chunk->read_bytes(segment_offset, (char*)nulls, (count + 7) / 8);
+
+    // Rows that have been removed may have left bits after the last
+    if (count % 64 != 0)
+        nulls[words - 1] &= (uint64_t(1) << (count % 64)) - 1;
+}
+
+void Table::read_row(size_t index, char *data)
 {
     auto [chunk, offset] = find_chunk_and_offset_for_row(index);
     assert (chunk);
 
-    Row row(m_columns);
-    row.read(*chunk, offset);
-    return std::move(row);
+    read_chunk_rows(*chunk, offset / m_row_size, 1, data);
+}
+
+void Table::read_rows(size_t first, size_t count, char *data)
+{
+    while (count > 0)
+    {
+        auto [chunk, offset] = find_chunk_and_offset_for_row(first);
+        assert (chunk);
+
+        // Read as much as we can from this chunk
+        auto row_in_chunk = offset / m_row_size;
+        auto position = std::find(m_row_data_chunks.begin(), m_row_data_chunks.end(), chunk) - m_row_data_chunks.begin();
+        auto rows_to_read = std::min(count, rows_in_chunk(position) - row_in_chunk);
+        read_chunk_rows(*chunk, row_in_chunk, rows_to_read, data);
+
+        data += rows_to_read * m_row_size;
+        first += rows_to_read;
+        count -= rows_to_read;
+    }
+}
+
+std::vector<std::pair<size_t, size_t>> Table::row_ranges() const
+{
+    std::vector<std::pair<size_t, size_t>> ranges;
+    size_t first = 0;
+    for (size_t position = 0; position < m_row_data_chunks.size(); position++)
+    {
+        auto count = std::min(rows_in_chunk(position), m_row_count - first);
+        if (count > 0)
+            ranges.emplace_back(first, count);
+        first += count;
+    }
+
+    return ranges;
+}
+
+void Table::for_each_block(const std::function<void(size_t first, size_t count, const ZoneMap::Zone*)> &callback) const
+{
+    size_t first = 0;
+    for (size_t position = 0; position < m_row_data_chunks.size(); position++)
+    {
+        const auto &chunk = m_row_data_chunks[position];
+        auto count = std::min(rows_in_chunk(position), m_row_count - first);
+        for (size_t start = 0; start < count; start += Config::zone_map_rows)
+        {
+            auto block = start / Config::zone_map_rows;
+            auto *zone = m_zone_map ? m_zone_map->find(chunk->index(), block) : nullptr;
+            callback(first + start, std::min(Config::zone_map_rows, count - start), zone);
+        }
+        first += count;
+    }
+}
+
+std::optional<Row> Table::get_row(size_t index)
+{
+    if (is_deleted(index))
+        return std::nullopt;
+
+    std::vector<char> buffer(m_row_size);
+    read_row(index, buffer.data());
+    return RowView(*this, buffer.data()).decode();
 }
 
 void Table::add_row_data(std::shared_ptr<Chunk> data)
 {
-    m_row_data_chunks.push_back(std::move(data));
+    // Make sure chunks are in the correct order (by index). They're
+    // almost always loaded in order, so this is usually at the end.
+    auto position = std::upper_bound(m_row_data_chunks.begin(), m_row_data_chunks.end(), data,
+        [](const auto &a, const auto &b) { return a->index() < b->index(); });
 
-    // Make sure chunks are in the correct order (sort by index)
-    std::sort(m_row_data_chunks.begin(), m_row_data_chunks.end(), [](const auto &a, const auto &b)
+    // NOTE: A segment's row count is kept in the same order as them
+    if (data->type() == "CS")
     {
-        return a->index() < b->index();
-    });
+        auto count = (size_t)data->read_long(0);
+        m_segment_row_counts.insert(m_segment_row_counts.begin() +
+            (position - m_row_data_chunks.begin()), count);
+    }
+    m_row_data_chunks.insert(position, std::move(data));
 }
 
 void Table::add_dynamic_data(std::shared_ptr<Chunk> data)
@@ -266,9 +948,190 @@ std::shared_ptr<Chunk> Table::find_dynamic_chunk(int id)
     return nullptr;
 }
 
+TextHeap &Table::text_heap()
+{
+    if (!m_text_heap)
+    {
+        m_text_heap = std::shared_ptr<TextHeap>(new TextHeap(m_db, m_id));
+        m_text_heap->m_is_compressed = m_is_compressed;
+    }
+    return *m_text_heap;
+}
+
+void Table::add_text_page(std::shared_ptr<Chunk> data)
+{
+    text_heap().add_page(std::move(data));
+}
+
+void Table::set_text_map(std::shared_ptr<Chunk> data)
+{
+    text_heap().set_map(std::move(data));
+}
+
+void Table::set_dictionary(std::shared_ptr<Chunk> data)
+{
+    // NOTE: A dictionary's chunk index is its column
+    auto column = data->index();
+    assert (column < m_columns.size() && m_columns[column].m_dictionary);
+    m_columns[column].m_dictionary->load(std::move(data));
+}
+
+void Table::set_zone_map(std::shared_ptr<Chunk> data)
+{
+    m_zone_map = std::shared_ptr<ZoneMap>(new ZoneMap(m_db, m_id, m_columns));
+    m_zone_map->load(std::move(data));
+}
+
+ZoneMap &Table::writable_zone_map()
+{
+    // NOTE: Tables from before zone maps get one
+    //       the first time they're written to
+    if (!m_zone_map)
+        build_zone_map();
+    return *m_zone_map;
+}
+
+void Table::build_zone_map()
+{
+    if (m_zone_map)
+        m_zone_map->drop();
+    m_zone_map = std::shared_ptr<ZoneMap>(new ZoneMap(m_db, m_id, m_columns));
+    m_zone_map->create();
+
+    std::vector<char> buffer;
+    size_t first = 0;
+    for (size_t position = 0; position < m_row_data_chunks.size(); position++)
+    {
+        const auto &chunk = m_row_data_chunks[position];
+        auto count = std::min(rows_in_chunk(position), m_row_count - first);
+        buffer.resize(count * m_row_size);
+        read_chunk_rows(*chunk, 0, count, buffer.data());
+        for (size_t i = 0; i < count; i++)
+            m_zone_map->add(chunk->index(), i / Config::zone_map_rows, buffer.data() + i * m_row_size);
+        first += count;
+    }
+}
+
+void Table::read_text(const DataType &type, const char *data, std::string &text)
+{
+    if (type.length() == 1)
+    {
+        auto chunk = find_dynamic_chunk((uint8_t)data[0]);
+        text.resize(chunk ? chunk->size_in_bytes() : 0);
+        if (chunk)
+            chunk->read_bytes(0, text.data(), text.size());
+        return;
+    }
+
+    uint32_t id;
+    memcpy(&id, data, sizeof(id));
+    if (id == TextHeap::null_id || !m_text_heap)
+    {
+        text.clear();
+        return;
+    }
+
+    m_text_heap->read(id, text);
+}
+
+std::optional<size_t> Table::column_index(const std::string &name) const
+{
+    for (size_t i = 0; i < m_columns.size(); i++)
+    {
+        if (m_columns[i].name() == name)
+            return i;
+    }
+
+    return std::nullopt;
+}
+
+size_t Table::column_offset(size_t column) const
+{
+    return m_columns[column].offset();
+}
+
+Index *Table::get_index(const std::string &name)
+{
+    for (auto &index : m_indexes)
+    {
+        if (index->name() == name)
+            return index.get();
+    }
+
+    return nullptr;
+}
+
+Index *Table::find_index_for_column(const std::string &column_name)
+{
+    for (auto &index : m_indexes)
+    {
+        if (index->column_name() == column_name)
+            return index.get();
+    }
+
+    return nullptr;
+}
+
+Index &Table::create_index(const std::string &name, const std::string &column_name)
+{
+    int max_index = 0;
+    for (const auto &index : m_indexes)
+        max_index = std::max(max_index, (int)index->m_chunk->index());
+
+    auto index = Index::create(m_db, m_id, max_index + 1, name, column_name);
+    set_up_index(*index);
+
+    // Add the rows we already have
+    std::vector<char> buffer;
+    for (auto [first, count] : row_ranges())
+    {
+        buffer.resize(count * m_row_size);
+        read_rows(first, count, buffer.data());
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!is_deleted(first + i))
+                index->insert(index->key_for_row(buffer.data() + i * m_row_size), first + i);
+        }
+    }
+
+    m_indexes.push_back(index);
+    return *index;
+}
+
+void Table::add_index(std::shared_ptr<Chunk> data)
+{
+    auto index = std::shared_ptr<Index>(new Index(std::move(data)));
+    set_up_index(*index);
+    m_indexes.push_back(index);
+}
+
+void Table::set_up_index(Index &index)
+{
+    auto column = column_index(index.column_name());
+    assert (column);
+
+    index.m_column_offset = column_offset(*column);
+    index.m_column_type = m_columns[*column].data_type();
+}
+
 void Table::drop()
 {
     m_header->drop();
     for (const auto &chunk : m_row_data_chunks)
         chunk->drop();
+    for (const auto &index : m_indexes)
+        index->m_chunk->drop();
+    for (const auto &chunk : m_dynamic_data_chunks)
+        chunk->drop();
+    if (m_text_heap)
+        m_text_heap->drop();
+    if (m_zone_map)
+        m_zone_map->drop();
+    if (m_deleted_rows_chunk)
+        m_deleted_rows_chunk->drop();
+    for (const auto &column : m_columns)
+    {
+        if (column.m_dictionary)
+            column.m_dictionary->drop();
+    }
 }
@@ -2,6 +2,8 @@
 #include "forward.hpp"
 #include "column.hpp"
 #include "row.hpp"
+#include "zonemap.hpp"
+#include <functional>
 #include <vector>
 #include <string>
 #include <optional>
@@ -14,6 +16,8 @@ namespace DB
     {
         friend DataBase;
         friend TextEntry;
+        friend RowView;
+        friend Sql::Program;
 
     public:
         Table(const Table&) = default;
@@ -32,20 +36,103 @@ namespace DB
                 m_columns.emplace_back(name, type);
             }
 
+            // See `Table::is_columnar`
+            void set_columnar(bool is_columnar)
+            {
+                m_is_columnar = is_columnar;
+            }
+
         private:
             std::string m_name;
             std::vector<std::pair<std::string, DataType>> m_columns;
+            bool m_is_columnar { false };
 
         };
 
-        inline int id() const { return m_id; }
+        inline DataBase &db() { return m_db; }
+        inline uint32_t id() const { return m_id; }
         inline const std::string &name() const { return m_name; }
+        // Including deleted rows, until the table is cleaned up (see `is_deleted`)
         inline size_t row_count() const { return m_row_count; }
-
+        inline size_t row_size() const { return m_row_size; }
+        inline const std::vector<Column> &columns() const { return m_columns; }
+
+        // A copy of the columns made once they're laid out, which
+        // rows decoded from the table share instead of copying them
+        inline const std::shared_ptr<const std::vector<Column>> &schema() const { return m_schema; }
+        inline bool is_compressed() const { return m_is_compressed; }
+
+        // Columnar tables keep their rows in segments ("CS" chunks) of
+        // `Config::columnar_segment_rows`, each holding the values of one
+        // column after another, with a bitmap of which are null. Rows are
+        // put together from them when read, but blocks of a column can be
+        // read on their own, see `read_column`.
+        inline bool is_columnar() const { return m_is_columnar; }
+        std::optional<size_t> column_index(const std::string &name) const;
+
+        // Where a column's data is in an encoded row
+        size_t column_offset(size_t column) const;
+
+        inline const std::vector<std::shared_ptr<Index>> &indexes() const { return m_indexes; }
+        Index *get_index(const std::string &name);
+        Index *find_index_for_column(const std::string &column_name);
+        Index &create_index(const std::string &name, const std::string &column_name);
+
+        // Gives nothing for deleted rows
         std::optional<Row> get_row(size_t index);
+
+        // Read encoded rows, `data` must hold `count * row_size()` bytes
+        void read_row(size_t index, char *data);
+        void read_rows(size_t first, size_t count, char *data);
+
+        // Read one column of a block of a columnar table (see `for_each_block`),
+        // `values` must hold `count` of the column's data and `nulls` a bit
+        // for each row, which is set if it's null
+        void read_column(size_t first, size_t count, size_t column, char *values, uint64_t *nulls);
+
+        // The first row and row count of each row data chunk, in order
+        std::vector<std::pair<size_t, size_t>> row_ranges() const;
+
+        inline const ZoneMap *zone_map() const { return m_zone_map.get(); }
+
+        // Call `callback` with the first row, row count and zone of each
+        // block of rows, in order. Zones are null if not worked out yet.
+        void for_each_block(const std::function<void(size_t first, size_t count, const ZoneMap::Zone*)> &callback) const;
+
+        // Compressed tables have their row data and TEXT values
+        // compressed, once nothing more is being added to them.
+        // Turning it off uncompresses everything again.
+        void set_compressed(bool);
+
+        // Compress any row data chunks and text pages that can be
+        void compress();
+
+        // Work out the zone map again from the rows
+        void build_zone_map();
         void update_row(size_t index, Row);
         void remove_row(size_t index);
+
+        // Remove many rows at once. `rows` must be sorted and not repeat.
+        void remove_rows(const std::vector<size_t> &rows);
+
+        // Removed rows are only marked as deleted, in a bitmap kept in a
+        // "DL" chunk, so no other row moves and index entries stay as they
+        // are. Scans skip them until they're purged.
+        bool is_deleted(size_t row) const;
+
+        // Clear the bits of deleted rows in a selection of `count`
+        // rows from `first`, like the ones `Kernels::filter` narrows
+        void unselect_deleted(size_t first, size_t count, uint64_t *selection) const;
+
+        // Move the rest of the rows up over the deleted ones. This
+        // renumbers every index entry after them, so it's left for
+        // when the database is cleaned up.
+        void purge_deleted_rows();
         void add_row(Row);
+
+        // Add many rows at once, they're encoded together and
+        // written to the end of the table in one go
+        void add_rows(std::vector<Row>);
         Row make_row();
         void drop();
 
@@ -53,25 +140,78 @@ namespace DB
         Table(DataBase&, Constructor);
         Table(DataBase&, std::shared_ptr<Chunk> header);
 
+        // Take on the state of a newly loaded copy of this table
+        void reload(Table&&);
+
         std::tuple<std::shared_ptr<Chunk>, size_t> find_chunk_and_offset_for_row(size_t row);
+        size_t rows_in_chunk(size_t position) const;
+
+        // Read or write rows of a row data chunk, either
+        // as they are or to and from a segment's columns
+        void read_chunk_rows(Chunk&, size_t first, size_t count, char *data);
+        void write_chunk_rows(Chunk&, size_t first, size_t count, const char *data);
+        void set_rows_in_chunk(size_t position, size_t count);
         std::unique_ptr<DynamicData> new_dynamic_data();
         std::shared_ptr<Chunk> find_dynamic_chunk(int id);
+        TextHeap &text_heap();
+
+        // Read the TEXT value a row refers to, `data` is
+        // the column's data after its 'is null' flag
+        void read_text(const DataType&, const char *data, std::string &text);
         int find_next_row_chunk_index();
+
+        // Append `count` encoded rows to the active row data chunk
+        void append_rows(const char *data, size_t count);
         void add_row_data(std::shared_ptr<Chunk> data);
         void add_dynamic_data(std::shared_ptr<Chunk> data);
+        void add_text_page(std::shared_ptr<Chunk> data);
+        void set_text_map(std::shared_ptr<Chunk> data);
+        void set_zone_map(std::shared_ptr<Chunk> data);
+        void set_dictionary(std::shared_ptr<Chunk> data);
+        void set_deleted_rows(std::shared_ptr<Chunk> data);
+        void mark_deleted(const std::vector<size_t> &rows);
+        ZoneMap &writable_zone_map();
+        void add_index(std::shared_ptr<Chunk> data);
+        void set_up_index(Index&);
+        void lay_out_columns();
+        void lay_out_segment();
         void write_header();
+        void write_flags();
+        size_t row_count_size() const;
+        size_t read_row_count();
+        void write_row_count();
 
         DataBase &m_db;
         std::shared_ptr<Chunk> m_header;
         std::vector<std::shared_ptr<Chunk>> m_row_data_chunks;
         std::vector<std::shared_ptr<Chunk>> m_dynamic_data_chunks;
+        std::vector<std::shared_ptr<Index>> m_indexes;
+        std::shared_ptr<TextHeap> m_text_heap;
+        std::shared_ptr<ZoneMap> m_zone_map;
+
+        // A bit for each row, set if it's deleted. Rows
+        // past the end of it haven't been deleted.
+        std::shared_ptr<Chunk> m_deleted_rows_chunk;
+        std::vector<uint64_t> m_deleted_rows;
+
         size_t m_row_count_offset;
+        size_t m_flags_offset { 0 };
+
+        // Where each column's null bitmap is in a segment, with its values
+        // straight after. Segments are always made this size, and their
+        // row count is kept in memory as well as at their start.
+        std::vector<size_t> m_segment_offsets;
+        size_t m_segment_size { 0 };
+        std::vector<size_t> m_segment_row_counts;
 
-        int m_id { 0xCD };
+        uint32_t m_id { 0xCD };
         std::string m_name;
         std::vector<Column> m_columns;
+        std::shared_ptr<const std::vector<Column>> m_schema;
         size_t m_row_size { 0 };
         size_t m_row_count { 0 };
+        bool m_is_compressed { false };
+        bool m_is_columnar { false };
 
     };
 
@@ -0,0 +1,258 @@
+#include "config.hpp"
+#include "textheap.hpp"
+#include "database.hpp"
+#include "chunk.hpp"
+#include <algorithm>
+#include <cassert>
+using namespace DB;
+
+// Page layout: page number, slot count and where the data starts,
+// followed by the slots, each an offset and length into the page
+static constexpr size_t page_header_size = 3 * sizeof(int);
+static constexpr size_t slot_size = 2 * sizeof(int);
+
+// Map layout: id count, then the location of each id
+static constexpr size_t map_header_size = sizeof(int64_t);
+static constexpr int64_t no_location = -1;
+
+void TextHeap::add_page(std::shared_ptr<Chunk> page)
+{
+    auto number = (size_t)(uint32_t)page->read_int(0);
+    if (number >= m_pages.size())
+        m_pages.resize(number + 1);
+    m_pages[number] = std::move(page);
+}
+
+void TextHeap::set_map(std::shared_ptr<Chunk> map)
+{
+    m_map = std::move(map);
+    m_id_count = (uint32_t)m_map->read_int(0);
+}
+
+void TextHeap::create_map()
+{
+    m_map = m_db.new_chunk("TM", m_owner_id, 0);
+    m_map->write_int(0, 0);
+    m_id_count = 0;
+}
+
+void TextHeap::drop()
+{
+    for (const auto &page : m_pages)
+    {
+        if (page)
+            page->drop();
+    }
+    if (m_map)
+        m_map->drop();
+
+    m_pages.clear();
+    m_map = nullptr;
+    m_id_count = 0;
+}
+
+void TextHeap::compress()
+{
+    for (size_t i = 0; i + 1 < m_pages.size(); i++)
+    {
+        if (m_pages[i])
+            m_pages[i] = m_db.compress_chunk(m_pages[i]);
+    }
+}
+
+void TextHeap::expand()
+{
+    for (const auto &page : m_pages)
+    {
+        if (page && page->is_compressed())
+            m_db.expand_chunk(*page);
+    }
+}
+
+TextHeap::PageHeader TextHeap::read_page_header(Chunk &page)
+{
+    PageHeader header;
+    header.slot_count = (uint32_t)page.read_int(sizeof(int));
+    header.data_start = (uint32_t)page.read_int(2 * sizeof(int));
+    return header;
+}
+
+void TextHeap::write_page_header(Chunk &page, const PageHeader &header)
+{
+    int data[] = { (int)header.slot_count, (int)header.data_start };
+    page.write_bytes(sizeof(int), (const char*)data, sizeof(data));
+}
+
+std::shared_ptr<Chunk> TextHeap::new_page(size_t size)
+{
+    if (m_is_compressed && !m_pages.empty() && m_pages.back())
+        m_pages.back() = m_db.compress_chunk(m_pages.back());
+
+    auto page = m_db.new_chunk("TX", m_owner_id, 0);
+    page->write_byte(size - 1, 0);
+    page->write_int(0, (int)m_pages.size());
+    write_page_header(*page, PageHeader { 0, (uint32_t)size });
+    m_pages.push_back(page);
+    return page;
+}
+
+TextHeap::Location TextHeap::allocate(std::string_view text)
+{
+    // New values go in the last page, or a new one if they don't fit.
+    // Values bigger than a page get a page of their own.
+    auto needed = text.size() + slot_size;
+    std::shared_ptr<Chunk> page;
+    PageHeader header;
+    if (!m_pages.empty() && m_pages.back())
+    {
+        page = m_pages.back();
+        header = read_page_header(*page);
+        auto slots_end = page_header_size + header.slot_count * slot_size;
+        if (header.data_start - slots_end < needed)
+            page = nullptr;
+    }
+
+    if (!page)
+    {
+        page = new_page(std::max(Config::text_page_size, page_header_size + needed));
+        header = read_page_header(*page);
+    }
+
+    auto slot = header.slot_count;
+    header.data_start -= text.size();
+    header.slot_count += 1;
+
+    int slot_data[] = { (int)header.data_start, (int)text.size() };
+    page->write_bytes(header.data_start, text.data(), text.size());
+    page->write_bytes(page_header_size + slot * slot_size, (const char*)slot_data, sizeof(slot_data));
+    write_page_header(*page, header);
+    return Location { (uint32_t)m_pages.size() - 1, slot };
+}
+
+bool TextHeap::find_location(uint32_t id, Location &location)
+{
+    if (id >= m_id_count)
+        return false;
+
+    auto packed = m_map->read_long(map_header_size + id * sizeof(int64_t));
+    if (packed == no_location)
+        return false;
+
+    location.page = (uint32_t)((uint64_t)packed >> 32);
+    location.slot = (uint32_t)packed;
+    return location.page < m_pages.size() && m_pages[location.page];
+}
+
+void TextHeap::reserve_map(size_t size)
+{
+    if (size <= m_map->size_in_bytes() || m_map->is_active())
+        return;
+
+    // NOTE: Only the active chunk can grow, so move the
+    //       map to a new chunk at the end with room to spare
+    std::vector<char> data(m_map->size_in_bytes());
+    m_map->read_bytes(0, data.data(), data.size());
+
+    auto new_map = m_db.new_chunk("TM", m_owner_id, 0);
+    new_map->write_bytes(0, data.data(), data.size());
+    new_map->write_byte(std::max(size, data.size() * 2) - 1, 0);
+
+    m_map->drop();
+    m_map = new_map;
+}
+
+void TextHeap::write_location(uint32_t id, int64_t location)
+{
+    m_map->write_long(map_header_size + id * sizeof(int64_t), location);
+}
+
+uint32_t TextHeap::insert(std::string_view text)
+{
+    if (!m_map)
+        create_map();
+
+    auto location = allocate(text);
+    auto id = m_id_count;
+    assert (id != null_id);
+
+    reserve_map(map_header_size + (id + 1) * sizeof(int64_t));
+    write_location(id, ((int64_t)location.page << 32) | location.slot);
+    m_id_count += 1;
+    m_map->write_int(0, (int)m_id_count);
+    return id;
+}
+
+void TextHeap::update(uint32_t id, std::string_view text)
+{
+    Location location;
+    if (!find_location(id, location))
+    {
+        assert (false);
+        return;
+    }
+
+    auto &page = *m_pages[location.page];
+    auto slot_offset = page_header_size + location.slot * slot_size;
+    int slot_data[2];
+    page.read_bytes(slot_offset, (char*)slot_data, sizeof(slot_data));
+
+    // Rewrite the value where it is if it still fits
+    if (text.size() <= (size_t)slot_data[1])
+    {
+        slot_data[1] = (int)text.size();
+        page.write_bytes(slot_data[0], text.data(), text.size());
+        page.write_bytes(slot_offset, (const char*)slot_data, sizeof(slot_data));
+        return;
+    }
+
+    // Otherwise move it to the end of its own page's free space,
+    // or failing that, to wherever new values go
+    auto header = read_page_header(page);
+    auto slots_end = page_header_size + header.slot_count * slot_size;
+    if (header.data_start - slots_end >= text.size())
+    {
+        header.data_start -= text.size();
+        slot_data[0] = (int)header.data_start;
+        slot_data[1] = (int)text.size();
+        page.write_bytes(header.data_start, text.data(), text.size());
+        page.write_bytes(slot_offset, (const char*)slot_data, sizeof(slot_data));
+        write_page_header(page, header);
+        return;
+    }
+
+    // NOTE: The old slot is left empty, and its space is not reused
+    int empty_slot[] = { 0, 0 };
+    page.write_bytes(slot_offset, (const char*)empty_slot, sizeof(empty_slot));
+
+    auto new_location = allocate(text);
+    write_location(id, ((int64_t)new_location.page << 32) | new_location.slot);
+}
+
+void TextHeap::remove(uint32_t id)
+{
+    Location location;
+    if (!find_location(id, location))
+        return;
+
+    auto &page = *m_pages[location.page];
+    int empty_slot[] = { 0, 0 };
+    page.write_bytes(page_header_size + location.slot * slot_size,
+        (const char*)empty_slot, sizeof(empty_slot));
+    write_location(id, no_location);
+}
+
+void TextHeap::read(uint32_t id, std::string &text)
+{
+    Location location;
+    if (!find_location(id, location))
+    {
+        text.clear();
+        return;
+    }
+
+    auto &page = *m_pages[location.page];
+    int slot_data[2];
+    page.read_bytes(page_header_size + location.slot * slot_size, (char*)slot_data, sizeof(slot_data));
+    text.resize(slot_data[1]);
+    page.read_bytes(slot_data[0], text.data(), text.size());
+}
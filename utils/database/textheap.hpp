@@ -0,0 +1,79 @@
+#pragma once
+#include "forward.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace DB
+{
+
+    // Where a table keeps its TEXT values. Values are packed into
+    // fixed size slotted pages ("TX" chunks), each with a slot array
+    // growing up from its header and data growing down from its end.
+    // Rows only hold a value id, which a map chunk ("TM") turns into a
+    // page and slot, so a value can move without touching its row.
+    class TextHeap
+    {
+        friend Table;
+
+    public:
+        TextHeap(const TextHeap&) = delete;
+        TextHeap(TextHeap&) = delete;
+
+        static constexpr uint32_t null_id = UINT32_MAX;
+
+        uint32_t insert(std::string_view text);
+        void update(uint32_t id, std::string_view text);
+        void remove(uint32_t id);
+        void read(uint32_t id, std::string &text);
+
+    private:
+        TextHeap(DataBase &db, uint32_t owner_id)
+            : m_db(db)
+            , m_owner_id(owner_id) {}
+
+        struct Location
+        {
+            uint32_t page;
+            uint32_t slot;
+        };
+
+        struct PageHeader
+        {
+            uint32_t slot_count;
+            uint32_t data_start;
+        };
+
+        void add_page(std::shared_ptr<Chunk>);
+        void set_map(std::shared_ptr<Chunk>);
+        void create_map();
+        void drop();
+
+        // Compress every page but the last, which new values go in,
+        // or uncompress them all
+        void compress();
+        void expand();
+
+        Location allocate(std::string_view text);
+        PageHeader read_page_header(Chunk&);
+        void write_page_header(Chunk&, const PageHeader&);
+        std::shared_ptr<Chunk> new_page(size_t size);
+
+        bool find_location(uint32_t id, Location&);
+        void write_location(uint32_t id, int64_t location);
+        void reserve_map(size_t size);
+
+        DataBase &m_db;
+        uint32_t m_owner_id;
+        std::vector<std::shared_ptr<Chunk>> m_pages;
+        std::shared_ptr<Chunk> m_map;
+        uint32_t m_id_count { 0 };
+
+        // Pages are compressed once a new one is started
+        bool m_is_compressed { false };
+
+    };
+
+}
@@ -0,0 +1,509 @@
+#include "config.hpp"
+#include "filelock.hpp"
+#include "storage.hpp"
+#include "wal.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace DB;
+
+// The log starts with a header: magic, reserved, salt
+//
+// Each commit is then written as a single frame:
+//   magic, page count, end of data, [ page number, page data ]*, checksum
+static uint32_t constexpr log_magic = 0x484C4157;
+static size_t constexpr log_header_size = 4 + 4 + 8;
+static uint32_t constexpr frame_magic = 0x4C415744;
+static size_t constexpr frame_header_size = 4 + 4 + 8;
+static size_t constexpr frame_page_size = 8 + Config::page_size;
+
+static uint32_t checksum(const char *data, size_t len)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (uint8_t)data[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+// Calls `on_page` for each page of each whole frame in `log` from
+// `offset`, and returns where the last whole frame ends
+template<typename Callback>
+static size_t read_frames(const std::vector<char> &log, size_t offset, Callback on_page)
+{
+    while (offset + frame_header_size <= log.size())
+    {
+        const char *frame = log.data() + offset;
+        uint32_t magic, page_count;
+        uint64_t end_of_data;
+        memcpy(&magic, frame + 0, 4);
+        memcpy(&page_count, frame + 4, 4);
+        memcpy(&end_of_data, frame + 8, 8);
+
+        // NOTE: A torn or partial frame means we crashed before the
+        //       commit finished, so that transaction never happened.
+        auto frame_size = frame_header_size + page_count * frame_page_size;
+        if (magic != frame_magic || offset + frame_size + 4 > log.size())
+            break;
+
+        uint32_t expected_checksum;
+        memcpy(&expected_checksum, frame + frame_size, 4);
+        if (checksum(frame, frame_size) != expected_checksum)
+            break;
+
+        for (size_t i = 0; i < page_count; i++)
+        {
+            const char *page = frame + frame_header_size + i * frame_page_size;
+            uint64_t page_number;
+            memcpy(&page_number, page, 8);
+            on_page(page_number, page + 8, end_of_data);
+        }
+
+        offset += frame_size + 4;
+    }
+
+    return offset;
+}
+
+std::unique_ptr<WriteAheadLog> WriteAheadLog::open(const std::string &path, Storage &storage, std::unique_ptr<FileLock> lock)
+{
+    if (!lock)
+        return nullptr;
+
+    // NOTE: Whoever opens the database first recovers it, and the
+    //       last to close it removes the log. Either way, wait for
+    //       them to finish before opening the log.
+    auto is_only_user = lock->lock_exclusive(FileLock::Region::Open, false);
+    if (!is_only_user)
+        lock->lock_shared(FileLock::Region::Open);
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        perror("open()");
+        return nullptr;
+    }
+
+    storage.reload();
+    return std::unique_ptr<WriteAheadLog>(new WriteAheadLog(path, fd, storage, std::move(lock), is_only_user));
+}
+
+WriteAheadLog::WriteAheadLog(const std::string &path, int fd, Storage &storage,
+                             std::unique_ptr<FileLock> lock, bool is_only_user)
+    : m_path(path)
+    , m_fd(fd)
+    , m_storage(storage)
+    , m_lock(std::move(lock))
+    , m_is_only_user(is_only_user)
+    , m_committed_end_of_data(storage.size())
+{
+}
+
+void WriteAheadLog::recover()
+{
+    if (!m_is_only_user)
+        return;
+
+    struct stat log_stat;
+    if (fstat(m_fd, &log_stat) < 0 || log_stat.st_size == 0)
+    {
+        m_lock->lock_shared(FileLock::Region::Open);
+        return;
+    }
+
+    std::vector<char> log(log_stat.st_size);
+    if (pread(m_fd, log.data(), log.size(), 0) != (ssize_t)log.size())
+    {
+        perror("pread()");
+        m_lock->lock_shared(FileLock::Region::Open);
+        return;
+    }
+
+    // NOTE: Logs from before there was a header start with a frame
+    size_t offset = 0;
+    uint32_t magic = 0;
+    if (log.size() >= log_header_size)
+        memcpy(&magic, log.data(), 4);
+    if (magic == log_magic)
+        offset = log_header_size;
+
+    size_t frames_end = read_frames(log, offset, [&](uint64_t page_number, const char *data, uint64_t end_of_data)
+    {
+        write_to_storage(page_number, data, end_of_data);
+        m_committed_end_of_data = end_of_data;
+    });
+
+#ifdef DEBUG_WAL
+    std::cout << "WAL: Recovered " << frames_end - offset << " bytes of transactions\n";
+#endif
+
+    if (frames_end > offset)
+        m_storage.sync();
+    trim_storage();
+    checkpoint();
+    m_committed_end_of_data = m_storage.size();
+
+    // Now other processes can open it
+    m_lock->lock_shared(FileLock::Region::Open);
+}
+
+void WriteAheadLog::begin_read()
+{
+    std::lock_guard<std::mutex> lock(m_reader_mutex);
+    if (m_reader_count++ == 0)
+        m_lock->lock_shared(FileLock::Region::Read);
+}
+
+void WriteAheadLog::end_read()
+{
+    std::lock_guard<std::mutex> lock(m_reader_mutex);
+    assert (m_reader_count > 0);
+    if (--m_reader_count == 0)
+        m_lock->unlock(FileLock::Region::Read);
+}
+
+void WriteAheadLog::begin_write()
+{
+    m_lock->lock_exclusive(FileLock::Region::Write);
+}
+
+void WriteAheadLog::end_write()
+{
+    m_lock->unlock(FileLock::Region::Write);
+}
+
+uint64_t WriteAheadLog::read_salt(size_t log_size)
+{
+    if (log_size < log_header_size)
+        return 0;
+
+    char header[log_header_size];
+    if (pread(m_fd, header, sizeof(header), 0) != (ssize_t)sizeof(header))
+        return 0;
+
+    uint32_t magic;
+    uint64_t salt;
+    memcpy(&magic, header, 4);
+    memcpy(&salt, header + 8, 8);
+    return magic == log_magic ? salt : 0;
+}
+
+bool WriteAheadLog::has_changed()
+{
+    struct stat log_stat;
+    if (fstat(m_fd, &log_stat) < 0)
+        return false;
+
+    auto log_size = (size_t)log_stat.st_size;
+    return log_size != m_log_size || read_salt(log_size) != m_salt;
+}
+
+bool WriteAheadLog::refresh()
+{
+    struct stat log_stat;
+    if (fstat(m_fd, &log_stat) < 0)
+    {
+        perror("fstat()");
+        return false;
+    }
+
+    bool has_changed = false;
+    auto log_size = (size_t)log_stat.st_size;
+    auto salt = read_salt(log_size);
+    if (salt != m_salt || log_size < m_log_size)
+    {
+        // NOTE: The log has been started again, so everything
+        //       we read from it is in the database now
+        m_committed.clear();
+        m_salt = salt;
+        m_log_size = salt ? log_header_size : 0;
+        m_storage.reload();
+        m_committed_end_of_data = m_storage.size();
+        has_changed = true;
+    }
+
+    if (log_size <= m_log_size)
+        return has_changed;
+
+    std::vector<char> log(log_size - m_log_size);
+    if (pread(m_fd, log.data(), log.size(), m_log_size) != (ssize_t)log.size())
+    {
+        perror("pread()");
+        return has_changed;
+    }
+
+    auto frames_end = read_frames(log, 0, [&](uint64_t page_number, const char *data, uint64_t end_of_data)
+    {
+        m_committed[page_number].assign(data, data + Config::page_size);
+        m_committed_end_of_data = end_of_data;
+    });
+
+    m_log_size += frames_end;
+    return has_changed || frames_end > 0;
+}
+
+void WriteAheadLog::read_from_storage(size_t offset, char *buffer, size_t len)
+{
+    // NOTE: Anything past the end of storage hasn't been written yet
+    auto storage_size = m_storage.size();
+    auto available = offset < storage_size ? std::min(len, storage_size - offset) : 0;
+    if (available > 0)
+        m_storage.read(offset, buffer, available);
+    memset(buffer + available, 0, len - available);
+}
+
+void WriteAheadLog::write_to_storage(size_t page_number, const char *data, size_t end_of_data)
+{
+    auto page_start = page_number * Config::page_size;
+    if (page_start >= end_of_data)
+        return;
+
+    auto len = std::min(Config::page_size, end_of_data - page_start);
+    m_storage.write(page_start, data, len);
+}
+
+void WriteAheadLog::read(size_t offset, void *buffer, size_t len)
+{
+    auto *out = static_cast<char*>(buffer);
+    if (m_transaction.empty() && m_committed.empty())
+    {
+        read_from_storage(offset, out, len);
+        return;
+    }
+
+    while (len > 0)
+    {
+        auto page_number = offset / Config::page_size;
+        auto offset_in_page = offset % Config::page_size;
+        auto count = std::min(len, Config::page_size - offset_in_page);
+
+        const std::vector<char> *page = nullptr;
+        if (auto it = m_transaction.find(page_number); it != m_transaction.end())
+            page = &it->second;
+        else if (auto it = m_committed.find(page_number); it != m_committed.end())
+            page = &it->second;
+
+        if (page)
+            memcpy(out, page->data() + offset_in_page, count);
+        else
+            read_from_storage(offset, out, count);
+
+        out += count;
+        offset += count;
+        len -= count;
+    }
+}
+
+std::vector<char> &WriteAheadLog::page_for_write(size_t page_number)
+{
+    auto page = m_transaction.find(page_number);
+    if (page != m_transaction.end())
+        return page->second;
+
+    auto &data = m_transaction[page_number];
+    auto committed_page = m_committed.find(page_number);
+    if (committed_page != m_committed.end())
+    {
+        data = committed_page->second;
+    }
+    else
+    {
+        data.resize(Config::page_size);
+        read_from_storage(page_number * Config::page_size, data.data(), Config::page_size);
+    }
+
+    return data;
+}
+
+void WriteAheadLog::write(size_t offset, const void *buffer, size_t len)
+{
+    auto *in = static_cast<const char*>(buffer);
+    while (len > 0)
+    {
+        auto offset_in_page = offset % Config::page_size;
+        auto count = std::min(len, Config::page_size - offset_in_page);
+        auto &page = page_for_write(offset / Config::page_size);
+        memcpy(page.data() + offset_in_page, in, count);
+
+        in += count;
+        offset += count;
+        len -= count;
+    }
+}
+
+void WriteAheadLog::start_log()
+{
+    std::random_device random;
+    do
+        m_salt = ((uint64_t)random() << 32) | random();
+    while (m_salt == 0);
+
+    char header[log_header_size] {};
+    memcpy(header, &log_magic, 4);
+    memcpy(header + 8, &m_salt, 8);
+    if (pwrite(m_fd, header, sizeof(header), 0) != (ssize_t)sizeof(header))
+        perror("pwrite()");
+    m_log_size = log_header_size;
+}
+
+bool WriteAheadLog::commit(size_t end_of_data)
+{
+    if (m_transaction.empty())
+        return true;
+
+    if (m_log_size == 0)
+        start_log();
+
+    // Build the whole frame, so it's written in one go
+    std::vector<char> frame(frame_header_size + m_transaction.size() * frame_page_size + 4);
+    uint32_t page_count = m_transaction.size();
+    uint64_t end = end_of_data;
+    memcpy(frame.data() + 0, &frame_magic, 4);
+    memcpy(frame.data() + 4, &page_count, 4);
+    memcpy(frame.data() + 8, &end, 8);
+
+    size_t offset = frame_header_size;
+    for (const auto &[page_number, data] : m_transaction)
+    {
+        uint64_t number = page_number;
+        memcpy(frame.data() + offset, &number, 8);
+        memcpy(frame.data() + offset + 8, data.data(), Config::page_size);
+        offset += frame_page_size;
+    }
+
+    auto frame_checksum = checksum(frame.data(), offset);
+    memcpy(frame.data() + offset, &frame_checksum, 4);
+
+    // NOTE: Whatever made it into the log of a frame that didn't is
+    //       cut off again, so no one takes the log to have changed
+    auto written = pwrite(m_fd, frame.data(), frame.size(), m_log_size);
+    if (written != (ssize_t)frame.size())
+    {
+        if (written < 0)
+            perror("pwrite()");
+        else
+            fprintf(stderr, "WAL: Only %zd of %zu bytes of a commit were written\n", written, frame.size());
+        if (ftruncate(m_fd, m_log_size) < 0)
+            perror("ftruncate()");
+        return false;
+    }
+    m_log_size += frame.size();
+
+    for (auto &[page_number, data] : m_transaction)
+        m_committed[page_number] = std::move(data);
+    m_transaction.clear();
+    m_committed_end_of_data = end_of_data;
+
+    m_pending_commits += 1;
+    if (m_pending_commits >= m_group_size)
+        sync();
+    return true;
+}
+
+void WriteAheadLog::rollback()
+{
+    m_transaction.clear();
+}
+
+bool WriteAheadLog::sync()
+{
+    if (m_pending_commits == 0)
+        return true;
+
+    // NOTE: The log has to be on disk before any of its pages are
+    //       allowed into the database. If it isn't, they're kept
+    //       back, and it's tried again next time.
+    if (fdatasync(m_fd) < 0)
+    {
+        perror("fdatasync()");
+        return false;
+    }
+
+    m_pending_commits = 0;
+    write_back();
+    return true;
+}
+
+void WriteAheadLog::write_back()
+{
+    // NOTE: Other processes may be reading the database, so their
+    //       pages can only be written once they're done. Until then
+    //       they stay in the log, unless it's grown too big.
+    auto is_log_full = m_log_size >= Config::wal_checkpoint_size;
+    if (m_committed.empty() || !m_lock->lock_exclusive(FileLock::Region::Read, is_log_full))
+        return;
+
+    for (const auto &[page_number, data] : m_committed)
+        write_to_storage(page_number, data.data(), m_committed_end_of_data);
+    m_committed.clear();
+    m_storage.flush();
+
+    if (is_log_full)
+    {
+        m_storage.sync();
+
+        // NOTE: Other processes may have grown the file ahead of what
+        //       they write into it, so it's only cut back if no one else
+        //       has it open. Anything after the data is zeros, which
+        //       loading takes to be the end, until it's cut back.
+        if (m_lock->lock_exclusive(FileLock::Region::Open, false))
+        {
+            trim_storage();
+            m_lock->lock_shared(FileLock::Region::Open);
+        }
+        checkpoint();
+    }
+
+    std::lock_guard<std::mutex> lock(m_reader_mutex);
+    if (m_reader_count > 0)
+        m_lock->lock_shared(FileLock::Region::Read);
+    else
+        m_lock->unlock(FileLock::Region::Read);
+}
+
+void WriteAheadLog::trim_storage()
+{
+    m_storage.truncate(std::min(m_committed_end_of_data, m_storage.size()));
+}
+
+void WriteAheadLog::checkpoint()
+{
+    if (ftruncate(m_fd, 0) < 0)
+        perror("ftruncate()");
+    m_log_size = 0;
+    m_salt = 0;
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    assert (m_transaction.empty());
+
+    // NOTE: If anyone else still has the database open, they'll need
+    //       the log to find the last commits. If it couldn't be synced,
+    //       it's left for whoever opens the database next to recover.
+    if (!sync() || !m_lock->lock_exclusive(FileLock::Region::Open, false))
+    {
+        close(m_fd);
+        return;
+    }
+
+    // Everything is in the database now, so the log isn't needed
+    refresh();
+    for (const auto &[page_number, data] : m_committed)
+        write_to_storage(page_number, data.data(), m_committed_end_of_data);
+    m_committed.clear();
+    trim_storage();
+    m_storage.sync();
+    close(m_fd);
+    unlink(m_path.c_str());
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "forward.hpp"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace DB
+{
+
+    // Every process with the database open shares its log. Commits are
+    // appended to it, and only written into the database once no other
+    // process is reading, so readers can always find the pages of the
+    // last commit they've seen in the log or the database.
+    class WriteAheadLog
+    {
+    public:
+        ~WriteAheadLog();
+
+        WriteAheadLog(const WriteAheadLog&) = delete;
+        WriteAheadLog(WriteAheadLog&) = delete;
+
+        static std::unique_ptr<WriteAheadLog> open(const std::string &path, Storage&, std::unique_ptr<FileLock>);
+
+        // Write back any transactions that were committed to the log,
+        // but didn't make it into the database. This is only done if no
+        // other process has the database open.
+        void recover();
+
+        // Hold off other processes writing into the database while
+        // reading it. Any number of threads can read at once.
+        void begin_read();
+        void end_read();
+
+        // Only one process can write at a time
+        void begin_write();
+        void end_write();
+
+        // Whether another process has committed since the last refresh
+        bool has_changed();
+
+        // Read any new commits from the log, returns false if there were none
+        bool refresh();
+
+        // Where the data ends, as of the last commit
+        inline size_t end_of_data() const { return m_committed_end_of_data; }
+        inline bool has_transaction() const { return !m_transaction.empty(); }
+
+        void read(size_t offset, void *buffer, size_t len);
+        void write(size_t offset, const void *buffer, size_t len);
+
+        // Returns false if the transaction couldn't be written to the
+        // log, in which case it's kept, to be rolled back
+        bool commit(size_t end_of_data);
+        void rollback();
+
+        // Make sure all committed transactions are on disk,
+        // returns false if the log couldn't be synced
+        bool sync();
+
+        // Only sync the log after this many commits
+        inline void set_group_size(size_t size) { m_group_size = std::max<size_t>(size, 1); }
+
+    private:
+        using PageMap = std::map<size_t, std::vector<char>>;
+
+        WriteAheadLog(const std::string &path, int fd, Storage&, std::unique_ptr<FileLock>, bool is_only_user);
+
+        std::vector<char> &page_for_write(size_t page_number);
+        void read_from_storage(size_t offset, char *buffer, size_t len);
+        void write_to_storage(size_t page_number, const char *data, size_t end_of_data);
+        uint64_t read_salt(size_t log_size);
+        void start_log();
+        void write_back();
+
+        // Cut the file back to where the data ends, in case storage
+        // grew it ahead of time. Only safe once no one else has it open.
+        void trim_storage();
+        void checkpoint();
+
+        std::string m_path;
+        int m_fd;
+        Storage &m_storage;
+        std::unique_ptr<FileLock> m_lock;
+        bool m_is_only_user;
+
+        // Pages changed by the current transaction, and pages from
+        // committed transactions not yet written into the database
+        PageMap m_transaction;
+        PageMap m_committed;
+        size_t m_committed_end_of_data { 0 };
+
+        // Each time the log is started, it's given a new random salt.
+        // If it's not the one we know, the log has been written back
+        // and started again since we last read it.
+        uint64_t m_salt { 0 };
+
+        std::mutex m_reader_mutex;
+        size_t m_reader_count { 0 };
+
+        size_t m_group_size { 1 };
+        size_t m_pending_commits { 0 };
+        size_t m_log_size { 0 };
+
+    };
+
+}
@@ -0,0 +1,77 @@
+#include "workerpool.hpp"
+#include <cassert>
+using namespace DB;
+
+WorkerPool::WorkerPool(size_t thread_count)
+{
+    for (size_t i = 1; i < thread_count; i++)
+        m_threads.emplace_back([this]() { work(); });
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_is_stopping = true;
+    }
+
+    m_has_work.notify_all();
+    for (auto &thread : m_threads)
+        thread.join();
+}
+
+void WorkerPool::run_tasks(std::unique_lock<std::mutex> &lock)
+{
+    // NOTE: Tasks are handed out one at a time, so the
+    //       lock is only held while picking the next one
+    while (m_task && m_next_task < m_task_count)
+    {
+        auto index = m_next_task++;
+        const auto &task = *m_task;
+        m_running += 1;
+
+        lock.unlock();
+        task(index);
+        lock.lock();
+
+        m_running -= 1;
+    }
+
+    if (m_running == 0)
+        m_is_done.notify_all();
+}
+
+void WorkerPool::work()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_has_work.wait(lock, [this]()
+        {
+            return m_is_stopping || (m_task && m_next_task < m_task_count);
+        });
+
+        if (m_is_stopping)
+            return;
+
+        run_tasks(lock);
+    }
+}
+
+void WorkerPool::run(size_t count, const std::function<void(size_t)> &task)
+{
+    if (count == 0)
+        return;
+
+    std::lock_guard<std::mutex> run_lock(m_run_mutex);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    assert (!m_task);
+    m_task = &task;
+    m_task_count = count;
+    m_next_task = 0;
+    m_has_work.notify_all();
+
+    run_tasks(lock);
+    m_is_done.wait(lock, [this]() { return m_next_task >= m_task_count && m_running == 0; });
+    m_task = nullptr;
+}
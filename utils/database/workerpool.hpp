@@ -0,0 +1,48 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DB
+{
+
+    // A fixed set of threads to spread work over. The thread calling
+    // `run` works through the tasks too, so a pool for `thread_count`
+    // threads only starts `thread_count - 1` of its own.
+    class WorkerPool
+    {
+    public:
+        WorkerPool(size_t thread_count);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool(WorkerPool&) = delete;
+
+        inline size_t thread_count() const { return m_threads.size() + 1; }
+
+        // Call `task` with each index in [0, `count`), and wait for
+        // them all to finish. Tasks may run in any order. If another
+        // thread is already running tasks, this waits for it first.
+        void run(size_t count, const std::function<void(size_t)> &task);
+
+    private:
+        void work();
+        void run_tasks(std::unique_lock<std::mutex>&);
+
+        std::vector<std::thread> m_threads;
+        std::mutex m_run_mutex;
+        std::mutex m_mutex;
+        std::condition_variable m_has_work;
+        std::condition_variable m_is_done;
+
+        const std::function<void(size_t)> *m_task { nullptr };
+        size_t m_task_count { 0 };
+        size_t m_next_task { 0 };
+        size_t m_running { 0 };
+        bool m_is_stopping { false };
+
+    };
+
+}
@@ -0,0 +1,232 @@
+#include "zonemap.hpp"
+#include "database.hpp"
+#include "chunk.hpp"
+#include "index.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+using namespace DB;
+
+// Layout: zone count, then each zone's chunk index and block,
+// followed by the min, max and null count of each column
+static constexpr size_t header_size = sizeof(int64_t);
+static constexpr size_t record_header_size = 2 * sizeof(uint32_t);
+static constexpr size_t column_zone_size = 2 * sizeof(uint64_t) + sizeof(uint32_t);
+static constexpr size_t initial_capacity = 16;
+
+static uint64_t zone_key(uint32_t chunk_index, size_t block)
+{
+    return ((uint64_t)chunk_index << 32) | (uint32_t)block;
+}
+
+size_t ZoneMap::record_size() const
+{
+    return record_header_size + m_columns.size() * column_zone_size;
+}
+
+ZoneMap::ColumnZone ZoneMap::empty_zone(const Column &column) const
+{
+    if (!Index::can_index(column.data_type()))
+        return ColumnZone { 0, UINT64_MAX, 0 };
+    return ColumnZone { UINT64_MAX, 0, 0 };
+}
+
+void ZoneMap::load(std::shared_ptr<Chunk> chunk)
+{
+    m_chunk = std::move(chunk);
+    m_zones.clear();
+    m_records.clear();
+
+    auto count = (size_t)m_chunk->read_long(0);
+    std::vector<char> data(count * record_size());
+    m_chunk->read_bytes(header_size, data.data(), data.size());
+    for (size_t i = 0; i < count; i++)
+    {
+        const char *record = data.data() + i * record_size();
+        uint32_t chunk_index, block;
+        memcpy(&chunk_index, record, sizeof(uint32_t));
+        memcpy(&block, record + sizeof(uint32_t), sizeof(uint32_t));
+
+        Zone zone;
+        for (size_t column = 0; column < m_columns.size(); column++)
+        {
+            const char *column_data = record + record_header_size + column * column_zone_size;
+            ColumnZone column_zone;
+            memcpy(&column_zone.min, column_data, sizeof(uint64_t));
+            memcpy(&column_zone.max, column_data + sizeof(uint64_t), sizeof(uint64_t));
+            memcpy(&column_zone.null_count, column_data + 2 * sizeof(uint64_t), sizeof(uint32_t));
+            zone.columns.push_back(column_zone);
+        }
+
+        auto key = zone_key(chunk_index, block);
+        m_records[key] = m_zones.size();
+        m_zones.emplace_back(key, std::move(zone));
+    }
+}
+
+void ZoneMap::create()
+{
+    m_chunk = m_db.new_chunk("ZM", m_owner_id, 0);
+    m_chunk->write_byte(header_size + initial_capacity * record_size() - 1, 0);
+    m_chunk->write_long(0, 0);
+    m_zones.clear();
+    m_records.clear();
+}
+
+void ZoneMap::drop()
+{
+    if (m_chunk)
+        m_chunk->drop();
+
+    m_chunk = nullptr;
+    m_zones.clear();
+    m_records.clear();
+}
+
+const ZoneMap::Zone *ZoneMap::find(uint32_t chunk_index, size_t block) const
+{
+    auto it = m_records.find(zone_key(chunk_index, block));
+    if (it == m_records.end())
+        return nullptr;
+    return &m_zones[it->second].second;
+}
+
+void ZoneMap::reserve(size_t size)
+{
+    if (size <= m_chunk->size_in_bytes() || m_chunk->is_active())
+        return;
+
+    // NOTE: Only the active chunk can grow, so move the zones
+    //       to a new chunk at the end with room to spare
+    std::vector<char> data(m_chunk->size_in_bytes());
+    m_chunk->read_bytes(0, data.data(), data.size());
+
+    auto new_chunk = m_db.new_chunk("ZM", m_owner_id, 0);
+    new_chunk->write_bytes(0, data.data(), data.size());
+    new_chunk->write_byte(std::max(size, data.size() * 2) - 1, 0);
+
+    m_chunk->drop();
+    m_chunk = new_chunk;
+}
+
+size_t ZoneMap::find_or_add(uint32_t chunk_index, size_t block)
+{
+    auto key = zone_key(chunk_index, block);
+    auto it = m_records.find(key);
+    if (it != m_records.end())
+        return it->second;
+
+    auto record = m_zones.size();
+    Zone zone;
+    for (const auto &column : m_columns)
+        zone.columns.push_back(empty_zone(column));
+    m_records[key] = record;
+    m_zones.emplace_back(key, std::move(zone));
+
+    reserve(header_size + (record + 1) * record_size());
+    uint32_t ids[] = { chunk_index, (uint32_t)block };
+    m_chunk->write_bytes(header_size + record * record_size(), (const char*)ids, sizeof(ids));
+    for (size_t column = 0; column < m_columns.size(); column++)
+        write_column(record, column);
+    m_chunk->write_long(0, m_zones.size());
+    return record;
+}
+
+void ZoneMap::write_column(size_t record, size_t column)
+{
+    const auto &column_zone = m_zones[record].second.columns[column];
+    char data[column_zone_size];
+    memcpy(data, &column_zone.min, sizeof(uint64_t));
+    memcpy(data + sizeof(uint64_t), &column_zone.max, sizeof(uint64_t));
+    memcpy(data + 2 * sizeof(uint64_t), &column_zone.null_count, sizeof(uint32_t));
+
+    auto offset = header_size + record * record_size() + record_header_size + column * column_zone_size;
+    m_chunk->write_bytes(offset, data, sizeof(data));
+}
+
+static bool widen(ZoneMap::ColumnZone &column_zone, const Column &column, const char *row)
+{
+    if (!Index::can_index(column.data_type()))
+        return false;
+
+    auto key = Index::key_for_data(column.data_type(), row + column.offset());
+    if (key >= column_zone.min && key <= column_zone.max)
+        return false;
+
+    column_zone.min = std::min(column_zone.min, key);
+    column_zone.max = std::max(column_zone.max, key);
+    return true;
+}
+
+void ZoneMap::add(uint32_t chunk_index, size_t block, const char *row)
+{
+    auto record = find_or_add(chunk_index, block);
+    auto &zone = m_zones[record].second;
+    for (size_t i = 0; i < m_columns.size(); i++)
+    {
+        const auto &column = m_columns[i];
+        auto &column_zone = zone.columns[i];
+        bool has_changed = false;
+        if (column.is_null(row))
+        {
+            column_zone.null_count += 1;
+            has_changed = true;
+        }
+
+        if (widen(column_zone, column, row))
+            has_changed = true;
+
+        // NOTE: Most rows land inside the range they're
+        //       added to, so usually nothing is written
+        if (has_changed)
+            write_column(record, i);
+    }
+}
+
+void ZoneMap::update(uint32_t chunk_index, size_t block, const char *old_row, const char *row)
+{
+    auto record = find_or_add(chunk_index, block);
+    auto &zone = m_zones[record].second;
+    for (size_t i = 0; i < m_columns.size(); i++)
+    {
+        const auto &column = m_columns[i];
+        auto &column_zone = zone.columns[i];
+        bool has_changed = false;
+
+        auto was_null = column.is_null(old_row);
+        auto is_null = column.is_null(row);
+        if (was_null != is_null)
+        {
+            if (is_null)
+                column_zone.null_count += 1;
+            else if (column_zone.null_count > 0)
+                column_zone.null_count -= 1;
+            has_changed = true;
+        }
+
+        // NOTE: The old value may have been the min or max,
+        //       but the range is only ever made wider here
+        if (widen(column_zone, column, row))
+            has_changed = true;
+
+        if (has_changed)
+            write_column(record, i);
+    }
+}
+
+void ZoneMap::clear(uint32_t chunk_index, size_t first_block)
+{
+    for (size_t record = 0; record < m_zones.size(); record++)
+    {
+        auto key = m_zones[record].first;
+        if ((key >> 32) != chunk_index || (uint32_t)key < first_block)
+            continue;
+
+        auto &zone = m_zones[record].second;
+        for (size_t i = 0; i < m_columns.size(); i++)
+        {
+            zone.columns[i] = empty_zone(m_columns[i]);
+            write_column(record, i);
+        }
+    }
+}
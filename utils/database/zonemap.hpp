@@ -0,0 +1,86 @@
+#pragma once
+#include "forward.hpp"
+#include "column.hpp"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace DB
+{
+
+    // The range of keys (see `Index`) in each column, and how many of
+    // its values are null, for each block of `Config::zone_map_rows`
+    // rows of a row data chunk. Scans use them to skip blocks that
+    // can't match their condition. They're kept in a "ZM" chunk, and
+    // ranges only grow as rows are added or updated, until rows are
+    // removed and the blocks after them are worked out again.
+    //
+    // NOTE: Null values still have their encoded data in the range,
+    //       since that's what a condition compares against
+    class ZoneMap
+    {
+        friend Table;
+
+    public:
+        ZoneMap(const ZoneMap&) = delete;
+        ZoneMap(ZoneMap&) = delete;
+
+        struct ColumnZone
+        {
+            uint64_t min;
+            uint64_t max;
+            uint32_t null_count;
+
+            inline bool is_empty() const { return min > max; }
+        };
+
+        // Columns without keys always cover every key
+        struct Zone
+        {
+            std::vector<ColumnZone> columns;
+        };
+
+        // The zone of a block of rows in the row data chunk with
+        // this index, or null if it's not been worked out
+        const Zone *find(uint32_t chunk_index, size_t block) const;
+
+    private:
+        ZoneMap(DataBase &db, uint32_t owner_id, std::vector<Column> columns)
+            : m_db(db)
+            , m_owner_id(owner_id)
+            , m_columns(std::move(columns)) {}
+
+        void load(std::shared_ptr<Chunk>);
+        void create();
+        void drop();
+
+        // Include a new row in a block's zone
+        void add(uint32_t chunk_index, size_t block, const char *row);
+
+        // A row in a block has changed from `old_row`
+        void update(uint32_t chunk_index, size_t block, const char *old_row, const char *row);
+
+        // Empty the zones of a chunk from `first_block` on,
+        // so they can be made again from its rows
+        void clear(uint32_t chunk_index, size_t first_block);
+
+        ColumnZone empty_zone(const Column&) const;
+        size_t find_or_add(uint32_t chunk_index, size_t block);
+        void write_column(size_t record, size_t column);
+        size_t record_size() const;
+        void reserve(size_t size);
+
+        DataBase &m_db;
+        uint32_t m_owner_id;
+        std::vector<Column> m_columns;
+        std::shared_ptr<Chunk> m_chunk;
+
+        // Zones are listed in the order they're made, and
+        // found by their chunk index and block
+        std::vector<std::pair<uint64_t, Zone>> m_zones;
+        std::unordered_map<uint64_t, size_t> m_records;
+
+    };
+
+}
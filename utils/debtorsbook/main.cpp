@@ -15,7 +15,7 @@ static void setup_database(DB::DataBase &db)
     auto result = db.execute_sql("CREATE TABLE IF NOT EXISTS Debts ("
                    "    id Integer,"
                    "    datetime BigInt,"
-                   "    person Char(80),"
+                   "    person Char(80) Dictionary,"
                    "    transaction Char(80),"
                    "    owedbyme Float,"
                    "    owedbythem Float)");
@@ -75,13 +75,16 @@ static void add_new_debt(DB::DataBase &db, bool multi_mode)
         // Add to database
         int64_t datetime = time(0);
         int id = rand();
-        auto result = db.execute_sql("INSERT INTO Debts (id, datetime, person, transaction, owedbyme, owedbythem) VALUES ("
-                       + std::to_string(id) + ", "
-                       + std::to_string(datetime) + ", "
-                       + "'" + name + "', "
-                       + "'" + transaction + "', "
-                       + std::to_string(owed_by_me) + ", "
-                       + std::to_string(owed_by_them) + ")");
+        auto insert = db.prepare("INSERT INTO Debts (id, datetime, person, transaction, owedbyme, owedbythem) "
+                                 "VALUES (?, ?, ?, ?, ?, ?)");
+        insert.bind(0, id);
+        insert.bind(1, datetime);
+        insert.bind(2, name);
+        insert.bind(3, transaction);
+        insert.bind(4, owed_by_me);
+        insert.bind(5, owed_by_them);
+
+        auto result = insert.execute();
 
         if (!result.good())
             result.output_errors();
@@ -213,8 +216,10 @@ static void pay_off_debt(DB::DataBase &db, bool multi_mode)
         if (!selected_row)
             return;
 
-        auto result = db.execute_sql("DELETE FROM Debts WHERE id="
-            + std::to_string(*selected_row));
+        auto remove = db.prepare("DELETE FROM Debts WHERE id=?");
+        remove.bind(0, *selected_row);
+
+        auto result = remove.execute();
         if (!result.good())
             result.output_errors();
     } while (multi_mode);